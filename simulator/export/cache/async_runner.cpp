@@ -0,0 +1,97 @@
+/*
+ * async_runner.cpp - cache simulation of a memory trace on a host thread
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "async_runner.h"
+
+#include <infra/cache/cache_tag_array.h>
+
+AsyncCacheRunner::AsyncCacheRunner( const std::string& type, uint32 size_in_bytes, uint32 ways, uint32 line_size)
+    : cache( CacheTagArray::create( type, size_in_bytes, ways, line_size, 32))
+    , runner( CacheRunner::create( cache.get(), size_in_bytes, line_size))
+    , queue( QUEUE_CAPACITY)
+    , thread( [this]( const std::stop_token& stop_token) { consume( stop_token); })
+{
+    batch.reserve( BATCH_SIZE);
+}
+
+AsyncCacheRunner::~AsyncCacheRunner()
+{
+    stop();
+}
+
+void AsyncCacheRunner::emit( const MemoryAccess& access)
+{
+    batch.push_back( access.addr);
+    if ( batch.size() == BATCH_SIZE)
+        push_batch();
+}
+
+void AsyncCacheRunner::push_batch()
+{
+    auto next = std::vector<Addr>();
+    next.reserve( BATCH_SIZE);
+    std::swap( next, batch);
+    while ( !queue.try_push( std::move( next)))
+        std::this_thread::yield();
+
+    pushed_batches.fetch_add( 1, std::memory_order_release);
+    pushed_batches.notify_one();
+}
+
+void AsyncCacheRunner::stop()
+{
+    if ( !thread.joinable())
+        return;
+
+    thread.request_stop();
+    // wake up the consumer, which sees the stop request when the queue is empty
+    pushed_batches.fetch_add( 1, std::memory_order_release);
+    pushed_batches.notify_one();
+    thread.join();
+}
+
+CacheRunnerResults AsyncCacheRunner::finish()
+{
+    if ( !batch.empty())
+        push_batch();
+
+    stop();
+    if ( error != nullptr)
+        std::rethrow_exception( error);
+
+    return runner->get_results();
+}
+
+void AsyncCacheRunner::consume( const std::stop_token& stop_token)
+{
+    uint64 popped_batches = 0;
+    while ( true) {
+        auto next = queue.try_pop();
+        if ( !next.has_value()) {
+            // the last batch may be pushed between the failed pop and the stop request,
+            // so look at the queue again after the stop is seen
+            if ( stop_token.stop_requested()) {
+                if ( queue.empty())
+                    return;
+                continue;
+            }
+
+            pushed_batches.wait( popped_batches, std::memory_order_acquire);
+            continue;
+        }
+
+        ++popped_batches;
+        if ( error != nullptr)
+            continue; // drain the queue, so the producer is not blocked
+
+        try {
+            for ( const auto addr : *next)
+                runner->access( addr);
+        }
+        catch ( ...) {
+            error = std::current_exception();
+        }
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * async_runner.h - cache simulation of a memory trace on a host thread
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef ASYNC_RUNNER_H
+#define ASYNC_RUNNER_H
+
+#include "runner.h"
+
+#include <infra/memory_trace.h>
+#include <infra/spsc_queue.h>
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CacheTagArray;
+
+/*
+ * Consumes accesses of a running simulator without a trace file.
+ * Addresses are collected into batches, which are passed to the cache
+ * thread through a bounded queue, so the simulator waits only
+ * if the cache simulation falls behind by the whole queue.
+ */
+class AsyncCacheRunner : public MemoryTraceSink
+{
+public:
+    AsyncCacheRunner( const std::string& type, uint32 size_in_bytes, uint32 ways, uint32 line_size);
+    ~AsyncCacheRunner() override;
+    AsyncCacheRunner( const AsyncCacheRunner&) = delete;
+    AsyncCacheRunner( AsyncCacheRunner&&) = delete;
+    AsyncCacheRunner& operator=( const AsyncCacheRunner&) = delete;
+    AsyncCacheRunner& operator=( AsyncCacheRunner&&) = delete;
+
+    void emit( const MemoryAccess& access) final;
+
+    // Waits for all emitted accesses and rethrows an error of the cache thread
+    CacheRunnerResults finish();
+
+private:
+    static const constexpr size_t BATCH_SIZE = 4096;
+    static const constexpr size_t QUEUE_CAPACITY = 64;
+
+    void push_batch();
+    void stop();
+    void consume( const std::stop_token& stop_token);
+
+    const std::unique_ptr<CacheTagArray> cache;
+    const std::unique_ptr<CacheRunner> runner;
+    std::vector<Addr> batch;
+    SPSCQueue<std::vector<Addr>> queue;
+    std::atomic<uint64> pushed_batches = 0;
+    std::exception_ptr error;
+    std::jthread thread; // the last member, so the thread starts when all members are ready
+};
+
+#endif // ASYNC_RUNNER_H
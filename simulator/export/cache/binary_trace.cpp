@@ -0,0 +1,200 @@
+/*
+ * binary_trace.cpp - compact binary memory trace
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "binary_trace.h"
+
+#include <infra/macro.h>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAS_MMAP 1
+#endif
+
+static const constexpr std::array<char, 8> MAGIC = { 'M', 'I', 'P', 'T', 'M', 'E', 'M', '1'};
+static const constexpr size_t HEADER_SIZE = 16;
+static const constexpr uint8 HAS_ACCESS_TYPES = 1;
+
+#ifdef HAS_MMAP
+class MappedFile
+{
+public:
+    explicit MappedFile( const std::string& filename)
+    {
+        const int fd = open( filename.c_str(), O_RDONLY); // NOLINT(cppcoreguidelines-pro-type-vararg, hicpp-vararg)
+        if ( fd < 0)
+            throw BinaryTraceException( "cannot open " + filename);
+
+        struct stat info = {};
+        if ( fstat( fd, &info) != 0) {
+            close( fd);
+            throw BinaryTraceException( "cannot get size of " + filename);
+        }
+
+        size = narrow_cast<size_t>( info.st_size);
+        if ( size != 0)
+            data = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close( fd);
+
+        if ( data == MAP_FAILED) // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+            throw BinaryTraceException( "cannot map " + filename);
+
+        // the trace is read once from the beginning to the end
+        if ( size != 0)
+            madvise( data, size, MADV_SEQUENTIAL);
+    }
+
+    ~MappedFile()
+    {
+        if ( size != 0)
+            munmap( data, size);
+    }
+
+    MappedFile( const MappedFile&) = delete;
+    MappedFile( MappedFile&&) = delete;
+    MappedFile& operator=( const MappedFile&) = delete;
+    MappedFile& operator=( MappedFile&&) = delete;
+
+    const uint8* begin() const { return static_cast<const uint8*>( data); }
+    const uint8* end() const { return begin() + size; }
+
+private:
+    void* data = nullptr;
+    size_t size = 0;
+};
+#else
+/* Platforms without mmap read the whole file */
+class MappedFile
+{
+public:
+    explicit MappedFile( const std::string& filename)
+    {
+        std::ifstream in( filename, std::ios::binary);
+        if ( !in)
+            throw BinaryTraceException( "cannot open " + filename);
+
+        data.assign( std::istreambuf_iterator<char>( in), std::istreambuf_iterator<char>());
+    }
+
+    const uint8* begin() const { return reinterpret_cast<const uint8*>( data.data()); }
+    const uint8* end() const { return begin() + data.size(); }
+
+private:
+    std::vector<char> data;
+};
+#endif
+
+static uint64 zigzag_encode( Addr addr, Addr previous)
+{
+    const auto delta = narrow_cast<int64>( addr - previous);
+    return ( uint64( delta) << 1U) ^ uint64( delta >> 63U);
+}
+
+static Addr zigzag_decode( uint64 value, Addr previous)
+{
+    return previous + ( ( value >> 1U) ^ ( 0 - ( value & 1U)));
+}
+
+BinaryTraceWriter::BinaryTraceWriter( const std::string& filename, bool has_access_types)
+    : out( filename, std::ios::binary)
+    , has_access_types( has_access_types)
+{
+    if ( !out)
+        throw BinaryTraceException( "cannot open " + filename);
+
+    std::array<char, HEADER_SIZE> header = {};
+    std::copy( MAGIC.begin(), MAGIC.end(), header.begin());
+    header[ MAGIC.size()] = has_access_types ? HAS_ACCESS_TYPES : 0;
+    out.write( header.data(), header.size());
+}
+
+void BinaryTraceWriter::write( const MemoryAccess& access)
+{
+    // 64 bits take at most 10 bytes of LEB128 and one byte is for the type
+    std::array<char, 11> record = {};
+    size_t length = 0;
+    auto value = zigzag_encode( access.addr, previous);
+    do {
+        const auto byte = narrow_cast<uint8>( value & 0x7fU);
+        value >>= 7U;
+        record[ length++] = narrow_cast<char>( value != 0 ? ( byte | 0x80U) : byte);
+    } while ( value != 0);
+
+    if ( has_access_types)
+        record[ length++] = narrow_cast<char>( ( uint32{ access.size} << 1U) | ( access.is_write ? 1U : 0U));
+
+    out.write( record.data(), narrow_cast<std::streamsize>( length));
+    previous = access.addr;
+}
+
+bool BinaryTraceReader::is_binary_trace( const std::string& filename)
+{
+    std::ifstream in( filename, std::ios::binary);
+    std::array<char, MAGIC.size()> magic = {};
+    in.read( magic.data(), magic.size());
+    return in && magic == MAGIC;
+}
+
+BinaryTraceReader::BinaryTraceReader( const std::string& filename)
+    : file( std::make_unique<MappedFile>( filename))
+    , position( file->begin())
+    , end( file->end())
+{
+    if ( narrow_cast<size_t>( end - position) < HEADER_SIZE || std::memcmp( position, MAGIC.data(), MAGIC.size()) != 0)
+        throw BinaryTraceException( filename + " has no binary trace header");
+
+    access_types = ( position[ MAGIC.size()] & HAS_ACCESS_TYPES) != 0;
+    position += HEADER_SIZE;
+}
+
+BinaryTraceReader::~BinaryTraceReader() = default;
+
+bool BinaryTraceReader::read( MemoryAccess* access)
+{
+    if ( position == end)
+        return false;
+
+    uint64 value = 0;
+    for ( uint32 shift = 0; ; shift += 7) {
+        if ( position == end || shift >= 64)
+            throw BinaryTraceException( "truncated address record");
+
+        const uint8 byte = *position++;
+        value |= uint64{ byte & 0x7fU} << shift;
+        if ( ( byte & 0x80U) == 0)
+            break;
+    }
+
+    access->addr = previous = zigzag_decode( value, previous);
+    if ( !access_types)
+        return true;
+
+    if ( position == end)
+        throw BinaryTraceException( "truncated access type record");
+
+    const uint8 type = *position++;
+    access->is_write = ( type & 1U) != 0;
+    access->size = narrow_cast<uint8>( type >> 1U);
+    return true;
+}
+
+void convert_json_trace( const std::string& json_filename, const std::string& binary_filename)
+{
+    boost::property_tree::ptree trace;
+    read_json( json_filename, trace);
+
+    BinaryTraceWriter writer( binary_filename, false);
+    for ( const auto& access : trace.get_child( "memory_trace"))
+        writer.write( std::stoull( access.second.get_value<std::string>(), nullptr, 0));
+}
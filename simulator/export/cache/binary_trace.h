@@ -0,0 +1,77 @@
+/*
+ * binary_trace.h - compact binary memory trace
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef BINARY_TRACE_H
+#define BINARY_TRACE_H
+
+#include <infra/exception.h>
+#include <infra/memory_trace.h>
+#include <infra/types.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+struct BinaryTraceException final : Exception
+{
+    explicit BinaryTraceException( const std::string& msg)
+        : Exception( "Invalid binary memory trace", msg)
+    { }
+};
+
+/*
+ * The trace starts with a 16-byte header: 8-byte magic, a byte of flags
+ * and reserved bytes. Each record is a difference with the previous address,
+ * zigzag-encoded to an unsigned LEB128 number. If the trace has access types,
+ * the number is followed by a byte of the access size shifted left by one
+ * and the write flag in the least significant bit.
+ */
+class BinaryTraceWriter : public MemoryTraceSink
+{
+public:
+    BinaryTraceWriter( const std::string& filename, bool has_access_types);
+
+    void write( const MemoryAccess& access);
+    void write( Addr addr) { write( MemoryAccess{ addr, false, 0}); }
+    void emit( const MemoryAccess& access) final { write( access); }
+
+private:
+    std::ofstream out;
+    const bool has_access_types;
+    Addr previous = 0;
+};
+
+class MappedFile;
+
+/* Reads records one by one from the file mapped to the memory */
+class BinaryTraceReader
+{
+public:
+    explicit BinaryTraceReader( const std::string& filename);
+    ~BinaryTraceReader();
+    BinaryTraceReader( const BinaryTraceReader&) = delete;
+    BinaryTraceReader( BinaryTraceReader&&) = delete;
+    BinaryTraceReader& operator=( const BinaryTraceReader&) = delete;
+    BinaryTraceReader& operator=( BinaryTraceReader&&) = delete;
+
+    static bool is_binary_trace( const std::string& filename);
+
+    bool has_access_types() const noexcept { return access_types; }
+
+    // Returns false if the trace is over
+    bool read( MemoryAccess* access);
+
+private:
+    const std::unique_ptr<MappedFile> file;
+    const uint8* position = nullptr;
+    const uint8* end = nullptr;
+    bool access_types = false;
+    Addr previous = 0;
+};
+
+/* Converts a JSON trace of cachesim to the binary format */
+void convert_json_trace( const std::string& json_filename, const std::string& binary_filename);
+
+#endif // BINARY_TRACE_H
@@ -3,22 +3,64 @@
  * @author Pavel Kryukov
  */
 
+#include "binary_trace.h"
+#include "parallel_sweep.h"
 #include "runner.h"
+#include "stack_distance.h"
 
 #include <infra/cache/cache_tag_array.h>
 #include <infra/config/config.h>
 #include <infra/config/main_wrapper.h>
 #include <infra/macro.h>
 
+#include <sstream>
+#include <thread>
+#include <vector>
+
 namespace config {
-    static const AliasedRequiredValue<uint32> size = { "s", "size", "Size of instruction level 1 cache (in bytes)"};
-    static const AliasedRequiredValue<uint32> ways = { "w", "ways", "Amount of ways in instruction level 1 cache"};
+    static const AliasedValue<uint32> size = { "s", "size", 2048, "Size of instruction level 1 cache (in bytes)"};
+    static const AliasedValue<uint32> ways = { "w", "ways", 4, "Amount of ways in instruction level 1 cache"};
     static const AliasedRequiredValue<std::string> file = { "t", "tracename", "file name with trace"};
 
     static const AliasedValue<std::string> replacement = { "r", "replacement", "LRU", "Cache replacement scheme"};
     static const Value<uint32> line_size = { "line_size", 64, "Line size of instruction level 1 cache (in bytes)"};
+    static const Value<std::string> sweep_sizes = { "sweep-sizes", "", "Comma-separated cache sizes to sweep, results are printed as CSV"};
+    static const Value<std::string> sweep_ways = { "sweep-ways", "1,2,4,8,16", "Comma-separated amounts of ways to sweep"};
+    static const Value<uint32> threads = { "threads", 0, "Amount of host threads for sweeps of non-LRU caches, 0 is for all"};
+    static const Value<std::string> convert = { "convert", "", "Convert the JSON trace to a binary trace with the given name"};
 } // namespace config
 
+static std::vector<uint32> parse_list( const std::string& value)
+{
+    std::vector<uint32> result;
+    std::istringstream in( value);
+    for ( std::string item; std::getline( in, item, ','); ) try {
+        result.push_back( narrow_cast<uint32>( std::stoul( item)));
+    }
+    catch ( const std::logic_error&) {
+        throw CacheSweepException( value + " is not a comma-separated list of numbers");
+    }
+    return result;
+}
+
+static void run_sweep()
+{
+    // Other policies are not stack algorithms, so each configuration is simulated
+    if ( config::replacement != "LRU") {
+        const auto threads = uint32{ config::threads} != 0 ? uint32{ config::threads} : std::thread::hardware_concurrency();
+        ParallelCacheSweep sweep( config::replacement, parse_list( config::sweep_sizes), parse_list( config::sweep_ways),
+                                  config::line_size, threads);
+        sweep.run( config::file);
+        sweep.dump_csv( std::cout);
+        return;
+    }
+
+    // LRU is a stack algorithm, so a single pass covers all configurations
+    CacheSweep sweep( parse_list( config::sweep_sizes), parse_list( config::sweep_ways), config::line_size);
+    for_each_access( config::file, [&sweep]( Addr addr) { sweep.access( addr); });
+    sweep.dump_csv( std::cout);
+}
+
 class Main : public MainWrapper
 {
     using MainWrapper::MainWrapper;
@@ -26,8 +68,18 @@ private:
     // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays, hicpp-avoid-c-arrays)
     int impl( int argc, const char* argv[]) const final {
         config::handleArgs( argc, argv, 1);
+        if ( config::convert != "") {
+            convert_json_trace( config::file, config::convert);
+            return 0;
+        }
+
+        if ( config::sweep_sizes != "") {
+            run_sweep();
+            return 0;
+        }
+
         auto cache = CacheTagArray::create( config::replacement, config::size, config::ways, config::line_size, 32);
-        std::cout << CacheRunner::create( cache.get())->run( config::file);
+        std::cout << CacheRunner::create( cache.get(), config::size, config::line_size)->run( config::file);
         return 0;
     }
 };
@@ -0,0 +1,119 @@
+/*
+ * parallel_sweep.cpp - simulation of several cache configurations on host threads
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "parallel_sweep.h"
+#include "runner.h"
+
+#include <algorithm>
+#include <barrier>
+#include <exception>
+#include <ostream>
+#include <thread>
+
+// Large enough to amortize the barrier, small enough to stay in the host cache
+static const constexpr size_t CHUNK_SIZE = 1U << 16U;
+
+ParallelCacheSweep::ParallelCacheSweep( const std::string& replacement,
+                                        const std::vector<uint32>& sizes,
+                                        const std::vector<uint32>& ways,
+                                        uint32 line_size,
+                                        size_t threads_num)
+    : replacement( replacement)
+    , configurations( get_sweep_grid( sizes, ways, line_size))
+    , line_size( line_size)
+    , threads_num( std::max<size_t>( threads_num, 1))
+{ }
+
+void ParallelCacheSweep::simulate( size_t worker, const std::vector<Addr>& chunk)
+{
+    for ( auto i = worker; i < configurations.size(); i += threads_num) {
+        auto* cache = caches[ i].get();
+        for ( const auto addr : chunk) {
+            if ( cache->lookup( addr))
+                ++results[ i].hits;
+            else
+                cache->write( addr);
+        }
+    }
+}
+
+void ParallelCacheSweep::run( const std::string& filename)
+{
+    caches.clear();
+    for ( const auto& c : configurations)
+        caches.push_back( CacheTagArray::create( replacement, c.size, c.ways, line_size, 32));
+
+    results.assign( configurations.size(), Result{});
+    accesses = 0;
+
+    const auto workers = std::min( threads_num, configurations.size());
+    std::vector<std::exception_ptr> exceptions( workers);
+    std::exception_ptr read_exception = nullptr;
+    std::vector<Addr> current;
+    std::vector<Addr> next;
+    next.reserve( CHUNK_SIZE);
+    bool finished = false;
+    {
+        // An empty chunk stops the workers
+        std::barrier sync( narrow_cast<std::ptrdiff_t>( workers + 1), [&]() noexcept {
+            std::swap( current, next);
+            next.clear();
+            accesses += current.size();
+            finished = current.empty();
+        });
+
+        std::vector<std::jthread> threads;
+        threads.reserve( workers);
+        for ( size_t worker = 0; worker < workers; ++worker)
+            threads.emplace_back( [this, worker, &sync, &current, &finished, &exceptions]() {
+                for ( sync.arrive_and_wait(); !finished; sync.arrive_and_wait()) try {
+                    if ( exceptions[ worker] == nullptr)
+                        simulate( worker, current);
+                }
+                catch (...) {
+                    exceptions[ worker] = std::current_exception();
+                }
+            });
+
+        try {
+            for_each_access( filename, [&sync, &next]( Addr addr) {
+                next.push_back( addr);
+                if ( next.size() == CHUNK_SIZE)
+                    sync.arrive_and_wait();
+            });
+        }
+        catch (...) {
+            read_exception = std::current_exception();
+            next.clear();
+        }
+
+        if ( !next.empty())
+            sync.arrive_and_wait();
+        sync.arrive_and_wait();
+    }
+
+    if ( read_exception != nullptr)
+        std::rethrow_exception( read_exception);
+
+    for ( const auto& exception : exceptions)
+        if ( exception != nullptr)
+            std::rethrow_exception( exception);
+
+    for ( size_t i = 0; i < configurations.size(); ++i)
+        results[ i].replacement = caches[ i]->get_replacement_statistics();
+}
+
+void ParallelCacheSweep::dump_csv( std::ostream& out) const
+{
+    out << "size,ways,sets,accesses,hits,hit_rate,near_insertions,distant_insertions,srrip_wins,brrip_wins" << std::endl;
+    for ( size_t i = 0; i < configurations.size(); ++i) {
+        const auto& c = configurations[ i];
+        const auto& result = results.empty() ? Result{} : results[ i];
+        out << c.size << ',' << c.ways << ',' << c.sets << ',' << accesses << ',' << result.hits << ','
+            << ( accesses == 0 ? 0 : double( result.hits) / accesses) << ','
+            << result.replacement.near_insertions << ',' << result.replacement.distant_insertions << ','
+            << result.replacement.srrip_wins << ',' << result.replacement.brrip_wins << std::endl;
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * parallel_sweep.h - simulation of several cache configurations on host threads
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef PARALLEL_SWEEP_H
+#define PARALLEL_SWEEP_H
+
+#include "stack_distance.h"
+
+#include <infra/cache/cache_tag_array.h>
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Configurations are distributed over worker threads, each worker owns
+ * tag arrays of its configurations. The main thread reads the trace
+ * into a chunk, while workers simulate the previous chunk. All threads
+ * meet on a barrier, where the chunks are swapped, so each worker sees
+ * the whole trace in order.
+ */
+class ParallelCacheSweep
+{
+public:
+    ParallelCacheSweep( const std::string& replacement,
+                        const std::vector<uint32>& sizes,
+                        const std::vector<uint32>& ways,
+                        uint32 line_size,
+                        size_t threads_num);
+
+    void run( const std::string& filename);
+    void dump_csv( std::ostream& out) const;
+
+private:
+    struct Result
+    {
+        uint64 hits = 0;
+        ReplacementStatistics replacement;
+    };
+
+    void simulate( size_t worker, const std::vector<Addr>& chunk);
+
+    const std::string replacement;
+    const std::vector<SweepConfiguration> configurations;
+    const uint32 line_size;
+    const size_t threads_num;
+    std::vector<std::unique_ptr<CacheTagArray>> caches;
+    std::vector<Result> results;
+    uint64 accesses = 0;
+};
+
+#endif // PARALLEL_SWEEP_H
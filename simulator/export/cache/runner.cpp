@@ -4,16 +4,16 @@
  */
  
 #include "runner.h"
+#include "binary_trace.h"
 
 #include <infra/cache/cache_tag_array.h>
 #include <infra/macro.h>
 
-// #include <sparsehash/dense_hash_map.h> FIXME(pikryuko) install
-
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <sparsehash/dense_hash_map.h>
 
-#include <unordered_set>
+#include <bit>
 
 static void dump_percentage( std::ostream& out, std::string_view name, double value)
 {
@@ -26,59 +26,120 @@ std::ostream& operator<<( std::ostream& out, const CacheRunnerResults& rhs)
     dump_percentage( out, "hit rate", rhs.get_hit_rate());
     dump_percentage( out, "miss rate", rhs.get_miss_rate());
     dump_percentage( out, "compulsory miss rate", rhs.get_compulsory_miss_subrate());
+    dump_percentage( out, "capacity miss rate", rhs.get_capacity_miss_subrate());
+    dump_percentage( out, "conflict miss rate", rhs.get_conflict_miss_subrate());
+    if ( !rhs.replacement.empty())
+        out << "replacement " << rhs.replacement << std::endl;
     return out;
 }
 
+/*
+ * Misses are classified with line-granular history of accesses
+ * and a fully-associative LRU shadow cache of the same capacity.
+ */
 class CommonCacheRunner : public CacheRunner
 {
 public:
-    explicit CommonCacheRunner( CacheTagArray* cache) : cache( cache)
+    CommonCacheRunner( CacheTagArray* cache, uint32 size_in_bytes, uint32 line_size)
+        : cache( cache)
+        , shadow( CacheTagArray::create( "LRU", size_in_bytes, size_in_bytes / line_size, line_size, 32))
+        , line_bits( narrow_cast<uint32>( std::countr_zero( line_size)))
     {
-//        history.set_empty_key( all_ones<PhysAddr>());
+        history.set_empty_key( all_ones<Addr>());
     }
 
     CacheRunnerResults run( const std::string& filename) final;
+    void access( Addr addr) final { account_access( addr, &results); }
+    CacheRunnerResults get_results() const final;
 
 private:
     void account_access( Addr addr, CacheRunnerResults* result);
-    void account_miss( Addr addr, CacheRunnerResults* result);
+    void account_miss( Addr addr, bool is_shadow_hit, CacheRunnerResults* result);
+    bool is_first_touch( Addr addr);
 
-//    google::dense_hash_set<Addr> history;
-    std::unordered_set<Addr> history;
+    // bitmaps of touched lines for each 64 adjacent lines
+    google::dense_hash_map<Addr, uint64> history;
     CacheTagArray* cache;
+    const std::unique_ptr<CacheTagArray> shadow;
+    CacheRunnerResults results;
+    const uint32 line_bits;
 };
 
 void CommonCacheRunner::account_access( Addr addr, CacheRunnerResults* result)
 {
     result->accesses++;
+    const bool is_shadow_hit = shadow->lookup( addr);
+    if ( !is_shadow_hit)
+        shadow->write( addr);
+
     if ( cache->lookup( addr))
         result->hits++;
     else
-        account_miss( addr, result);
+        account_miss( addr, is_shadow_hit, result);
+}
+
+bool CommonCacheRunner::is_first_touch( Addr addr)
+{
+    // cachesim models 32-bit addresses
+    const Addr line = ( addr & bitmask<Addr>( 32)) >> line_bits;
+    auto& bitmap = history[ line >> 6U];
+    const uint64 bit = uint64{ 1} << ( line & 63U);
+    const bool result = ( bitmap & bit) == 0;
+    bitmap |= bit;
+    return result;
 }
 
-void CommonCacheRunner::account_miss( Addr addr, CacheRunnerResults* result)
+void CommonCacheRunner::account_miss( Addr addr, bool is_shadow_hit, CacheRunnerResults* result)
 {
     cache->write( addr);
-    if ( history.count( addr) == 0) {
+
+    if ( is_first_touch( addr))
         ++result->compulsory_misses;
-        history.insert( addr);
-    }
+    else if ( !is_shadow_hit)
+        ++result->capacity_misses;
+    else
+        ++result->conflict_misses;
 }
 
 CacheRunnerResults CommonCacheRunner::run( const std::string& filename)
 {
-    CacheRunnerResults result;
+    for_each_access( filename, [this]( Addr addr) { account_access( addr, &results); });
+    return get_results();
+}
+
+CacheRunnerResults CommonCacheRunner::get_results() const
+{
+    auto result = results;
+    result.replacement = cache->get_replacement_statistics();
+    return result;
+}
+
+static void read_json_trace( const std::string& filename, const std::function<void( Addr)>& visitor)
+{
     boost::property_tree::ptree trace;
     read_json( filename, trace);
 
     for ( const auto& access : trace.get_child( "memory_trace"))
-        account_access( std::stoul( access.second.get_value<std::string>(), nullptr, 0), &result);
-    
-    return result;
+        visitor( std::stoul( access.second.get_value<std::string>(), nullptr, 0));
+}
+
+static void read_binary_trace( const std::string& filename, const std::function<void( Addr)>& visitor)
+{
+    BinaryTraceReader trace( filename);
+    MemoryAccess access;
+    while ( trace.read( &access))
+        visitor( access.addr);
+}
+
+void for_each_access( const std::string& filename, const std::function<void( Addr)>& visitor)
+{
+    if ( BinaryTraceReader::is_binary_trace( filename))
+        read_binary_trace( filename, visitor);
+    else
+        read_json_trace( filename, visitor);
 }
 
-std::unique_ptr<CacheRunner> CacheRunner::create( CacheTagArray* cache)
+std::unique_ptr<CacheRunner> CacheRunner::create( CacheTagArray* cache, uint32 size_in_bytes, uint32 line_size)
 {
-    return std::make_unique<CommonCacheRunner>( cache);
+    return std::make_unique<CommonCacheRunner>( cache, size_in_bytes, line_size);
 }
@@ -6,8 +6,10 @@
 #ifndef CACHE_RUNNER_H
 #define CACHE_RUNNER_H
 
+#include <infra/replacement/cache_replacement.h>
 #include <infra/types.h>
 
+#include <functional>
 #include <iostream>
 #include <memory>
 
@@ -17,12 +19,18 @@ struct CacheRunnerResults
 {
     uint64 accesses = 0;
     uint64 hits = 0;
-    uint64 compulsory_misses = 0;
+    uint64 compulsory_misses = 0; // the first access to the line
+    uint64 capacity_misses = 0;   // misses of a fully-associative LRU cache of the same size
+    uint64 conflict_misses = 0;   // other misses
+    ReplacementStatistics replacement;
 
     auto get_hit_rate() const noexcept  { return accesses == 0 ? 0 : double( hits) / accesses; }
     auto get_miss_rate() const noexcept { return 1 - get_hit_rate(); }
     auto get_misses() const noexcept { return accesses - hits; }
-    auto get_compulsory_miss_subrate() const noexcept { return get_misses() == 0 ? 0 : double( compulsory_misses) / get_misses(); }
+    auto get_compulsory_miss_subrate() const noexcept { return get_miss_subrate( compulsory_misses); }
+    auto get_capacity_miss_subrate() const noexcept { return get_miss_subrate( capacity_misses); }
+    auto get_conflict_miss_subrate() const noexcept { return get_miss_subrate( conflict_misses); }
+    double get_miss_subrate( uint64 misses) const noexcept { return get_misses() == 0 ? 0 : double( misses) / get_misses(); }
 
     friend std::ostream& operator<<( std::ostream& out, const CacheRunnerResults& rhs);
 };
@@ -37,9 +45,17 @@ public:
     CacheRunner& operator=( const CacheRunner&) = delete;
     CacheRunner& operator=( CacheRunner&&) = delete;
 
-    static std::unique_ptr<CacheRunner> create( CacheTagArray* cache);
+    // Size and line size of the cache are used to classify misses
+    static std::unique_ptr<CacheRunner> create( CacheTagArray* cache, uint32 size_in_bytes, uint32 line_size);
 
     virtual CacheRunnerResults run( const std::string& filename) = 0;
+
+    // Accesses may be also passed one by one, e.g. from a running simulator
+    virtual void access( Addr addr) = 0;
+    virtual CacheRunnerResults get_results() const = 0;
 };
 
+// Calls the visitor for each address of a JSON or binary trace
+void for_each_access( const std::string& filename, const std::function<void( Addr)>& visitor);
+
 #endif
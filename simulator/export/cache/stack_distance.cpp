@@ -0,0 +1,139 @@
+/*
+ * stack_distance.cpp - single-pass simulation of LRU caches of all sizes
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "stack_distance.h"
+
+#include <algorithm>
+#include <bit>
+#include <numeric>
+#include <ostream>
+
+StackDistanceHistogram::StackDistanceHistogram( uint32 sets, uint32 max_ways)
+    : sets( sets)
+    , histogram( max_ways + 1, 0)
+{ }
+
+void StackDistanceHistogram::add( Set* set, uint32 time, int32 value)
+{
+    for ( auto i = time + 1; i <= set->tree.size(); i += i & ( 0 - i))
+        set->tree[ i - 1] += value;
+}
+
+uint32 StackDistanceHistogram::count_before( const Set& set, uint32 time)
+{
+    uint32 result = 0;
+    for ( auto i = time; i > 0; i -= i & ( 0 - i))
+        result += set.tree[ i - 1];
+
+    return result;
+}
+
+// Renumbers the last accesses from zero, so the timeline does not grow with the trace
+void StackDistanceHistogram::compact( Set* set)
+{
+    std::vector<uint32> timeline;
+    timeline.reserve( set->lines);
+    for ( const auto line : set->timeline)
+        if ( line != NO_LINE) {
+            last_access[ line] = narrow_cast<uint32>( timeline.size());
+            timeline.push_back( line);
+        }
+
+    set->timeline = std::move( timeline);
+    set->tree.assign( std::max<size_t>( 16, set->timeline.size() * 2), 0);
+    for ( uint32 time = 0; time < set->timeline.size(); ++time)
+        add( set, time, 1);
+}
+
+void StackDistanceHistogram::access( Addr line, uint32 line_id, bool is_cold)
+{
+    auto& set = sets[ line & ( sets.size() - 1)];
+    if ( !is_cold) {
+        const auto time = last_access[ line_id];
+        const auto distance = set.lines - count_before( set, time + 1);
+        ++histogram[ std::min<size_t>( distance, histogram.size() - 1)];
+        add( &set, time, -1);
+        set.timeline[ time] = NO_LINE;
+        --set.lines;
+    }
+    else {
+        ++histogram.back();
+        last_access.push_back( 0);
+    }
+
+    if ( set.timeline.size() == set.tree.size())
+        compact( &set);
+
+    last_access[ line_id] = narrow_cast<uint32>( set.timeline.size());
+    add( &set, last_access[ line_id], 1);
+    set.timeline.push_back( line_id);
+    ++set.lines;
+}
+
+uint64 StackDistanceHistogram::get_hits( uint32 ways) const
+{
+    const auto end = histogram.begin() + std::min<size_t>( ways, histogram.size() - 1);
+    return std::accumulate( histogram.begin(), end, uint64{ 0});
+}
+
+std::vector<SweepConfiguration> get_sweep_grid( const std::vector<uint32>& sizes, const std::vector<uint32>& ways, uint32 line_size)
+{
+    if ( !is_power_of_two( line_size))
+        throw CacheSweepException( "line size " + std::to_string( line_size) + " is not a power of 2");
+
+    std::vector<SweepConfiguration> result;
+    for ( const auto size : sizes)
+        for ( const auto way : ways) {
+            // too high associativity for the size
+            if ( way == 0 || uint64{ way} * line_size > size)
+                continue;
+
+            const auto sets = size / way / line_size;
+            if ( uint64{ sets} * way * line_size != size || !is_power_of_two( sets))
+                throw CacheSweepException( "size " + std::to_string( size) + " with " + std::to_string( way)
+                                           + " ways does not give a power of 2 number of sets");
+
+            result.push_back( SweepConfiguration{ size, way, sets});
+        }
+    return result;
+}
+
+CacheSweep::CacheSweep( const std::vector<uint32>& sizes, const std::vector<uint32>& ways, uint32 line_size)
+    : configurations( get_sweep_grid( sizes, ways, line_size))
+    , line_bits( narrow_cast<uint32>( std::countr_zero( line_size)))
+{
+    const auto max_ways = ways.empty() ? 0 : *std::max_element( ways.begin(), ways.end());
+    for ( const auto& c : configurations) {
+        auto histogram = std::find_if( histograms.begin(), histograms.end(),
+                                       [&c]( const auto& h) { return h.get_sets() == c.sets; });
+        if ( histogram == histograms.end()) {
+            histograms.emplace_back( c.sets, max_ways);
+            histogram = std::prev( histograms.end());
+        }
+        configuration_histograms.push_back( narrow_cast<size_t>( histogram - histograms.begin()));
+    }
+}
+
+void CacheSweep::access( Addr addr)
+{
+    // cachesim models 32-bit addresses
+    const Addr line = ( addr & bitmask<Addr>( 32)) >> line_bits;
+    const auto [id, is_cold] = line_ids.try_emplace( line, narrow_cast<uint32>( line_ids.size()));
+    for ( auto& histogram : histograms)
+        histogram.access( line, id->second, is_cold);
+
+    ++accesses;
+}
+
+void CacheSweep::dump_csv( std::ostream& out) const
+{
+    out << "size,ways,sets,accesses,hits,hit_rate" << std::endl;
+    for ( size_t i = 0; i < configurations.size(); ++i) {
+        const auto& c = configurations[ i];
+        const auto hits = histograms[ configuration_histograms[ i]].get_hits( c.ways);
+        out << c.size << ',' << c.ways << ',' << c.sets << ',' << accesses << ',' << hits << ','
+            << ( accesses == 0 ? 0 : double( hits) / accesses) << std::endl;
+    }
+}
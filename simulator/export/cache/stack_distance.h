@@ -0,0 +1,89 @@
+/*
+ * stack_distance.h - single-pass simulation of LRU caches of all sizes
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef STACK_DISTANCE_H
+#define STACK_DISTANCE_H
+
+#include <infra/exception.h>
+#include <infra/macro.h>
+#include <infra/types.h>
+
+#include <iosfwd>
+#include <unordered_map>
+#include <vector>
+
+struct CacheSweepException final : Exception
+{
+    explicit CacheSweepException( const std::string& msg)
+        : Exception( "Invalid cache sweep", msg)
+    { }
+};
+
+struct SweepConfiguration
+{
+    uint32 size;
+    uint32 ways;
+    uint32 sets;
+};
+
+// Configurations of the grid, skipping ones with more ways than lines
+std::vector<SweepConfiguration> get_sweep_grid( const std::vector<uint32>& sizes, const std::vector<uint32>& ways, uint32 line_size);
+
+/*
+ * LRU hits in a W-way set if less than W other lines of the set
+ * were accessed since the previous access to the line.
+ * The distance is counted by a Fenwick tree which marks the last access of
+ * each line of a set, so a single pass gives hits for any number of ways.
+ */
+class StackDistanceHistogram
+{
+public:
+    StackDistanceHistogram( uint32 sets, uint32 max_ways);
+
+    // Lines are numbered in order of the first access
+    void access( Addr line, uint32 line_id, bool is_cold);
+
+    // Returns number of hits of LRU cache with the given associativity
+    uint64 get_hits( uint32 ways) const;
+    uint32 get_sets() const noexcept { return narrow_cast<uint32>( sets.size()); }
+
+private:
+    static const constexpr uint32 NO_LINE = all_ones<uint32>();
+
+    struct Set
+    {
+        std::vector<uint32> tree;     // Fenwick tree, capacity of the set timeline
+        std::vector<uint32> timeline; // lines by time of the access, NO_LINE if accessed later
+        uint32 lines = 0;           // number of marks in the tree
+    };
+
+    static void add( Set* set, uint32 time, int32 value);
+    static uint32 count_before( const Set& set, uint32 time);
+    void compact( Set* set);
+
+    std::vector<uint32> last_access;
+    std::vector<Set> sets;
+    std::vector<uint64> histogram; // the last bucket is for far and cold accesses
+};
+
+/* Hit rates of LRU caches for a grid of sizes and associativities */
+class CacheSweep
+{
+public:
+    CacheSweep( const std::vector<uint32>& sizes, const std::vector<uint32>& ways, uint32 line_size);
+
+    void access( Addr addr);
+    void dump_csv( std::ostream& out) const;
+
+private:
+    std::vector<SweepConfiguration> configurations;
+    std::vector<size_t> configuration_histograms;
+    std::vector<StackDistanceHistogram> histograms;
+    std::unordered_map<Addr, uint32> line_ids;
+    const uint32 line_bits;
+    uint64 accesses = 0;
+};
+
+#endif // STACK_DISTANCE_H
@@ -3,17 +3,25 @@
  * @author Pavel Kryukov
  */
 
+#include <export/cache/async_runner.h>
+#include <export/cache/binary_trace.h>
+#include <export/cache/parallel_sweep.h>
 #include <export/cache/runner.h>
+#include <export/cache/stack_distance.h>
 #include <infra/cache/cache_tag_array.h>
 
 #include <catch.hpp>
+#include <cstdio>
+#include <random>
 #include <sstream>
+#include <vector>
 
 TEST_CASE("CacheRunner: results zero dump")
 {
     std::ostringstream oss;
     oss << CacheRunnerResults();
-    CHECK( oss.str() == "total accesses: 0\nhit rate: 0%\nmiss rate: 100%\ncompulsory miss rate: 0%\n" );
+    CHECK( oss.str() == "total accesses: 0\nhit rate: 0%\nmiss rate: 100%\ncompulsory miss rate: 0%\n"
+                        "capacity miss rate: 0%\nconflict miss rate: 0%\n" );
 }
 
 TEST_CASE("CacheRunner: results any dump")
@@ -22,15 +30,17 @@ TEST_CASE("CacheRunner: results any dump")
     r.accesses = 10;
     r.hits = 7;
     r.compulsory_misses = 1;
+    r.capacity_misses = 2;
     std::ostringstream oss;
     oss << r;
-    CHECK( oss.str() == "total accesses: 10\nhit rate: 70%\nmiss rate: 30%\ncompulsory miss rate: 33.3333%\n" );
+    CHECK( oss.str() == "total accesses: 10\nhit rate: 70%\nmiss rate: 30%\ncompulsory miss rate: 33.3333%\n"
+                        "capacity miss rate: 66.6667%\nconflict miss rate: 0%\n" );
 }
 
 TEST_CASE("CacheRunner: run a test trace")
 {
     auto cache = CacheTagArray::create( "LRU", 2048, 8, 64, 32);
-    auto r = CacheRunner::create( cache.get())->run( TEST_PATH "/mem_trace.json");
+    auto r = CacheRunner::create( cache.get(), 2048, 64)->run( TEST_PATH "/mem_trace.json");
     CHECK( r.accesses == 4);
     CHECK( r.hits == 1);
     CHECK( r.compulsory_misses == 3);
@@ -39,14 +49,232 @@ TEST_CASE("CacheRunner: run a test trace")
 TEST_CASE("CacheRunner: invalid JSON")
 {
     auto cache = CacheTagArray::create( "LRU", 2048, 8, 64, 32);
-    CHECK_THROWS_AS( CacheRunner::create( cache.get())->run( TEST_PATH "/topology_root_test.json"), std::runtime_error);
+    CHECK_THROWS_AS( CacheRunner::create( cache.get(), 2048, 64)->run( TEST_PATH "/topology_root_test.json"), std::runtime_error);
 }
 
 TEST_CASE("CacheRunner: small cache")
 {
     auto cache = CacheTagArray::create( "LRU", 64, 1, 64, 32);
-    auto r = CacheRunner::create( cache.get())->run( TEST_PATH "/mem_trace.json");
+    auto r = CacheRunner::create( cache.get(), 64, 64)->run( TEST_PATH "/mem_trace.json");
     CHECK( r.accesses == 4);
     CHECK( r.hits == 0);
     CHECK( r.compulsory_misses == 3);
+    CHECK( r.capacity_misses == 1);
+    CHECK( r.conflict_misses == 0);
+}
+
+TEST_CASE("CacheRunner: conflict and capacity misses")
+{
+    {
+        // lines 0 and 2 share a set of a direct-mapped cache of 2 lines
+        BinaryTraceWriter writer( "binary_trace_test.bin", false);
+        for ( const Addr addr : { 0x0, 0x88, 0x4, 0x80, 0x40, 0xc0, 0x100, 0x0})
+            writer.write( addr);
+    }
+    auto cache = CacheTagArray::create( "LRU", 128, 1, 64, 32);
+    auto r = CacheRunner::create( cache.get(), 128, 64)->run( "binary_trace_test.bin");
+    CHECK( r.accesses == 8);
+    CHECK( r.hits == 0);
+    CHECK( r.compulsory_misses == 5);
+    CHECK( r.conflict_misses == 2);
+    CHECK( r.capacity_misses == 1);
+    std::remove( "binary_trace_test.bin");
+}
+
+TEST_CASE("Binary trace: round trip")
+{
+    const std::vector<MemoryAccess> accesses = {
+        { 0x87880, false, 4}, { 0x3240, true, 8}, { 0xffff'ffff'ffff'fff0, false, 1}, { 0, true, 127}, { 0x3240, false, 2}
+    };
+    {
+        BinaryTraceWriter writer( "binary_trace_test.bin", true);
+        for ( const auto& access : accesses)
+            writer.write( access);
+    }
+
+    BinaryTraceReader reader( "binary_trace_test.bin");
+    CHECK( reader.has_access_types());
+    MemoryAccess access;
+    for ( const auto& expected : accesses) {
+        CHECK( reader.read( &access));
+        CHECK( access.addr == expected.addr);
+        CHECK( access.is_write == expected.is_write);
+        CHECK( access.size == expected.size);
+    }
+    CHECK( !reader.read( &access));
+    std::remove( "binary_trace_test.bin");
+}
+
+TEST_CASE("Binary trace: converted trace gives the same results")
+{
+    convert_json_trace( TEST_PATH "/mem_trace.json", "binary_trace_test.bin");
+    CHECK( BinaryTraceReader::is_binary_trace( "binary_trace_test.bin"));
+    CHECK( !BinaryTraceReader::is_binary_trace( TEST_PATH "/mem_trace.json"));
+    CHECK( !BinaryTraceReader( "binary_trace_test.bin").has_access_types());
+
+    auto cache = CacheTagArray::create( "LRU", 2048, 8, 64, 32);
+    auto r = CacheRunner::create( cache.get(), 2048, 64)->run( "binary_trace_test.bin");
+    CHECK( r.accesses == 4);
+    CHECK( r.hits == 1);
+    CHECK( r.compulsory_misses == 3);
+    std::remove( "binary_trace_test.bin");
+}
+
+TEST_CASE("Binary trace: invalid files")
+{
+    CHECK_THROWS_AS( BinaryTraceReader( "no_such_trace.bin"), BinaryTraceException);
+    CHECK_THROWS_AS( BinaryTraceReader( TEST_PATH "/mem_trace.json"), BinaryTraceException);
+
+    {
+        BinaryTraceWriter writer( "binary_trace_test.bin", true);
+        writer.write( 0x1000);
+    }
+
+    // cut the access type of the last record
+    std::ifstream in( "binary_trace_test.bin", std::ios::binary);
+    std::vector<char> data( ( std::istreambuf_iterator<char>( in)), std::istreambuf_iterator<char>());
+    in.close();
+    data.pop_back();
+    std::ofstream( "binary_trace_test.bin", std::ios::binary).write( data.data(), narrow_cast<std::streamsize>( data.size()));
+
+    BinaryTraceReader reader( "binary_trace_test.bin");
+    MemoryAccess access;
+    CHECK_THROWS_AS( reader.read( &access), BinaryTraceException);
+    std::remove( "binary_trace_test.bin");
+}
+
+TEST_CASE("Cache sweep: same hits as LRU caches")
+{
+    const std::vector<uint32> sizes = { 1024, 4096, 16384};
+    const std::vector<uint32> ways = { 1, 2, 4, 16, 64};
+    CacheSweep sweep( sizes, ways, 64);
+
+    std::vector<std::unique_ptr<CacheTagArray>> caches;
+    for ( const auto size : sizes)
+        for ( const auto way : ways)
+            if ( way * 64 <= size)
+                caches.push_back( CacheTagArray::create( "LRU", size, way, 64, 32));
+
+    // mix of a hot region and a larger cold one
+    std::mt19937 engine( 7);
+    std::uniform_int_distribution<Addr> hot( 0, 0x2000);
+    std::uniform_int_distribution<Addr> cold( 0x10000, 0x40000);
+    std::vector<uint64> hits( caches.size());
+    for ( int i = 0; i < 20000; ++i) {
+        const auto addr = i % 3 == 0 ? cold( engine) : hot( engine);
+        sweep.access( addr);
+        for ( size_t j = 0; j < caches.size(); ++j) {
+            if ( caches[ j]->lookup( addr))
+                ++hits[ j];
+            else
+                caches[ j]->write( addr);
+        }
+    }
+
+    std::ostringstream expected;
+    expected << "size,ways,sets,accesses,hits,hit_rate" << std::endl;
+    size_t j = 0;
+    for ( const auto size : sizes)
+        for ( const auto way : ways)
+            if ( way * 64 <= size) {
+                expected << size << ',' << way << ',' << size / way / 64 << ",20000," << hits[ j] << ','
+                         << double( hits[ j]) / 20000 << std::endl;
+                ++j;
+            }
+
+    std::ostringstream oss;
+    sweep.dump_csv( oss);
+    CHECK( oss.str() == expected.str());
+}
+
+TEST_CASE("Cache sweep: invalid grid")
+{
+    CHECK_THROWS_AS( CacheSweep( { 1024}, { 1}, 48), CacheSweepException);
+    CHECK_THROWS_AS( CacheSweep( { 3072}, { 1}, 64), CacheSweepException);
+    CHECK_NOTHROW( CacheSweep( { 3072}, { 3}, 64));
+}
+
+TEST_CASE("Parallel cache sweep: same hits as sequential runs")
+{
+    std::mt19937 engine( 11);
+    std::uniform_int_distribution<Addr> addresses( 0, 0x8000);
+    {
+        // more than one chunk
+        BinaryTraceWriter writer( "binary_trace_test.bin", false);
+        for ( int i = 0; i < 100000; ++i)
+            writer.write( addresses( engine) * 4);
+    }
+
+    const std::vector<uint32> sizes = { 2048, 8192};
+    const std::vector<uint32> ways = { 2, 4, 8};
+    for ( const std::string policy : { "pseudo-LRU", "SRRIP", "random"}) {
+        ParallelCacheSweep sweep( policy, sizes, ways, 64, 4);
+        sweep.run( "binary_trace_test.bin");
+        std::ostringstream oss;
+        sweep.dump_csv( oss);
+
+        std::ostringstream expected;
+        expected << "size,ways,sets,accesses,hits,hit_rate,near_insertions,distant_insertions,srrip_wins,brrip_wins" << std::endl;
+        for ( const auto size : sizes)
+            for ( const auto way : ways) {
+                auto cache = CacheTagArray::create( policy, size, way, 64, 32);
+                auto r = CacheRunner::create( cache.get(), size, 64)->run( "binary_trace_test.bin");
+                expected << size << ',' << way << ',' << size / way / 64 << ',' << r.accesses << ',' << r.hits << ','
+                         << r.get_hit_rate() << ',' << r.replacement.near_insertions << ','
+                         << r.replacement.distant_insertions << ",0,0" << std::endl;
+            }
+        CHECK( oss.str() == expected.str());
+    }
+    std::remove( "binary_trace_test.bin");
+}
+
+TEST_CASE("Parallel cache sweep: invalid trace")
+{
+    ParallelCacheSweep sweep( "FIFO", { 2048}, { 2, 4}, 64, 2);
+    CHECK_THROWS_AS( sweep.run( "no_such_trace.bin"), std::exception);
+}
+
+TEST_CASE("Async cache runner: same results as sequential run")
+{
+    std::mt19937 engine;
+    std::uniform_int_distribution<Addr> addresses( 0, 0x8000);
+    std::vector<MemoryAccess> accesses;
+    for ( size_t i = 0; i < 100'000; ++i)
+        accesses.push_back( MemoryAccess{ addresses( engine), i % 3 == 0, 4});
+
+    {
+        BinaryTraceWriter writer( "binary_trace_test.bin", true);
+        for ( const auto& access : accesses)
+            writer.emit( access);
+    }
+    auto cache = CacheTagArray::create( "LRU", 2048, 4, 64, 32);
+    const auto expected = CacheRunner::create( cache.get(), 2048, 64)->run( "binary_trace_test.bin");
+
+    AsyncCacheRunner runner( "LRU", 2048, 4, 64);
+    for ( const auto& access : accesses)
+        runner.emit( access);
+
+    const auto r = runner.finish();
+    CHECK( r.accesses == 100'000);
+    CHECK( r.hits == expected.hits);
+    CHECK( r.compulsory_misses == expected.compulsory_misses);
+    CHECK( r.capacity_misses == expected.capacity_misses);
+    CHECK( r.conflict_misses == expected.conflict_misses);
+    std::remove( "binary_trace_test.bin");
+}
+
+TEST_CASE("Async cache runner: partial batch right before finish")
+{
+    for ( size_t i = 0; i < 1000; ++i) {
+        AsyncCacheRunner runner( "LRU", 2048, 4, 64);
+        for ( Addr addr = 0; addr < 16; ++addr)
+            runner.emit( MemoryAccess{ addr * 64, false, 4});
+
+        CHECK( runner.finish().accesses == 16);
+    }
+}
+
+TEST_CASE("Async cache runner: invalid cache")
+{
+    CHECK_THROWS_AS( AsyncCacheRunner( "LRU", 2048, 3, 64), std::exception);
 }
@@ -5,29 +5,159 @@
  */
 
 /* Simulator modules. */
+#include <export/cache/async_runner.h>
+#include <export/cache/binary_trace.h>
+#include <infra/cache/cache_hierarchy.h>
 #include <infra/config/config.h>
 #include <infra/config/main_wrapper.h>
+#include <func_sim/multi_hart.h>
+#include <func_sim/profiler/profiler.h>
 #include <kernel/kernel.h>
 #include <memory/memory.h>
+#include <modules/core/multi_core.h>
 #include <simulator.h>
 
+#include <fstream>
+#include <iostream>
+
 namespace config {
     static const AliasedRequiredValue<std::string> binary_filename = { "b", "binary", "input binary file"};
     static const AliasedValue<uint64> num_steps = { "n", "numsteps", MAX_VAL64, "number of instructions to run"};
     static const Value<std::string> trap_mode = { "trap_mode",  "", "trap handler mode"};
+    static const Value<uint32> cores = { "cores", 1, "number of simulated cores"};
+    static const Value<uint64> quantum = { "quantum", 1000, "number of cycles (instructions in functional mode) between synchronizations of cores"};
+    static const Value<std::string> memory_ordering = { "memory-ordering", "deterministic", "ordering of memory accesses of functional harts: deterministic or relaxed"};
+    static const Value<std::string> instruction_trace = { "trace-instructions", "", "binary trace file of instruction fetches"};
+    static const Value<std::string> data_trace = { "trace-data", "", "binary trace file of data accesses"};
+    static const Switch trace_caches = { "trace-caches", "simulate configured L1 caches on the fly instead of writing trace files"};
+    static const Value<std::string> profile = { "profile", "", "file of the flat profile of the guest program"};
+    static const Value<std::string> folded_stacks = { "folded-stacks", "", "file of folded call stacks of the guest program for flame graphs"};
 } // namespace config
 
+static std::shared_ptr<AsyncCacheRunner> create_async_runner( const CacheParameters& parameters)
+{
+    return std::make_shared<AsyncCacheRunner>( parameters.type, parameters.size_in_bytes, parameters.ways, parameters.line_size);
+}
+
+static std::shared_ptr<MemoryTraceSink> create_trace_writer( const std::string& filename)
+{
+    if ( filename.empty())
+        return nullptr;
+
+    return std::make_shared<BinaryTraceWriter>( filename, true);
+}
+
 class Main : public MainWrapper
 {
     using MainWrapper::MainWrapper;
 private:
     // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays, hicpp-avoid-c-arrays)
     int impl( int argc, const char* argv[]) const final; 
+    static int run_multi_core();
+    static int run_multi_hart();
+    static int run_traced_caches( Simulator* sim);
+    static int run_profiled( Simulator* sim, const Kernel& kernel);
+    static void check_profiler_options();
 };
 
+int Main::run_multi_core()
+{
+    auto memory = FuncMemory::create_default_hierarchied_memory();
+
+    MultiCoreSimulator sim( Simulator::get_configured_isa(), config::cores, config::quantum);
+    sim.set_memory( memory);
+    for ( size_t i = 0; i < sim.get_cores_num(); ++i) {
+        sim.set_kernel( i, Kernel::create_configured_kernel());
+        sim.get_core( i)->write_csr_register( "mscratch", 0x400'0000);
+    }
+
+    sim.load_file( config::binary_filename);
+    sim.run( config::num_steps);
+    return sim.get_exit_code();
+}
+
+int Main::run_multi_hart()
+{
+    auto memory = FuncMemory::create_default_hierarchied_memory();
+
+    MultiHartSimulator sim( Simulator::get_configured_isa(), config::cores, config::quantum,
+                            MultiHartSimulator::get_memory_ordering( config::memory_ordering));
+    sim.set_memory( memory);
+    for ( size_t i = 0; i < sim.get_harts_num(); ++i) {
+        sim.set_kernel( i, Kernel::create_configured_kernel());
+        sim.get_hart( i)->write_csr_register( "mscratch", 0x400'0000);
+    }
+
+    sim.load_file( config::binary_filename);
+    sim.run( config::num_steps);
+    return sim.get_exit_code();
+}
+
+int Main::run_traced_caches( Simulator* sim)
+{
+    auto icache = create_async_runner( CacheHierarchy::get_configured_l1i_parameters());
+    auto dcache = create_async_runner( CacheHierarchy::get_configured_l1d_parameters());
+    sim->set_memory_trace( icache, dcache);
+    sim->run( config::num_steps);
+
+    std::cout << "instruction cache:" << std::endl << icache->finish()
+              << "data cache:" << std::endl << dcache->finish();
+    return sim->get_exit_code();
+}
+
+static std::ofstream open_profile_file( const std::string& filename)
+{
+    if ( filename.empty())
+        return std::ofstream();
+
+    std::ofstream out( filename);
+    if ( !out.is_open())
+        throw InvalidProfileFile( filename);
+
+    return out;
+}
+
+int Main::run_profiled( Simulator* sim, const Kernel& kernel)
+{
+    // Files are opened before the simulation, so a wrong path does not waste a run
+    auto profile = open_profile_file( config::profile);
+    auto folded_stacks = open_profile_file( config::folded_stacks);
+
+    auto profiler = std::make_shared<GuestProfiler>( kernel.get_symbols());
+    sim->set_profiler( profiler);
+    sim->run( config::num_steps);
+
+    if ( profile.is_open())
+        profiler->dump_flat( profile);
+
+    if ( folded_stacks.is_open())
+        profiler->dump_folded( folded_stacks);
+
+    return sim->get_exit_code();
+}
+
+// Profiler observes a single simulator which retires instructions itself
+void Main::check_profiler_options()
+{
+    const std::string& profile = config::profile;
+    const std::string& folded_stacks = config::folded_stacks;
+    if ( profile.empty() && folded_stacks.empty())
+        return;
+
+    if ( config::cores > 1)
+        throw config::InvalidOption( "profiling is not supported with several cores");
+
+    if ( config::trace_caches)
+        throw config::InvalidOption( "profiling is not supported with traced caches");
+}
+
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays, modernize-avoid-c-arrays, hicpp-avoid-c-arrays)
 int Main::impl( int argc, const char* argv[]) const {
     config::handleArgs( argc, argv, 1);
+    check_profiler_options();
+    if ( config::cores > 1)
+        return Simulator::is_configured_functional_only() ? run_multi_hart() : run_multi_core();
+
     auto memory = FuncMemory::create_default_hierarchied_memory();
 
     auto sim = Simulator::create_configured_simulator();
@@ -42,6 +172,23 @@ int Main::impl( int argc, const char* argv[]) const {
     sim->set_kernel( kernel);
 
     sim->set_pc( kernel->get_start_pc());
+    const std::string& instruction_trace = config::instruction_trace;
+    const std::string& data_trace = config::data_trace;
+    if ( config::trace_caches) {
+        if ( !instruction_trace.empty() || !data_trace.empty())
+            throw config::InvalidOption( "traces are consumed by caches, trace files are not written");
+
+        return run_traced_caches( sim.get());
+    }
+
+    if ( !instruction_trace.empty() || !data_trace.empty())
+        sim->set_memory_trace( create_trace_writer( instruction_trace), create_trace_writer( data_trace));
+
+    const std::string& profile = config::profile;
+    const std::string& folded_stacks = config::folded_stacks;
+    if ( !profile.empty() || !folded_stacks.empty())
+        return run_profiled( sim.get(), *kernel);
+
     sim->run( config::num_steps);
     return sim->get_exit_code();
 }
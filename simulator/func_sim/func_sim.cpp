@@ -43,13 +43,20 @@ void FuncSim<ISA>::update_and_check_nop_counter( const FuncInstr& instr)
 template <typename ISA>
 typename FuncSim<ISA>::FuncInstr FuncSim<ISA>::step()
 {
+    if ( instruction_trace != nullptr)
+        instruction_trace->emit( MemoryAccess{ pc[0], false, 4});
+
     FuncInstr instr = imem.fetch_instr( pc[0]);
     instr.set_sequence_id(sequence_id);
     sequence_id++;
     rf.read_sources( &instr);
     instr.execute();
     mem->load_store( &instr);
+    if ( data_trace != nullptr && instr.has_memory_address())
+        data_trace->emit( MemoryAccess{ instr.get_mem_addr(), instr.is_store(), narrow_cast<uint8>( instr.get_mem_size())});
     rf.write_dst( instr);
+    if ( profiler != nullptr)
+        profiler->retire( instr);
     update_pc( instr);
     update_and_check_nop_counter( instr);
     return instr;
@@ -86,6 +93,7 @@ Trap FuncSim<ISA>::run( uint64 instrs_to_run)
     nops_in_a_row = 0;
     for ( uint64 i = 0; i < instrs_to_run; ++i) {
         auto instr = step();
+        ++executed_instrs;
         sout << instr << std::endl;
         kernel->handle_instruction( &instr);
         auto result_trap = driver_step( instr);
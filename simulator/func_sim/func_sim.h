@@ -8,10 +8,12 @@
 #define FUNC_SIM_H
 
 #include "instr_memory.h"
+#include "profiler/profiler.h"
 #include "rf/rf.h"
 
 #include <infra/config/config.h>
 #include <infra/exception.h>
+#include <infra/memory_trace.h>
 #include <memory/memory.h>
 #include <simulator.h>
 
@@ -37,10 +39,14 @@ class FuncSim : public BasicFuncSim
     private:
         RF<FuncInstr> rf;
         uint64 sequence_id = 0;
+        uint64 executed_instrs = 0;
         std::shared_ptr<FuncMemory> mem;
         InstrMemoryCached<ISA> imem;
         std::shared_ptr<Kernel> kernel;
         std::unique_ptr<Driver> driver;
+        std::shared_ptr<MemoryTraceSink> instruction_trace;
+        std::shared_ptr<MemoryTraceSink> data_trace;
+        std::shared_ptr<GuestProfiler> profiler;
 
         std::array<Addr, 8> pc = {};
         size_t delayed_slots = 0;
@@ -59,7 +65,14 @@ class FuncSim : public BasicFuncSim
         void set_kernel( std::shared_ptr<Kernel> k) final { kernel = std::move( k); }
         void enable_driver_hooks() final;
         void disable_checker() final { };
+        void set_memory_trace( std::shared_ptr<MemoryTraceSink> instructions, std::shared_ptr<MemoryTraceSink> data) final
+        {
+            instruction_trace = std::move( instructions);
+            data_trace = std::move( data);
+        }
+        void set_profiler( std::shared_ptr<GuestProfiler> value) final { profiler = std::move( value); }
         int get_exit_code() const noexcept final;
+        uint64 get_executed_instrs() const final { return executed_instrs; }
         FuncInstr step();
         Trap driver_step( const Operation& instr);
         Trap run( uint64 instrs_to_run) final;
@@ -0,0 +1,270 @@
+/*
+ * multi_hart.cpp - several functional simulators over a shared memory
+ * executed in parallel on host threads
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "multi_hart.h"
+
+#include <kernel/kernel.h>
+#include <memory/locked_memory.h>
+#include <memory/quantum_memory.h>
+
+#include <algorithm>
+#include <barrier>
+#include <iostream>
+#include <thread>
+
+MultiHartSimulator::MultiHartSimulator( const std::string& isa, size_t num_harts, uint64 quantum, MemoryOrdering ordering)
+    : Root( "multihart")
+    , harts( num_harts)
+    , quantum( quantum)
+    , ordering( ordering)
+{
+    if ( num_harts == 0)
+        throw InvalidMultiHartConfig( "number of harts should be greater than zero");
+
+    if ( quantum == 0)
+        throw InvalidMultiHartConfig( "synchronization quantum should be greater than zero");
+
+    for ( auto& hart : harts)
+        hart.sim = Simulator::create_functional_simulator( isa);
+
+    register_statistics();
+}
+
+MultiHartSimulator::~MultiHartSimulator() = default;
+
+MemoryOrdering MultiHartSimulator::get_memory_ordering( const std::string& name)
+{
+    if ( name == "deterministic")
+        return MemoryOrdering::DETERMINISTIC;
+    if ( name == "relaxed")
+        return MemoryOrdering::RELAXED;
+
+    throw InvalidMultiHartConfig( "unknown memory ordering '" + name + "', use 'deterministic' or 'relaxed'");
+}
+
+void MultiHartSimulator::set_memory( const std::shared_ptr<FuncMemory>& memory)
+{
+    if ( ordering == MemoryOrdering::RELAXED) {
+        auto locked = std::make_shared<LockedMemory>( memory);
+        for ( auto& hart : harts) {
+            hart.memory = locked;
+            hart.sim->set_memory( locked);
+        }
+        return;
+    }
+
+    for ( auto& hart : harts) {
+        hart.quantum_memory = std::make_shared<QuantumMemory>( memory);
+        hart.memory = hart.quantum_memory;
+        hart.sim->set_memory( hart.memory);
+    }
+}
+
+void MultiHartSimulator::set_kernel( size_t hart_id, const std::shared_ptr<Kernel>& kernel)
+{
+    auto& hart = harts.at( hart_id);
+    if ( hart.memory == nullptr)
+        throw InvalidMultiHartConfig( "memory should be set before kernels");
+
+    hart.kernel = kernel;
+    kernel->set_simulator( hart.sim);
+    kernel->connect_memory( hart.memory);
+    kernel->connect_exception_handler();
+    hart.sim->set_kernel( kernel);
+    hart.sim->write_csr_register( "mhartid", hart_id);
+}
+
+void MultiHartSimulator::load_file( const std::string& name)
+{
+    const auto& kernel = harts.front().kernel;
+    if ( kernel == nullptr)
+        throw InvalidMultiHartConfig( "kernel of hart 0 should be set to load a file");
+
+    kernel->load_file( name);
+    set_pc( kernel->get_start_pc());
+}
+
+void MultiHartSimulator::set_pc( Addr pc)
+{
+    for ( auto& hart : harts)
+        hart.sim->set_pc( pc);
+}
+
+void MultiHartSimulator::run_quantum( Hart* hart) const
+{
+    if ( hart->halted)
+        return;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    try {
+        const auto executed = hart->sim->get_executed_instrs();
+        const auto instrs = std::min( quantum, hart->instrs_to_run - executed);
+        const auto trap = hart->sim->run( instrs);
+        const auto executed_in_quantum = hart->sim->get_executed_instrs() - executed;
+
+        // Breakpoint is also returned when the quantum is over
+        if ( trap != Trap::BREAKPOINT || executed_in_quantum < instrs || executed + instrs == hart->instrs_to_run) {
+            hart->trap = trap;
+            hart->halted = true;
+        }
+    }
+    catch (...) {
+        hart->exception = std::current_exception();
+        hart->halted = true;
+    }
+    hart->busy_time += std::chrono::high_resolution_clock::now() - start;
+}
+
+void MultiHartSimulator::run_relaxed( Hart* hart) const
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    try {
+        hart->trap = hart->sim->run( hart->instrs_to_run - hart->sim->get_executed_instrs());
+    }
+    catch (...) {
+        hart->exception = std::current_exception();
+    }
+    hart->halted = true;
+    hart->busy_time += std::chrono::high_resolution_clock::now() - start;
+}
+
+void MultiHartSimulator::commit_stores()
+{
+    for ( auto& hart : harts)
+        if ( hart.quantum_memory != nullptr)
+            hart.quantum_memory->commit();
+}
+
+void MultiHartSimulator::end_quantum() noexcept
+{
+    // Barrier completion is executed by a single thread,
+    // so the shared memory is updated deterministically
+    try {
+        commit_stores();
+    }
+    catch (...) {
+        commit_exception = std::current_exception();
+    }
+
+    ++quantums;
+    finished = commit_exception != nullptr
+        || std::all_of( harts.begin(), harts.end(), []( const auto& hart) { return hart.halted; })
+        || std::any_of( harts.begin(), harts.end(), []( const auto& hart) { return hart.exception != nullptr; });
+}
+
+Trap MultiHartSimulator::run( uint64 instrs_to_run)
+{
+    commit_stores(); // Apply stores issued by loaders and kernels
+    for ( auto& hart : harts) {
+        const auto executed = hart.sim->get_executed_instrs();
+        hart.instrs_to_run = executed + std::min( instrs_to_run, MAX_VAL64 - executed);
+        hart.trap = Trap( Trap::NO_TRAP);
+        hart.halted = false;
+        hart.exception = nullptr;
+    }
+
+    finished = false;
+    auto start = std::chrono::high_resolution_clock::now();
+    if ( ordering == MemoryOrdering::RELAXED) {
+        std::vector<std::jthread> threads;
+        threads.reserve( harts.size());
+        for ( auto& hart : harts)
+            threads.emplace_back( [this, &hart]() { run_relaxed( &hart); });
+    }
+    else {
+        std::barrier sync( narrow_cast<std::ptrdiff_t>( harts.size()), [this]() noexcept { end_quantum(); });
+        std::vector<std::jthread> threads;
+        threads.reserve( harts.size());
+        for ( auto& hart : harts)
+            threads.emplace_back( [this, &hart, &sync]() {
+                while ( !finished) {
+                    run_quantum( &hart);
+                    sync.arrive_and_wait();
+                }
+            });
+    }
+    wall_time = std::chrono::high_resolution_clock::now() - start;
+
+    dump_statistics();
+
+    if ( commit_exception != nullptr)
+        std::rethrow_exception( commit_exception);
+
+    for ( const auto& hart : harts)
+        if ( hart.exception != nullptr)
+            std::rethrow_exception( hart.exception);
+
+    return get_result_trap();
+}
+
+Trap MultiHartSimulator::get_result_trap() const
+{
+    // Report the first unusual stop, otherwise all harts halted normally
+    for ( const auto& hart : harts)
+        if ( hart.trap != Trap::HALT)
+            return hart.trap;
+
+    return Trap( Trap::HALT);
+}
+
+int MultiHartSimulator::get_exit_code() const noexcept
+{
+    for ( const auto& hart : harts)
+        if ( hart.sim->get_exit_code() != 0)
+            return hart.sim->get_exit_code();
+
+    return 0;
+}
+
+uint64 MultiHartSimulator::get_executed_instrs() const noexcept
+{
+    uint64 instrs = 0;
+    for ( const auto& hart : harts)
+        instrs += hart.sim->get_executed_instrs();
+    return instrs;
+}
+
+double MultiHartSimulator::get_busy_time() const noexcept
+{
+    double time = 0;
+    for ( const auto& hart : harts)
+        time += hart.busy_time.count();
+    return time;
+}
+
+void MultiHartSimulator::register_statistics()
+{
+    const auto get_instrs = [this]() { return 1.0 * get_executed_instrs(); };
+    const auto get_time = [this]() { return wall_time.count(); };
+
+    make_formula( "harts", "", [this]() { return 1.0 * harts.size(); });
+    if ( ordering == MemoryOrdering::DETERMINISTIC) {
+        make_formula( "quantum", "instructions between synchronizations of harts", [this]() { return 1.0 * quantum; });
+        make_formula( "quantums", "", [this]() { return 1.0 * quantums; });
+    }
+    make_formula( "instrs", "instructions executed by all harts", get_instrs);
+    make_formula( "sim_ips", "executed instructions per host millisecond, kips", [=]() { return get_instrs() / get_time(); });
+    make_formula( "host_time", "host milliseconds", get_time);
+    make_formula( "host_threads", "", []() { return 1.0 * std::thread::hardware_concurrency(); });
+    make_formula( "speedup", "host time of all harts over the elapsed host time", [=, this]() { return get_busy_time() / get_time(); });
+
+    for ( size_t i = 0; i < harts.size(); ++i) {
+        const auto prefix = "hart" + std::to_string( i) + ".";
+        make_formula( prefix + "instrs", "", [this, i]() { return 1.0 * harts[i].sim->get_executed_instrs(); });
+        make_formula( prefix + "busy_time", "host milliseconds spent on executing the hart", [this, i]() { return harts[i].busy_time.count(); });
+    }
+}
+
+// Ordering is not a number, so it is not a part of the statistics
+void MultiHartSimulator::dump_statistics() const
+{
+    std::cout << std::endl << "****************************" << std::endl;
+    statistics_dumping( std::cout);
+    std::cout << "ordering: " << ( ordering == MemoryOrdering::RELAXED ? "relaxed" : "deterministic")
+              << std::endl << "****************************" << std::endl;
+
+    statistics_dumping( config::stats_json);
+}
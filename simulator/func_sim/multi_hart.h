@@ -0,0 +1,103 @@
+/*
+ * multi_hart.h - several functional simulators over a shared memory
+ * executed in parallel on host threads
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef MULTI_HART_H
+#define MULTI_HART_H
+
+#include <infra/exception.h>
+#include <infra/ports/module.h>
+#include <simulator.h>
+
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+class FuncMemory;
+class Kernel;
+class QuantumMemory;
+
+struct InvalidMultiHartConfig final : Exception
+{
+    explicit InvalidMultiHartConfig( const std::string& msg)
+        : Exception("Invalid multi-hart configuration", msg)
+    { }
+};
+
+/*
+ * Memory ordering between harts:
+ *  - DETERMINISTIC: harts execute 'quantum' instructions and synchronize on a barrier,
+ *    stores of a quantum become visible to other harts at the barrier in the order of hart ids.
+ *    Simulation is replayed exactly on each run regardless of host scheduling.
+ *  - RELAXED: harts run freely, a store is visible to other harts immediately.
+ *    Interleaving of harts depends on host scheduling.
+ */
+enum class MemoryOrdering
+{
+    DETERMINISTIC,
+    RELAXED
+};
+
+class MultiHartSimulator : public Root
+{
+public:
+    MultiHartSimulator( const std::string& isa, size_t num_harts, uint64 quantum, MemoryOrdering ordering);
+    ~MultiHartSimulator() override;
+    MultiHartSimulator( const MultiHartSimulator&) = delete;
+    MultiHartSimulator( MultiHartSimulator&&) = delete;
+    MultiHartSimulator& operator=( const MultiHartSimulator&) = delete;
+    MultiHartSimulator& operator=( MultiHartSimulator&&) = delete;
+
+    static MemoryOrdering get_memory_ordering( const std::string& name);
+
+    void set_memory( const std::shared_ptr<FuncMemory>& memory);
+    void set_kernel( size_t hart_id, const std::shared_ptr<Kernel>& kernel);
+    void load_file( const std::string& name);
+    void set_pc( Addr pc);
+
+    Trap run( uint64 instrs_to_run);
+    Trap run_no_limit() { return run( MAX_VAL64); }
+
+    size_t get_harts_num() const noexcept { return harts.size(); }
+    Simulator* get_hart( size_t hart_id) const { return harts.at( hart_id).sim.get(); }
+    int get_exit_code() const noexcept;
+
+    void dump_statistics() const;
+
+private:
+    struct Hart
+    {
+        std::shared_ptr<Simulator> sim;
+        std::shared_ptr<FuncMemory> memory;
+        std::shared_ptr<QuantumMemory> quantum_memory; // only for deterministic ordering
+        std::shared_ptr<Kernel> kernel;
+        std::chrono::duration<double, std::milli> busy_time{};
+        std::exception_ptr exception = nullptr;
+        Trap trap = Trap( Trap::NO_TRAP);
+        uint64 instrs_to_run = 0;
+        bool halted = false;
+    };
+
+    void run_quantum( Hart* hart) const;
+    void run_relaxed( Hart* hart) const;
+    void end_quantum() noexcept;
+    void commit_stores();
+    Trap get_result_trap() const;
+    void register_statistics();
+    uint64 get_executed_instrs() const noexcept;
+    double get_busy_time() const noexcept;
+
+    std::vector<Hart> harts;
+    const uint64 quantum;
+    const MemoryOrdering ordering;
+    uint64 quantums = 0;
+    bool finished = false;
+    std::exception_ptr commit_exception = nullptr;
+    std::chrono::duration<double, std::milli> wall_time{};
+};
+
+#endif // MULTI_HART_H
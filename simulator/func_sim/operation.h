@@ -73,17 +73,8 @@ class Operation
 public:
     Operation(Addr pc, Addr new_pc) : PC(pc), new_PC(new_pc) { }
 
-    void set_alu_number(uint8 number)
-    {
-        alu_number = number;
-    }
-
-    uint8 get_alu_number()
-    {
-        return alu_number;
-    }
-
     void set_type( OperationType type) { operation = type; }
+    std::string_view get_opname() const { return opname; }
 
     //target is known at ID stage and always taken
     bool is_direct_jump() const { return operation == OUT_J_JUMP; }
@@ -159,7 +150,6 @@ protected:
     Addr target = NO_VAL32;
 
 private:
-    uint8 alu_number = 0;
     OperationType operation = OUT_UNKNOWN;
     uint64 sequence_id = NO_VAL64;
 };
@@ -244,6 +234,16 @@ public:
     void set_src( R reg, size_t index) { src.at( index) = reg; }
     void set_dst( R reg, size_t index) { dst.at( index) = reg; }
 
+    // Jumps saving the return address are calls, indirect jumps to it are returns
+    bool is_call() const
+    {
+        return ( this->is_direct_jump() || this->is_indirect_jump()) && get_dst( 0) == R::return_address();
+    }
+    bool is_return() const
+    {
+        return this->is_indirect_jump() && get_src( 0) == R::return_address() && get_dst( 0) != R::return_address();
+    }
+
     std::ostream& dump_content( std::ostream& out, const std::string& disasm) const;
 
 protected:
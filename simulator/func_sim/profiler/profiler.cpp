@@ -0,0 +1,176 @@
+/*
+ * profiler.cpp - instruction-level profiler of guest software
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+
+GuestProfiler::GuestProfiler( SymbolTable symbols)
+    : symbols( std::move( symbols))
+    , nodes( 1)
+{
+    stack.reserve( MAX_DEPTH);
+}
+
+void GuestProfiler::count( Addr pc)
+{
+    if ( total.instrs == 0)
+        nodes[ ROOT].function = pc;
+
+    auto& counts = pcs[ pc];
+    ++counts.instrs;
+    counts.cycles += pending_cycles;
+
+    auto& node = nodes[ current].counts;
+    ++node.instrs;
+    node.cycles += pending_cycles;
+
+    ++total.instrs;
+    total.cycles += pending_cycles;
+    pending_cycles = 0;
+}
+
+void GuestProfiler::call( Addr target, Addr return_address)
+{
+    if ( stack.size() == MAX_DEPTH) {
+        ++lost_frames;
+        return;
+    }
+
+    const auto [it, is_new] = children.try_emplace( std::pair( current, target), nodes.size());
+    if ( is_new)
+        nodes.push_back( Node{ current, target, Counts()});
+
+    current = it->second;
+    stack.push_back( Frame{ current, return_address});
+}
+
+void GuestProfiler::return_to( Addr target)
+{
+    if ( lost_frames != 0) {
+        --lost_frames;
+        return;
+    }
+
+    // frames skipped by longjmp-like returns are popped as well
+    auto frame = std::find_if( stack.rbegin(), stack.rend(),
+                               [target]( const Frame& f) { return f.return_address == target; });
+    if ( frame != stack.rend())
+        stack.erase( std::prev( frame.base()), stack.end());
+    else if ( !stack.empty())
+        stack.pop_back();
+
+    current = stack.empty() ? ROOT : stack.back().node;
+}
+
+uint64 GuestProfiler::get_instrs( Addr pc) const
+{
+    const auto it = pcs.find( pc);
+    return it == pcs.end() ? 0 : it->second.instrs;
+}
+
+std::string GuestProfiler::get_function_name( Addr address) const
+{
+    const auto* symbol = symbols.find( address);
+    if ( symbol != nullptr)
+        return symbol->name;
+
+    std::ostringstream oss;
+    oss << "0x" << std::hex << address;
+    return oss.str();
+}
+
+template <typename Key>
+static void sort_by_weight( std::vector<std::pair<Key, uint64>>* rows)
+{
+    std::sort( rows->begin(), rows->end(), []( const auto& lhs, const auto& rhs) {
+        return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+    });
+}
+
+void GuestProfiler::dump_flat( std::ostream& out) const
+{
+    const bool has_cycles = total.cycles != 0;
+    const auto print_row = [&]( const std::string& name, const Counts& counts) {
+        out << std::left << std::setw( 32) << name << std::right
+            << std::setw( 14) << counts.instrs << std::setw( 8) << std::fixed << std::setprecision( 2)
+            << ( total.instrs != 0 ? 100.0 * counts.instrs / total.instrs : 0) << '%';
+        if ( has_cycles)
+            out << std::setw( 14) << counts.cycles << std::setw( 8) << 100.0 * counts.cycles / total.cycles << '%';
+        out << std::defaultfloat << '\n';
+    };
+    const auto print_header = [&]( const std::string& name) {
+        out << std::left << std::setw( 32) << name << std::right << std::setw( 14) << "instrs" << std::setw( 9) << "%";
+        if ( has_cycles)
+            out << std::setw( 14) << "cycles" << std::setw( 9) << "%";
+        out << '\n';
+    };
+
+    std::unordered_map<std::string, Counts> functions;
+    for ( const auto& [pc, counts] : pcs) {
+        const auto* symbol = symbols.find( pc);
+        auto& function = functions[ symbol != nullptr ? symbol->name : "[unknown]"];
+        function.instrs += counts.instrs;
+        function.cycles += counts.cycles;
+    }
+
+    std::vector<std::pair<std::string, uint64>> function_rows;
+    function_rows.reserve( functions.size());
+    for ( const auto& [name, counts] : functions)
+        function_rows.emplace_back( name, get_weight( counts));
+    sort_by_weight( &function_rows);
+
+    out << "Flat profile: " << total.instrs << " instructions";
+    if ( has_cycles)
+        out << ", " << total.cycles << " cycles";
+    out << "\n\n";
+
+    print_header( "function");
+    for ( const auto& row : function_rows)
+        print_row( row.first, functions.at( row.first));
+
+    std::vector<std::pair<Addr, uint64>> pc_rows;
+    pc_rows.reserve( pcs.size());
+    for ( const auto& [pc, counts] : pcs)
+        pc_rows.emplace_back( pc, get_weight( counts));
+    sort_by_weight( &pc_rows);
+
+    out << '\n';
+    print_header( "PC");
+    for ( const auto& row : pc_rows) {
+        std::ostringstream name;
+        name << "0x" << std::hex << row.first;
+        if ( symbols.find( row.first) != nullptr)
+            name << " " << symbols.symbolize( row.first);
+        print_row( name.str(), pcs.at( row.first));
+    }
+}
+
+void GuestProfiler::dump_folded( std::ostream& out) const
+{
+    std::vector<std::string> names;
+    names.reserve( nodes.size());
+    for ( const auto& node : nodes)
+        names.push_back( get_function_name( node.function));
+
+    std::vector<size_t> path;
+    for ( size_t i = 0; i < nodes.size(); ++i) {
+        const auto weight = get_weight( nodes[ i].counts);
+        if ( weight == 0)
+            continue;
+
+        path.clear();
+        for ( auto node = i; node != ROOT; node = nodes[ node].parent)
+            path.push_back( node);
+
+        out << names[ ROOT];
+        for ( auto node = path.rbegin(); node != path.rend(); ++node)
+            out << ';' << names[ *node];
+        out << ' ' << weight << '\n';
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * profiler.h - instruction-level profiler of guest software
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <infra/exception.h>
+#include <infra/types.h>
+#include <memory/elf/symbol_table.h>
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct InvalidProfileFile final : Exception
+{
+    explicit InvalidProfileFile( const std::string& filename)
+        : Exception( "Invalid profile file", "cannot open " + filename)
+    { }
+};
+
+/*
+ * Retired instructions and cycles are counted per PC and per call stack.
+ * Calls and returns are the jumps writing and reading the return address register,
+ * so the call stack of the guest is tracked without any debug information.
+ * Each call stack is a node of a tree, so counting an instruction is a hash lookup
+ * of the PC and an increment of the current node.
+ */
+class GuestProfiler
+{
+public:
+    explicit GuestProfiler( SymbolTable symbols);
+
+    template <typename Instr>
+    void retire( const Instr& instr)
+    {
+        count( instr.get_PC());
+        if ( instr.is_call())
+            call( instr.get_new_PC(), narrow_cast<Addr>( instr.get_v_dst( 0)));
+        else if ( instr.is_return())
+            return_to( instr.get_new_PC());
+    }
+
+    // cycles are charged to the next retired instruction
+    void add_cycle() noexcept { ++pending_cycles; }
+
+    void count( Addr pc);
+    void call( Addr target, Addr return_address);
+    void return_to( Addr target);
+
+    uint64 get_instrs() const noexcept { return total.instrs; }
+    uint64 get_cycles() const noexcept { return total.cycles; }
+    uint64 get_instrs( Addr pc) const;
+    size_t get_depth() const noexcept { return stack.size(); }
+
+    // functions and PCs sorted by cycles, or by instructions if cycles are not simulated
+    void dump_flat( std::ostream& out) const;
+
+    // 'caller;callee weight' lines for flame graphs, the weight is the same as in the flat profile
+    void dump_folded( std::ostream& out) const;
+
+private:
+    static constexpr const size_t MAX_DEPTH = 1024;
+    static constexpr const size_t ROOT = 0;
+
+    struct Counts
+    {
+        uint64 instrs = 0;
+        uint64 cycles = 0;
+    };
+
+    struct Node
+    {
+        size_t parent = ROOT;
+        Addr function = 0;
+        Counts counts;
+    };
+
+    struct Frame
+    {
+        size_t node = ROOT;
+        Addr return_address = 0;
+    };
+
+    struct ChildHash
+    {
+        size_t operator()( const std::pair<size_t, Addr>& key) const noexcept
+        {
+            return std::hash<Addr>()( key.second) ^ ( key.first * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    const SymbolTable symbols;
+    std::unordered_map<Addr, Counts> pcs;
+    Counts total;
+    uint64 pending_cycles = 0;
+
+    // the root node is the function where the simulation starts
+    std::vector<Node> nodes;
+    std::unordered_map<std::pair<size_t, Addr>, size_t, ChildHash> children;
+    std::vector<Frame> stack;
+    size_t current = ROOT;
+    size_t lost_frames = 0;
+
+    uint64 get_weight( const Counts& counts) const noexcept
+    {
+        return total.cycles != 0 ? counts.cycles : counts.instrs;
+    }
+
+    std::string get_function_name( Addr address) const;
+};
+
+#endif // PROFILER_H
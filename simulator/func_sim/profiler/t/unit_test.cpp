@@ -0,0 +1,148 @@
+/*
+ * Unit tests for the profiler of guest software
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include <catch.hpp>
+
+#include <func_sim/profiler/profiler.h>
+#include <kernel/kernel.h>
+#include <memory/memory.h>
+#include <simulator.h>
+
+#include <sstream>
+
+static SymbolTable get_symbols()
+{
+    return SymbolTable( { ElfSymbol{ 0x100, 0x100, "main"}, ElfSymbol{ 0x200, 0x20, "foo"}, ElfSymbol{ 0x220, 0x20, "bar"} });
+}
+
+TEST_CASE( "GuestProfiler: call and return")
+{
+    GuestProfiler profiler( get_symbols());
+    profiler.count( 0x100);
+    profiler.call( 0x200, 0x108);
+    profiler.count( 0x200);
+    profiler.count( 0x204);
+    CHECK( profiler.get_depth() == 1);
+    profiler.return_to( 0x108);
+    profiler.count( 0x108);
+
+    CHECK( profiler.get_depth() == 0);
+    CHECK( profiler.get_instrs() == 4);
+    CHECK( profiler.get_cycles() == 0);
+    CHECK( profiler.get_instrs( 0x204) == 1);
+    CHECK( profiler.get_instrs( 0x300) == 0);
+
+    std::ostringstream folded;
+    profiler.dump_folded( folded);
+    CHECK( folded.str() == "main 2\nmain;foo 2\n");
+
+    std::ostringstream flat;
+    profiler.dump_flat( flat);
+    CHECK_THAT( flat.str(), Catch::StartsWith( "Flat profile: 4 instructions\n")
+                         && Catch::Contains( "0x204 foo+0x4") && !Catch::Contains( "cycles"));
+}
+
+TEST_CASE( "GuestProfiler: cycles")
+{
+    GuestProfiler profiler( get_symbols());
+    profiler.add_cycle();
+    profiler.count( 0x100);
+    profiler.add_cycle();
+    profiler.add_cycle();
+    profiler.count( 0x104);
+    profiler.count( 0x500);
+
+    CHECK( profiler.get_cycles() == 3);
+
+    std::ostringstream folded;
+    profiler.dump_folded( folded);
+    CHECK( folded.str() == "main 3\n");
+
+    std::ostringstream flat;
+    profiler.dump_flat( flat);
+    CHECK_THAT( flat.str(), Catch::StartsWith( "Flat profile: 3 instructions, 3 cycles\n") && Catch::Contains( "[unknown]"));
+}
+
+TEST_CASE( "GuestProfiler: return skips frames")
+{
+    GuestProfiler profiler( get_symbols());
+    profiler.count( 0x100);
+    profiler.call( 0x200, 0x108);
+    profiler.count( 0x200);
+    profiler.call( 0x220, 0x208);
+    profiler.count( 0x220);
+    profiler.call( 0x220, 0x228);
+    profiler.count( 0x220);
+    CHECK( profiler.get_depth() == 3);
+
+    // longjmp-like return to main
+    profiler.return_to( 0x108);
+    CHECK( profiler.get_depth() == 0);
+
+    // unknown return address pops a single frame
+    profiler.call( 0x200, 0x110);
+    profiler.call( 0x220, 0x210);
+    profiler.return_to( 0x600);
+    CHECK( profiler.get_depth() == 1);
+    profiler.count( 0x204);
+
+    std::ostringstream folded;
+    profiler.dump_folded( folded);
+    CHECK( folded.str() == "main 1\nmain;foo 2\nmain;foo;bar 1\nmain;foo;bar;bar 1\n");
+}
+
+static auto run_profiled( const std::string& isa, bool functional_only, const std::string& binary)
+{
+    auto sim = Simulator::create_simulator( isa, functional_only);
+    auto mem = FuncMemory::create_default_hierarchied_memory();
+    sim->set_memory( mem);
+
+    std::istream nullin( nullptr);
+    std::ostream nullout( nullptr);
+    auto kernel = Kernel::create_kernel( true, nullin, nullout, nullout);
+    kernel->set_simulator( sim);
+    kernel->connect_memory( mem);
+    kernel->connect_exception_handler();
+    kernel->load_file( binary);
+    sim->set_kernel( kernel);
+    sim->set_pc( kernel->get_start_pc());
+
+    auto profiler = std::make_shared<GuestProfiler>( kernel->get_symbols());
+    sim->set_profiler( profiler);
+
+    OStreamWrapper cout_wrapper( std::cout, nullout);
+    CHECK( sim->run_no_limit() == Trap::HALT);
+    CHECK( profiler->get_instrs() == sim->get_executed_instrs());
+    return profiler;
+}
+
+TEST_CASE( "GuestProfiler: functional simulation")
+{
+    auto profiler = run_profiled( "mars", true, TEST_PATH "/mips/mips-tt-no-delayed-branches.bin");
+    CHECK( profiler->get_cycles() == 0);
+
+    std::ostringstream folded;
+    profiler->dump_folded( folded);
+    CHECK_THAT( folded.str(), Catch::StartsWith( "__start ") && Catch::Contains( ";strlen "));
+}
+
+TEST_CASE( "GuestProfiler: performance simulation")
+{
+    auto profiler = run_profiled( "mars", false, TEST_PATH "/mips/mips-tt-no-delayed-branches.bin");
+    CHECK( profiler->get_cycles() > profiler->get_instrs());
+
+    std::ostringstream flat;
+    profiler->dump_flat( flat);
+    CHECK_THAT( flat.str(), Catch::Contains( " cycles\n") && Catch::Contains( "strlen "));
+}
+
+TEST_CASE( "GuestProfiler: compressed calls and returns")
+{
+    auto profiler = run_profiled( "riscv64", true, TEST_PATH "/elf/qsort.riscv");
+
+    std::ostringstream folded;
+    profiler->dump_folded( folded);
+    CHECK_THAT( folded.str(), Catch::Contains( "\n_start;main;sort ") && !Catch::Contains( "sort;"));
+}
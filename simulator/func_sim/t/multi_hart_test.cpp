@@ -0,0 +1,95 @@
+/**
+ * Test for multi-hart Functional Simulation
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include <catch.hpp>
+
+#include <func_sim/multi_hart.h>
+#include <kernel/kernel.h>
+#include <memory/memory.h>
+
+static auto init( size_t num_harts, uint64 quantum, MemoryOrdering ordering, const std::vector<uint32>& program)
+{
+    auto mem = FuncMemory::create_default_hierarchied_memory();
+    for ( size_t i = 0; i < program.size(); ++i)
+        mem->write<uint32, std::endian::little>( program[i], 0x1000 + i * 4);
+
+    auto sim = std::make_unique<MultiHartSimulator>( "riscv32", num_harts, quantum, ordering);
+    sim->set_memory( mem);
+    for ( size_t i = 0; i < num_harts; ++i)
+        sim->set_kernel( i, Kernel::create_kernel( false, std::cin, std::cout, std::cerr));
+
+    sim->set_pc( 0x1000);
+    return std::pair( std::move( sim), mem);
+}
+
+// Redirect std::cout to /dev/null
+static auto run_silent( MultiHartSimulator* sim, uint64 steps)
+{
+    std::ostream nullout( nullptr);
+    OStreamWrapper cout_wrapper( std::cout, nullout);
+    return sim->run( steps);
+}
+
+static const std::vector<uint32> store_hart_id = {
+    0xf1402573, // csrr a0, mhartid
+    0x00251593, // slli a1, a0, 2
+    0x00150513, // addi a0, a0, 1
+    0x10a5a023, // sw a0, 0x100(a1)
+    0x0000006f, // j . (halts the hart)
+};
+
+static const std::vector<uint32> increment_counter = {
+    0x10002503, // lw a0, 0x100(zero)
+    0x00150513, // addi a0, a0, 1
+    0x10a02023, // sw a0, 0x100(zero)
+    0xff5ff06f, // j -12
+};
+
+TEST_CASE( "Multi_hart: invalid configuration")
+{
+    CHECK_THROWS_AS( MultiHartSimulator( "riscv32", 0, 100, MemoryOrdering::DETERMINISTIC), InvalidMultiHartConfig);
+    CHECK_THROWS_AS( MultiHartSimulator( "riscv32", 2, 0, MemoryOrdering::DETERMINISTIC), InvalidMultiHartConfig);
+    CHECK_THROWS_AS( MultiHartSimulator::get_memory_ordering( "sequential"), InvalidMultiHartConfig);
+    CHECK( MultiHartSimulator::get_memory_ordering( "relaxed") == MemoryOrdering::RELAXED);
+}
+
+TEST_CASE( "Multi_hart: hart ids")
+{
+    for ( auto ordering : { MemoryOrdering::DETERMINISTIC, MemoryOrdering::RELAXED }) {
+        auto [sim, mem] = init( 4, 3, ordering, store_hart_id);
+        for ( size_t i = 0; i < sim->get_harts_num(); ++i)
+            CHECK( sim->get_hart( i)->read_csr_register( "mhartid") == i);
+
+        CHECK( run_silent( sim.get(), 1000) == Trap::HALT);
+        for ( uint32 i = 0; i < 4; ++i)
+            CHECK( mem->read<uint32, std::endian::little>( 0x100 + i * 4) == i + 1);
+        CHECK( sim->get_exit_code() == 0);
+    }
+}
+
+TEST_CASE( "Multi_hart: instruction limit")
+{
+    auto [sim, mem] = init( 2, 7, MemoryOrdering::DETERMINISTIC, increment_counter);
+    CHECK( run_silent( sim.get(), 100) == Trap::BREAKPOINT);
+    CHECK( sim->get_hart( 0)->get_executed_instrs() == 100);
+    CHECK( sim->get_hart( 1)->get_executed_instrs() == 100);
+
+    CHECK( run_silent( sim.get(), 20) == Trap::BREAKPOINT);
+    CHECK( sim->get_hart( 0)->get_executed_instrs() == 120);
+}
+
+TEST_CASE( "Multi_hart: deterministic replay")
+{
+    auto [sim1, mem1] = init( 4, 5, MemoryOrdering::DETERMINISTIC, increment_counter);
+    auto [sim2, mem2] = init( 4, 5, MemoryOrdering::DETERMINISTIC, increment_counter);
+    run_silent( sim1.get(), 1000);
+    run_silent( sim2.get(), 1000);
+
+    // Harts overwrite each other's increments, but always in the same order
+    const auto counter = mem1->read<uint32, std::endian::little>( 0x100);
+    CHECK( counter >= 1000 / 4);
+    CHECK( counter < 4 * 1000 / 4);
+    CHECK( mem2->read<uint32, std::endian::little>( 0x100) == counter);
+}
@@ -6,6 +6,7 @@
 #include <catch.hpp>
 
 #include <func_sim/func_sim.h>
+#include <infra/memory_trace.h>
 #include <kernel/kernel.h>
 #include <memory/memory.h>
 #include <mips/mips_register/mips_register.h>
@@ -150,6 +151,38 @@ TEST_CASE( "FuncSim: Register size")
     CHECK( Simulator::create_functional_simulator("mips64")->sizeof_register() == bytewidth<uint64>);
 }
 
+struct CountingTraceSink : MemoryTraceSink
+{
+    uint64 accesses = 0;
+    uint64 writes = 0;
+    void emit( const MemoryAccess& access) final
+    {
+        ++accesses;
+        writes += access.is_write ? 1 : 0;
+    }
+};
+
+TEST_CASE( "FuncSim: memory trace")
+{
+    auto sim = create_funcsim( "mips32", TEST_PATH "/mips/mips-tt.bin", "mars").sim;
+    auto instructions = std::make_shared<CountingTraceSink>();
+    auto data = std::make_shared<CountingTraceSink>();
+    sim->set_memory_trace( instructions, data);
+
+    CHECK( sim->run_no_limit() == Trap::HALT);
+    CHECK( instructions->accesses == sim->get_executed_instrs());
+    CHECK( instructions->writes == 0);
+    CHECK( data->accesses > 0);
+    CHECK( data->writes > 0);
+    CHECK( data->writes < data->accesses);
+}
+
+TEST_CASE( "FuncSim: memory trace is not supported by performance simulator")
+{
+    auto sim = Simulator::create_simulator( "mips32", false);
+    CHECK_THROWS_AS( sim->set_memory_trace( nullptr, nullptr), MemoryTraceUnsupported);
+}
+
 TEST_CASE( "Run_SMC_trace: Func_Sim")
 {
     auto sim = create_funcsim( "mips32", TEST_PATH "/mips/mips-smc.bin", "gdb").sim;
@@ -0,0 +1,328 @@
+/**
+ * cache_hierarchy.cpp - timing model of L1 instruction and data caches
+ * backed by a unified L2 cache and the memory
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "cache_hierarchy.h"
+
+#include <infra/config/config.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace config {
+    /* Cache parameters */
+    static const Value<std::string> instruction_cache_type = { "icache-type", "LRU", "Type of instruction level 1 cache"};
+    static const Value<uint32> instruction_cache_size = { "icache-size", 2048, "Size of instruction level 1 cache (in bytes)"};
+    static const Value<uint32> instruction_cache_ways = { "icache-ways", 4, "Amount of ways in instruction level 1 cache"};
+    static const Value<uint32> instruction_cache_line_size = { "icache-line-size", 64, "Line size of instruction level 1 cache (in bytes)"};
+    static const Value<uint32> instruction_cache_mshrs = { "icache-mshrs", 4, "Amount of outstanding misses of instruction level 1 cache"};
+    static const Value<std::string> instruction_cache_prefetcher = { "icache-prefetcher", "none", "Prefetcher of instruction level 1 cache"};
+
+    static const Value<std::string> data_cache_type = { "dcache-type", "LRU", "Type of data level 1 cache"};
+    static const Value<uint32> data_cache_size = { "dcache-size", 2048, "Size of data level 1 cache (in bytes)"};
+    static const Value<uint32> data_cache_ways = { "dcache-ways", 4, "Amount of ways in data level 1 cache"};
+    static const Value<uint32> data_cache_line_size = { "dcache-line-size", 64, "Line size of data level 1 cache (in bytes)"};
+    static const Value<uint32> data_cache_mshrs = { "dcache-mshrs", 4, "Amount of outstanding misses of data level 1 cache"};
+    static const Value<std::string> data_cache_prefetcher = { "dcache-prefetcher", "none", "Prefetcher of data level 1 cache"};
+    static const Value<uint32> prefetch_degree = { "prefetch-degree", 2, "Amount of lines prefetched by a single trigger"};
+
+    static const Value<std::string> l2_cache_type = { "l2-type", "LRU", "Type of unified level 2 cache"};
+    static const Value<uint32> l2_cache_size = { "l2-size", 65536, "Size of unified level 2 cache (in bytes)"};
+    static const Value<uint32> l2_cache_ways = { "l2-ways", 8, "Amount of ways in unified level 2 cache"};
+    static const Value<uint32> l2_cache_line_size = { "l2-line-size", 64, "Line size of unified level 2 cache (in bytes)"};
+    static const Value<uint64> l2_cache_latency = { "l2-latency", 10, "Latency of unified level 2 cache (in cycles)"};
+
+    static const Value<uint64> memory_latency = { "memory-latency", 30, "Latency of the memory behind the caches (in cycles)"};
+} // namespace config
+
+std::pair<bool, Cycle> MSHRFile::find( Addr line, Cycle now) const
+{
+    for ( const auto& entry : entries)
+        if ( entry.line == line && entry.ready > now)
+            return { true, entry.ready};
+
+    return { false, now};
+}
+
+Cycle MSHRFile::get_issue_cycle( Cycle now) const
+{
+    if ( entries.empty())
+        return now;
+
+    const auto& first_free = *std::min_element( entries.begin(), entries.end(),
+        []( const auto& lhs, const auto& rhs) { return lhs.ready < rhs.ready; });
+
+    return std::max( now, first_free.ready);
+}
+
+void MSHRFile::allocate( Addr line, Cycle ready)
+{
+    if ( entries.empty())
+        return;
+
+    auto& entry = *std::min_element( entries.begin(), entries.end(),
+        []( const auto& lhs, const auto& rhs) { return lhs.ready < rhs.ready; });
+
+    entry = Entry{ line, ready};
+}
+
+CacheLevel::CacheLevel( std::string name, const CacheParameters& parameters)
+    : name( std::move( name))
+    , tags( CacheTagArray::create( parameters.type, parameters.size_in_bytes, parameters.ways, parameters.line_size, 32))
+    , ways( parameters.ways)
+    , line_size( parameters.line_size)
+    , lines( parameters.size_in_bytes / parameters.line_size)
+    , mshrs( parameters.mshrs_num)
+    , prefetcher( Prefetcher::create( parameters.prefetcher, parameters.prefetch_degree, parameters.line_size))
+{ }
+
+CacheLevel::Line& CacheLevel::get_line( Addr addr, int32 way)
+{
+    const auto index = size_t{ tags->set( addr)} * ways + narrow_cast<size_t>( way);
+
+    /* infinite cache grows without limits */
+    if ( index >= lines.size())
+        lines.resize( index + 1);
+
+    return lines[ index];
+}
+
+CacheLevel::Result CacheLevel::replace( Addr addr, bool is_prefetch)
+{
+    Result result;
+    const auto way = tags->write( addr);
+
+    /* the replaced line has to be written to the next level */
+    auto& line = get_line( addr, way);
+    if ( line.is_dirty)
+    {
+        ++statistics.writebacks;
+        result.has_writeback = true;
+        result.writeback_line = line.addr;
+    }
+    line = Line{ get_line_addr( addr), false, is_prefetch};
+    return result;
+}
+
+CacheLevel::Result CacheLevel::access( Addr addr, bool is_write)
+{
+    const auto [is_hit, way] = tags->read( addr);
+    if ( !is_hit)
+    {
+        ++statistics.misses;
+        auto result = replace( addr, false);
+        if ( is_write)
+            get_line( addr, tags->read_no_touch( addr).second).is_dirty = true;
+        return result;
+    }
+
+    ++statistics.hits;
+    Result result;
+    result.is_hit = true;
+
+    /* ideal caches have no lines to track */
+    if ( way < 0)
+        return result;
+
+    auto& line = get_line( addr, way);
+    if ( line.is_prefetched)
+    {
+        ++statistics.useful_prefetches;
+        line.is_prefetched = false;
+        result.is_prefetch_hit = true;
+    }
+    if ( is_write)
+        line.is_dirty = true;
+
+    return result;
+}
+
+bool CacheLevel::merge( Addr addr, bool is_write)
+{
+    ++statistics.merged_misses;
+    const auto [is_hit, way] = tags->read( addr);
+    if ( !is_hit || way < 0)
+        return false;
+
+    auto& line = get_line( addr, way);
+    line.is_dirty |= is_write;
+    if ( !line.is_prefetched)
+        return false;
+
+    ++statistics.useful_prefetches;
+    ++statistics.late_prefetches;
+    line.is_prefetched = false;
+    return true;
+}
+
+CacheLevel::Result CacheLevel::prefetch( Addr line)
+{
+    ++statistics.prefetches;
+    return replace( line, true);
+}
+
+static auto get_rate( uint64 total, uint64 piece)
+{
+    return total != 0 ? ( 100.0 * piece / total) : 0;
+}
+
+void CacheLevel::dump_statistics( std::ostream& out) const
+{
+    const auto accesses = statistics.hits + statistics.misses + statistics.merged_misses;
+    out << std::endl << name << statistics.hits << " hits, "
+                     << statistics.misses << " misses ("
+                     << get_rate( accesses, statistics.misses + statistics.merged_misses) << "%), "
+                     << statistics.merged_misses << " merged in MSHR, "
+                     << statistics.writebacks << " writebacks, "
+                     << statistics.mshr_stalls << " MSHR stalls";
+
+    const auto replacement = tags->get_replacement_statistics();
+    if ( !replacement.empty())
+        out << std::endl << "            replacement " << replacement;
+
+    if ( prefetcher == nullptr)
+        return;
+
+    // Coverage is a share of misses which are removed by prefetches
+    out << std::endl << "            prefetches: " << statistics.prefetches << " issued, "
+                     << statistics.useful_prefetches << " useful, "
+                     << statistics.late_prefetches << " late, accuracy "
+                     << get_rate( statistics.prefetches, statistics.useful_prefetches) << "%, coverage "
+                     << get_rate( statistics.useful_prefetches + statistics.misses, statistics.useful_prefetches) << "%";
+}
+
+std::vector<NamedFormula> CacheLevel::get_statistics_formulas() const
+{
+    return {
+        { "hits",              "", make_value( &statistics.hits)},
+        { "misses",            "", make_value( &statistics.misses)},
+        { "merged_misses",     "", make_value( &statistics.merged_misses)},
+        { "writebacks",        "", make_value( &statistics.writebacks)},
+        { "mshr_stalls",       "", make_value( &statistics.mshr_stalls)},
+        { "prefetches",        "", make_value( &statistics.prefetches)},
+        { "useful_prefetches", "", make_value( &statistics.useful_prefetches)},
+        { "late_prefetches",   "", make_value( &statistics.late_prefetches)},
+        { "miss_rate", "misses per access, misses to the lines being filled included", [this]() {
+            const auto misses = statistics.misses + statistics.merged_misses;
+            return 1.0 * misses / ( statistics.hits + misses);
+        }}
+    };
+}
+
+CacheHierarchy::CacheHierarchy( const CacheParameters& l1i_parameters,
+                                const CacheParameters& l1d_parameters,
+                                const CacheParameters& l2_parameters,
+                                Latency l2_latency,
+                                Latency memory_latency)
+    : l1i( "l1i:        ", l1i_parameters)
+    , l1d( "l1d:        ", l1d_parameters)
+    , l2( "l2:         ", l2_parameters)
+    , l2_latency( l2_latency)
+    , memory_latency( memory_latency)
+{
+    prefetch_queue.reserve( std::max( l1i_parameters.prefetch_degree, l1d_parameters.prefetch_degree));
+}
+
+CacheParameters CacheHierarchy::get_configured_l1i_parameters()
+{
+    return CacheParameters{ config::instruction_cache_type, config::instruction_cache_size, config::instruction_cache_ways,
+                            config::instruction_cache_line_size, config::instruction_cache_mshrs,
+                            config::instruction_cache_prefetcher, config::prefetch_degree};
+}
+
+CacheParameters CacheHierarchy::get_configured_l1d_parameters()
+{
+    return CacheParameters{ config::data_cache_type, config::data_cache_size, config::data_cache_ways,
+                            config::data_cache_line_size, config::data_cache_mshrs,
+                            config::data_cache_prefetcher, config::prefetch_degree};
+}
+
+std::unique_ptr<CacheHierarchy> CacheHierarchy::create_configured()
+{
+    return std::make_unique<CacheHierarchy>(
+        get_configured_l1i_parameters(),
+        get_configured_l1d_parameters(),
+        CacheParameters{ config::l2_cache_type, config::l2_cache_size, config::l2_cache_ways,
+                         config::l2_cache_line_size, 0},
+        Latency( narrow_cast<int64>( uint64{ config::l2_cache_latency})),
+        Latency( narrow_cast<int64>( uint64{ config::memory_latency}))
+    );
+}
+
+Latency CacheHierarchy::fill( Addr line)
+{
+    const auto result = l2.access( line, false);
+    return result.is_hit ? l2_latency : l2_latency + memory_latency;
+}
+
+CacheAccess CacheHierarchy::access( CacheLevel* l1, Addr pc, Addr addr, bool is_write)
+{
+    bool is_trigger = false;
+    const auto result = demand_access( l1, addr, is_write, &is_trigger);
+    issue_prefetches( l1, pc, addr, is_trigger);
+    return result;
+}
+
+CacheAccess CacheHierarchy::demand_access( CacheLevel* l1, Addr addr, bool is_write, bool* is_trigger)
+{
+    const Addr line = l1->get_line_addr( addr);
+
+    /* secondary miss waits for the outstanding one */
+    const auto [is_filled, fill_cycle] = l1->get_mshrs()->find( line, now);
+    if ( is_filled)
+    {
+        *is_trigger = l1->merge( addr, is_write);
+        return CacheAccess{ false, now, fill_cycle};
+    }
+
+    const auto result = l1->access( addr, is_write);
+    if ( result.has_writeback)
+        l2.access( result.writeback_line, true);
+
+    *is_trigger = !result.is_hit || result.is_prefetch_hit;
+    if ( result.is_hit)
+        return CacheAccess{ true, now, now + 1_lt};
+
+    const auto issue = l1->get_mshrs()->get_issue_cycle( now);
+    if ( issue > now)
+        l1->count_mshr_stall();
+
+    const auto ready = issue + 1_lt + fill( line);
+    l1->get_mshrs()->allocate( line, ready);
+    return CacheAccess{ false, issue, ready};
+}
+
+void CacheHierarchy::issue_prefetches( CacheLevel* l1, Addr pc, Addr addr, bool is_trigger)
+{
+    auto* prefetcher = l1->get_prefetcher();
+    if ( prefetcher == nullptr)
+        return;
+
+    prefetch_queue.clear();
+    prefetcher->observe( pc, l1->get_line_addr( addr), is_trigger, &prefetch_queue);
+    for ( const auto target : prefetch_queue)
+    {
+        const Addr line = l1->get_line_addr( target);
+        if ( l1->contains( line) || l1->get_mshrs()->find( line, now).first)
+            continue;
+
+        /* prefetches never wait for MSHRs */
+        if ( l1->get_mshrs()->get_issue_cycle( now) > now)
+            break;
+
+        const auto result = l1->prefetch( line);
+        if ( result.has_writeback)
+            l2.access( result.writeback_line, true);
+
+        l1->get_mshrs()->allocate( line, now + 1_lt + fill( line));
+    }
+}
+
+void CacheHierarchy::dump_statistics( std::ostream& out) const
+{
+    l1i.dump_statistics( out);
+    l1d.dump_statistics( out);
+    l2.dump_statistics( out);
+}
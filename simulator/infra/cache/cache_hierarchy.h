@@ -0,0 +1,181 @@
+/**
+ * cache_hierarchy.h - timing model of L1 instruction and data caches
+ * backed by a unified L2 cache and the memory
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef CACHE_HIERARCHY_H
+#define CACHE_HIERARCHY_H
+
+#include <infra/cache/cache_tag_array.h>
+#include <infra/cache/prefetcher.h>
+#include <infra/ports/timing.h>
+#include <infra/statistics/statistics.h>
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct CacheParameters
+{
+    std::string type;
+    uint32 size_in_bytes;
+    uint32 ways;
+    uint32 line_size;
+    uint32 mshrs_num; // zero is for unlimited number of outstanding misses
+    std::string prefetcher = "none";
+    uint32 prefetch_degree = 1;
+};
+
+/*
+ * Miss status holding registers keep lines which are being filled,
+ * so the cache is not blocked by outstanding misses.
+ */
+class MSHRFile
+{
+public:
+    explicit MSHRFile( uint32 size) : entries( size, Entry{ 0, 0_cl}) { }
+
+    // Returns true and the fill cycle if the line is being filled
+    std::pair<bool, Cycle> find( Addr line, Cycle now) const;
+
+    // Returns the first cycle when a new miss may be issued
+    Cycle get_issue_cycle( Cycle now) const;
+
+    void allocate( Addr line, Cycle ready);
+
+private:
+    struct Entry
+    {
+        Addr line;
+        Cycle ready;
+    };
+    std::vector<Entry> entries;
+};
+
+/* Write-back, write-allocate cache level */
+class CacheLevel
+{
+public:
+    CacheLevel( std::string name, const CacheParameters& parameters);
+
+    struct Result
+    {
+        bool is_hit = false;
+        bool is_prefetch_hit = false; // the first use of a prefetched line
+        bool has_writeback = false;
+        Addr writeback_line = 0;
+    };
+
+    Result access( Addr addr, bool is_write);
+
+    // Access to the line which is being filled, returns true if it is prefetched
+    bool merge( Addr addr, bool is_write);
+
+    // Allocates a line without a demand access
+    Result prefetch( Addr line);
+    bool contains( Addr addr) const { return tags->read_no_touch( addr).first; }
+
+    Addr get_line_addr( Addr addr) const { return addr & ~Addr{ line_size - 1}; }
+    MSHRFile* get_mshrs() { return &mshrs; }
+    Prefetcher* get_prefetcher() const { return prefetcher.get(); }
+
+    struct Statistics
+    {
+        uint64 hits = 0;
+        uint64 misses = 0;
+        uint64 merged_misses = 0;
+        uint64 writebacks = 0;
+        uint64 mshr_stalls = 0;
+        uint64 prefetches = 0;
+        uint64 useful_prefetches = 0;
+        uint64 late_prefetches = 0;
+    };
+    const Statistics& get_statistics() const noexcept { return statistics; }
+    void count_mshr_stall() noexcept { ++statistics.mshr_stalls; }
+    void dump_statistics( std::ostream& out) const;
+
+    // Counters and the miss rate for the registry of the module using the level
+    std::vector<NamedFormula> get_statistics_formulas() const;
+
+private:
+    struct Line
+    {
+        Addr addr = 0;
+        bool is_dirty = false;
+        bool is_prefetched = false;
+    };
+    Line& get_line( Addr addr, int32 way);
+    Result replace( Addr addr, bool is_prefetch);
+
+    const std::string name;
+    const std::unique_ptr<CacheTagArray> tags;
+    const uint32 ways;
+    const uint32 line_size;
+    std::vector<Line> lines;
+    MSHRFile mshrs;
+    std::unique_ptr<Prefetcher> prefetcher;
+    Statistics statistics;
+};
+
+struct CacheAccess
+{
+    bool is_hit;
+    Cycle issue; // a miss waits for a free MSHR
+    Cycle ready; // data is available to the pipeline
+};
+
+/*
+ * L1 caches hit in one cycle. A miss is sent to the L2 cache,
+ * and a miss in the L2 cache is sent to the memory.
+ * Writebacks of dirty lines are buffered, so they do not delay fills.
+ * Prefetchers of L1 caches observe demand accesses and fill lines
+ * in the background if there is a free MSHR.
+ *
+ * The model is driven by the core clock, which is not stopped by
+ * pipeline stalls, so outstanding misses are served in the background.
+ */
+class CacheHierarchy
+{
+public:
+    CacheHierarchy( const CacheParameters& l1i_parameters,
+                    const CacheParameters& l1d_parameters,
+                    const CacheParameters& l2_parameters,
+                    Latency l2_latency,
+                    Latency memory_latency);
+
+    static std::unique_ptr<CacheHierarchy> create_configured();
+    static CacheParameters get_configured_l1i_parameters();
+    static CacheParameters get_configured_l1d_parameters();
+
+    void clock( Cycle cycle) noexcept { now = cycle; }
+    Cycle get_cycle() const noexcept { return now; }
+
+    CacheAccess access_instruction( Addr addr) { return access( &l1i, addr, addr, false); }
+    CacheAccess access_data( Addr pc, Addr addr, bool is_write) { return access( &l1d, pc, addr, is_write); }
+
+    const CacheLevel& get_l1i() const noexcept { return l1i; }
+    const CacheLevel& get_l1d() const noexcept { return l1d; }
+    const CacheLevel& get_l2() const noexcept { return l2; }
+
+    void dump_statistics( std::ostream& out) const;
+
+private:
+    CacheAccess access( CacheLevel* l1, Addr pc, Addr addr, bool is_write);
+    CacheAccess demand_access( CacheLevel* l1, Addr addr, bool is_write, bool* is_trigger);
+    void issue_prefetches( CacheLevel* l1, Addr pc, Addr addr, bool is_trigger);
+    Latency fill( Addr line);
+
+    CacheLevel l1i;
+    CacheLevel l1d;
+    CacheLevel l2;
+    const Latency l2_latency;
+    const Latency memory_latency;
+    Cycle now = 0_cl;
+
+    // Reused to keep the cycle loop free of allocations
+    std::vector<Addr> prefetch_queue;
+};
+
+#endif // CACHE_HIERARCHY_H
@@ -11,6 +11,7 @@
 
 #include <sparsehash/dense_hash_map.h>
 
+#include <bit>
 #include <utility>
 #include <vector>
 
@@ -155,16 +156,18 @@ class ReplacementModule
         ReplacementModule( std::size_t number_of_sets, std::size_t number_of_ways, const std::string& replacement_policy);
         void touch( uint32 num_set, uint32 num_way) { replacement_info[ num_set]->touch( num_way); }
         auto update( uint32 num_set) { return replacement_info[ num_set]->update(); }
+        const auto& get_statistics() const noexcept { return shared_state->statistics; }
 
     private:
         std::vector<std::unique_ptr<CacheReplacement>> replacement_info;
+        const std::shared_ptr<SharedReplacementState> shared_state = std::make_shared<SharedReplacementState>();
 };
 
 ReplacementModule::ReplacementModule( std::size_t number_of_sets, std::size_t number_of_ways, const std::string& replacement_policy)
     : replacement_info( number_of_sets)
 {
-    for (auto& e : replacement_info)
-        e = create_cache_replacement( replacement_policy, number_of_ways);
+    for ( std::size_t i = 0; i < replacement_info.size(); ++i)
+        replacement_info[ i] = create_cache_replacement( replacement_policy, number_of_ways, i, shared_state, number_of_sets);
 }
 
 class SimpleCacheTagArray : public CacheTagArraySize
@@ -181,6 +184,7 @@ class SimpleCacheTagArray : public CacheTagArraySize
         int32 write( Addr addr) final;
         std::pair<bool, int32> read( Addr addr) final;
         std::pair<bool, int32> read_no_touch( Addr addr) const final;
+        ReplacementStatistics get_replacement_statistics() const final { return replacement_module->get_statistics(); }
 
     private:
         struct Tag
@@ -266,6 +270,165 @@ int32 SimpleCacheTagArray::write( Addr addr)
     return way;
 }
 
+/*
+ * Tags of all sets are kept in a single set-major array of 32-bit words.
+ * Each set is followed by its valid bits and packed replacement state,
+ * so a lookup touches a single cache line for usual associativities.
+ * All ways of a set are compared by a branchless loop, which is vectorized.
+ *
+ * LRU keeps 8-bit ages of ways, pseudo-LRU keeps bits of the tree nodes.
+ */
+class FlatCacheTagArray : public CacheTagArraySize
+{
+    public:
+        FlatCacheTagArray(
+            uint32 size_in_bytes,
+            uint32 ways,
+            uint32 line_size,
+            uint32 addr_size_in_bits,
+            const std::string& repl_policy
+        );
+
+        // Tags are stored in 32-bit words, set and offset bits are not stored
+        static bool is_supported( const std::string& repl_policy, uint32 size_in_bytes, uint32 ways, uint32 addr_size_in_bits)
+        {
+            return ( repl_policy == "LRU" || repl_policy == "pseudo-LRU")
+                && is_power_of_two( ways) && ways <= MAX_WAYS
+                && addr_size_in_bits <= MAX_TAG_BITS + std::countr_zero( size_in_bytes / ways);
+        }
+
+        int32 write( Addr addr) final;
+        std::pair<bool, int32> read( Addr addr) final;
+        std::pair<bool, int32> read_no_touch( Addr addr) const final;
+
+    private:
+        static const constexpr uint32 MAX_WAYS = 32;
+        static const constexpr uint32 MAX_TAG_BITS = 32;
+        static const constexpr uint32 AGES_PER_WORD = 4;
+
+        uint32* get_set( uint32 num_set) { return &storage[ size_t{ num_set} * stride]; }
+        const uint32* get_set( uint32 num_set) const { return &storage[ size_t{ num_set} * stride]; }
+
+        // Replacement state follows tags and valid bits
+        uint32* get_state( uint32* entry) const { return entry + ways + 1; }
+        uint32 get_age( const uint32* entry, uint32 way) const;
+        void set_age( uint32* entry, uint32 way, uint32 age) const;
+        void touch( uint32* entry, uint32 way) const;
+        uint32 get_victim( const uint32* entry) const;
+
+        const bool is_lru;
+        const uint32 stride;
+        std::vector<uint32> storage;
+};
+
+FlatCacheTagArray::FlatCacheTagArray(
+    uint32 size_in_bytes,
+    uint32 ways,
+    uint32 line_size,
+    uint32 addr_size_in_bits,
+    const std::string& repl_policy)
+        : CacheTagArraySize( size_in_bytes, ways, line_size, addr_size_in_bits)
+        , is_lru( repl_policy == "LRU")
+        , stride( ways + 1 + ( is_lru ? ( ways + AGES_PER_WORD - 1) / AGES_PER_WORD : 1))
+        , storage( size_t{ sets} * stride, 0)
+{
+    // The first victim is the way 0, then the way 1, and so on
+    if ( is_lru)
+        for ( uint32 i = 0; i < sets; ++i)
+            for ( uint32 way = 0; way < ways; ++way)
+                set_age( get_set( i), way, ways - 1 - way);
+}
+
+uint32 FlatCacheTagArray::get_age( const uint32* entry, uint32 way) const
+{
+    const auto* state = entry + ways + 1;
+    return ( state[ way / AGES_PER_WORD] >> ( 8 * ( way % AGES_PER_WORD))) & 0xFFU;
+}
+
+void FlatCacheTagArray::set_age( uint32* entry, uint32 way, uint32 age) const
+{
+    auto& word = get_state( entry)[ way / AGES_PER_WORD];
+    const auto shift = 8 * ( way % AGES_PER_WORD);
+    word = ( word & ~( 0xFFU << shift)) | ( age << shift);
+}
+
+void FlatCacheTagArray::touch( uint32* entry, uint32 way) const
+{
+    if ( is_lru) {
+        const auto age = get_age( entry, way);
+        for ( uint32 i = 0; i < ways; ++i)
+            if ( get_age( entry, i) < age)
+                set_age( entry, i, get_age( entry, i) + 1);
+        set_age( entry, way, 0);
+        return;
+    }
+
+    // Nodes of pseudo-LRU tree point away from the touched way
+    auto& nodes = *get_state( entry);
+    auto node = way + ways - 1;
+    while ( node != 0) {
+        const auto parent = ( node - 1) / 2;
+        const uint32 is_right_child = ( node % 2 == 0) ? 1 : 0;
+        if ( ( ( nodes >> parent) & 1U) == is_right_child)
+            nodes ^= 1U << parent;
+        node = parent;
+    }
+}
+
+uint32 FlatCacheTagArray::get_victim( const uint32* entry) const
+{
+    if ( is_lru) {
+        for ( uint32 way = 0; way < ways; ++way)
+            if ( get_age( entry, way) == ways - 1)
+                return way;
+        return 0;
+    }
+
+    const auto nodes = entry[ ways + 1];
+    uint32 node = 0;
+    while ( node < ways - 1)
+        node = node * 2 + ( ( ( nodes >> node) & 1U) == 0 ? 1 : 2);
+
+    return node - ( ways - 1);
+}
+
+std::pair<bool, int32> FlatCacheTagArray::read_no_touch( Addr addr) const
+{
+    const auto* entry = get_set( set( addr));
+    const auto num_tag = narrow_cast<uint32>( tag( addr));
+
+    uint32 hits = 0;
+    for ( uint32 way = 0; way < ways; ++way)
+        hits |= uint32{ entry[ way] == num_tag} << way;
+
+    // valid bits
+    hits &= entry[ ways];
+    if ( hits == 0)
+        return { false, -1};
+
+    return { true, std::countr_zero( hits)};
+}
+
+std::pair<bool, int32> FlatCacheTagArray::read( Addr addr)
+{
+    const auto lookup_result = read_no_touch( addr);
+    if ( lookup_result.first)
+        touch( get_set( set( addr)), narrow_cast<uint32>( lookup_result.second));
+
+    return lookup_result;
+}
+
+int32 FlatCacheTagArray::write( Addr addr)
+{
+    auto* entry = get_set( set( addr));
+    const auto way = get_victim( entry);
+    touch( entry, way);
+
+    entry[ way] = narrow_cast<uint32>( tag( addr));
+    entry[ ways] |= 1U << way;
+    return narrow_cast<int32>( way);
+}
+
 std::unique_ptr<CacheTagArray> CacheTagArray::create(
     const std::string& type,
     uint32 size_in_bytes,
@@ -278,6 +441,9 @@ std::unique_ptr<CacheTagArray> CacheTagArray::create(
     if ( type == "infinite")
         return std::make_unique<InfiniteCacheTagArray>();
 
+    if ( FlatCacheTagArray::is_supported( type, size_in_bytes, ways, addr_size_in_bits))
+        return std::make_unique<FlatCacheTagArray>( size_in_bytes, ways, line_size, addr_size_in_bits, type);
+
     return std::make_unique<SimpleCacheTagArray>( size_in_bytes, ways, line_size, addr_size_in_bits, type);
 }
 
@@ -9,6 +9,7 @@
 
 #include <infra/exception.h>
 #include <infra/log.h>
+#include <infra/replacement/cache_replacement.h>
 #include <infra/types.h>
 
 #include <memory>
@@ -57,6 +58,9 @@ public:
 
     bool lookup( Addr addr) { return read( addr).first; }; // hit or not
 
+    // Counters of replacement policies, empty for policies without them
+    virtual ReplacementStatistics get_replacement_statistics() const { return {}; }
+
     /**
      * Constructor params:
      *
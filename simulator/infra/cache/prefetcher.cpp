@@ -0,0 +1,142 @@
+/**
+ * prefetcher.cpp - hardware prefetch engines for caches
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "prefetcher.h"
+
+#include <algorithm>
+
+// Prefetches N lines following a missed line
+class NextLinePrefetcher : public Prefetcher
+{
+public:
+    NextLinePrefetcher( uint32 degree, uint32 line_size) : degree( degree), line_size( line_size) { }
+
+    void observe( Addr /* unused */, Addr line, bool is_trigger, std::vector<Addr>* prefetches) final
+    {
+        if ( !is_trigger)
+            return;
+
+        for ( uint32 i = 1; i <= degree; ++i)
+            prefetches->push_back( line + Addr{ i} * line_size);
+    }
+
+private:
+    const uint32 degree;
+    const uint32 line_size;
+};
+
+// Reference prediction table indexed by PC of the memory instruction
+class StridePrefetcher : public Prefetcher
+{
+public:
+    explicit StridePrefetcher( uint32 degree) : degree( degree), table( TABLE_SIZE) { }
+
+    void observe( Addr pc, Addr line, bool /* unused */, std::vector<Addr>* prefetches) final
+    {
+        auto& entry = table[ ( pc >> 2) & ( TABLE_SIZE - 1)];
+        if ( entry.pc != pc)
+        {
+            entry = Entry{ pc, line, 0, 0};
+            return;
+        }
+
+        const auto stride = narrow_cast<int64>( line - entry.last_line);
+        if ( stride == 0)
+            return;
+
+        if ( stride == entry.stride)
+            entry.confidence = std::min<uint32>( entry.confidence + 1, MAX_CONFIDENCE);
+        else if ( entry.confidence > 0)
+            --entry.confidence;
+        else
+            entry.stride = stride;
+
+        entry.last_line = line;
+        if ( entry.confidence < THRESHOLD)
+            return;
+
+        for ( uint32 i = 1; i <= degree; ++i)
+            prefetches->push_back( line + narrow_cast<Addr>( entry.stride * i));
+    }
+
+private:
+    static constexpr const size_t TABLE_SIZE = 64;
+    static constexpr const uint32 MAX_CONFIDENCE = 3;
+    static constexpr const uint32 THRESHOLD = 2;
+
+    struct Entry
+    {
+        Addr pc = NO_VAL32;
+        Addr last_line = 0;
+        int64 stride = 0;
+        uint32 confidence = 0;
+    };
+
+    const uint32 degree;
+    std::vector<Entry> table;
+};
+
+/*
+ * Stream buffers track ascending streams of misses.
+ * A stream is allocated on a miss and starts to prefetch
+ * when the next miss or prefetched hit continues it.
+ */
+class StreamBufferPrefetcher : public Prefetcher
+{
+public:
+    StreamBufferPrefetcher( uint32 degree, uint32 line_size)
+        : degree( degree), line_size( line_size), streams( STREAMS_NUM)
+    { }
+
+    void observe( Addr /* unused */, Addr line, bool is_trigger, std::vector<Addr>* prefetches) final
+    {
+        if ( !is_trigger)
+            return;
+
+        ++clock;
+        auto it = std::find_if( streams.begin(), streams.end(), [line]( const auto& s) { return s.next_line == line; });
+        if ( it == streams.end())
+        {
+            // Replace the least recently used stream
+            auto& lru = *std::min_element( streams.begin(), streams.end(),
+                []( const auto& lhs, const auto& rhs) { return lhs.last_use < rhs.last_use; });
+            lru = Stream{ line + line_size, clock};
+            return;
+        }
+
+        it->next_line = line + line_size;
+        it->last_use = clock;
+        for ( uint32 i = 1; i <= degree; ++i)
+            prefetches->push_back( line + Addr{ i} * line_size);
+    }
+
+private:
+    static constexpr const size_t STREAMS_NUM = 4;
+
+    struct Stream
+    {
+        Addr next_line = NO_VAL32;
+        uint64 last_use = 0;
+    };
+
+    const uint32 degree;
+    const uint32 line_size;
+    std::vector<Stream> streams;
+    uint64 clock = 0;
+};
+
+std::unique_ptr<Prefetcher> Prefetcher::create( const std::string& name, uint32 degree, uint32 line_size)
+{
+    if ( name == "none")
+        return nullptr;
+    if ( name == "next_line")
+        return std::make_unique<NextLinePrefetcher>( degree, line_size);
+    if ( name == "stride")
+        return std::make_unique<StridePrefetcher>( degree);
+    if ( name == "stream_buffer")
+        return std::make_unique<StreamBufferPrefetcher>( degree, line_size);
+
+    throw PrefetcherInvalidMode( name);
+}
@@ -0,0 +1,54 @@
+/**
+ * prefetcher.h - hardware prefetch engines for caches
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <infra/exception.h>
+#include <infra/types.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct PrefetcherInvalidMode final : Exception
+{
+    explicit PrefetcherInvalidMode( const std::string& mode)
+        : Exception("Invalid prefetcher mode " + mode,
+                    "Supported prefetchers: none, next_line, stride, stream_buffer")
+    { }
+};
+
+class Prefetcher
+{
+public:
+    Prefetcher() = default;
+    virtual ~Prefetcher() = default;
+    Prefetcher( const Prefetcher&) = delete;
+    Prefetcher( Prefetcher&&) = delete;
+    Prefetcher& operator=( const Prefetcher&) = delete;
+    Prefetcher& operator=( Prefetcher&&) = delete;
+
+    /*
+     * Observes a demand access of the instruction at 'pc' to the line 'line'.
+     * 'is_trigger' is set for misses and for the first hits to prefetched lines.
+     * Addresses to prefetch are appended to 'prefetches'.
+     */
+    virtual void observe( Addr pc, Addr line, bool is_trigger, std::vector<Addr>* prefetches) = 0;
+
+    /*
+     * Constructor params:
+     *
+     * name is one of "none", "next_line", "stride" or "stream_buffer",
+     *    "none" returns nullptr.
+     *
+     * degree is a number of lines prefetched by a single trigger.
+     *
+     * line_size is a size of a cache line in bytes.
+     */
+    static std::unique_ptr<Prefetcher> create( const std::string& name, uint32 degree, uint32 line_size);
+};
+
+#endif // PREFETCHER_H
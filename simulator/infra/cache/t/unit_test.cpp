@@ -5,12 +5,16 @@
 
 #include <catch.hpp>
 
+#include <infra/cache/cache_hierarchy.h>
 #include <infra/cache/cache_tag_array.h>
 #include <infra/replacement/cache_replacement.h>
 #include <infra/types.h>
 
+#include <algorithm>
 #include <fstream>
 #include <map>
+#include <random>
+#include <sstream>
 #include <vector>
 
 static const uint32 cache_size = 4;
@@ -122,3 +126,321 @@ TEST_CASE( "Check infinite CacheTagArray model with multiple sets")
     for ( uint32 i = 0; i < cache_ways + 1; i++)
         CHECK( test_tags->lookup( i * 0x10000000) == true);
 }
+
+// Straightforward tag array built on top of replacement policies
+class ReferenceTagArray
+{
+public:
+    ReferenceTagArray( const std::string& policy, uint32 size_in_bytes, uint32 ways, uint32 line_size)
+        : sets( size_in_bytes / ways / line_size), line_size( line_size)
+        , tags( sets, std::vector<Addr>( ways, NO_VAL64))
+    {
+        for ( uint32 i = 0; i < sets; ++i)
+            replacement.push_back( create_cache_replacement( policy, ways));
+    }
+
+    std::pair<bool, int32> read_no_touch( Addr addr) const
+    {
+        const auto& set = tags[ get_set( addr)];
+        const auto it = std::find( set.begin(), set.end(), get_tag( addr));
+        if ( it == set.end())
+            return { false, -1};
+        return { true, narrow_cast<int32>( it - set.begin())};
+    }
+
+    std::pair<bool, int32> read( Addr addr)
+    {
+        const auto result = read_no_touch( addr);
+        if ( result.first)
+            replacement[ get_set( addr)]->touch( narrow_cast<size_t>( result.second));
+        return result;
+    }
+
+    int32 write( Addr addr)
+    {
+        const auto way = replacement[ get_set( addr)]->update();
+        tags[ get_set( addr)][ way] = get_tag( addr);
+        return narrow_cast<int32>( way);
+    }
+
+private:
+    size_t get_set( Addr addr) const { return ( addr / line_size) % sets; }
+    Addr get_tag( Addr addr) const { return addr / line_size / sets; }
+
+    const uint32 sets;
+    const uint32 line_size;
+    std::vector<std::vector<Addr>> tags;
+    std::vector<std::unique_ptr<CacheReplacement>> replacement;
+};
+
+TEST_CASE( "Flat tag array: same behavior as reference")
+{
+    const auto policy = GENERATE( as<std::string>{}, "LRU", "pseudo-LRU");
+    const auto ways = GENERATE( 1U, 2U, 4U, 8U, 32U);
+    auto tags = CacheTagArray::create( policy, 64 * ways * 8, ways, 64, 32);
+    ReferenceTagArray reference( policy, 64 * ways * 8, ways, 64);
+
+    std::mt19937 generator( 5);
+    std::uniform_int_distribution<Addr> distribution( 0, 64 * ways * 32);
+    for ( int i = 0; i < 10000; ++i)
+    {
+        const Addr addr = distribution( generator);
+        CHECK( tags->read_no_touch( addr) == reference.read_no_touch( addr));
+        const auto result = tags->read( addr);
+        REQUIRE( result == reference.read( addr));
+        if ( !result.first)
+            REQUIRE( tags->write( addr) == reference.write( addr));
+    }
+}
+
+TEST_CASE( "Flat tag array: 64-bit addresses")
+{
+    const auto policy = GENERATE( as<std::string>{}, "LRU", "pseudo-LRU");
+    // the second cache has a single set of 1-byte lines, so its tags are 32-bit
+    const auto [size, line_size] = GENERATE( std::pair{ 64U * 4 * 8, 64U}, std::pair{ 4U, 1U});
+    auto tags = CacheTagArray::create( policy, size, 4, line_size, 32);
+    ReferenceTagArray reference( policy, size, 4, line_size);
+
+    // bits above the address size are ignored, so the lines alias
+    std::mt19937 generator( 7);
+    std::uniform_int_distribution<Addr> low( 0, 3);
+    std::uniform_int_distribution<Addr> high( 0, 3);
+    for ( int i = 0; i < 10000; ++i)
+    {
+        const Addr addr = ( high( generator) << 32U) | ( low( generator) << 30U) | low( generator) * line_size * 8;
+        const Addr addr32 = addr & MAX_VAL32;
+        CHECK( tags->read_no_touch( addr) == reference.read_no_touch( addr32));
+        const auto result = tags->read( addr);
+        REQUIRE( result == reference.read( addr32));
+        if ( !result.first)
+            REQUIRE( tags->write( addr) == reference.write( addr32));
+    }
+}
+
+TEST_CASE( "Flat tag array: LRU order")
+{
+    auto tags = CacheTagArray::create( "LRU", 256, 4, 64, 32);
+    for ( Addr line = 0; line < 4; ++line)
+        CHECK( tags->write( line * 64) == narrow_cast<int32>( line));
+
+    // line 0 is the most recently used one, line 1 is replaced
+    CHECK( tags->read( 0).first);
+    CHECK( tags->write( 4 * 64) == 1);
+    CHECK_FALSE( tags->read_no_touch( 64).first);
+    CHECK( tags->read_no_touch( 0) == std::pair{ true, 0});
+    CHECK( tags->read_no_touch( 4 * 64) == std::pair{ true, 1});
+}
+
+static auto create_hierarchy( uint32 mshrs_num)
+{
+    // One set of two lines in L1 caches, L2 is large enough to keep all the lines
+    return CacheHierarchy( CacheParameters{ "LRU", 128, 2, 64, mshrs_num},
+                           CacheParameters{ "LRU", 128, 2, 64, mshrs_num},
+                           CacheParameters{ "LRU", 1024, 4, 64, 0},
+                           10_lt, 30_lt);
+}
+
+TEST_CASE( "Cache hierarchy: miss latencies")
+{
+    auto caches = create_hierarchy( 4);
+    auto access = caches.access_data( 0, 0x1000, false);
+    CHECK( !access.is_hit);
+    CHECK( access.issue == 0_cl);
+    CHECK( access.ready == 41_cl);
+
+    caches.clock( 41_cl);
+    access = caches.access_data( 0, 0x1008, false);
+    CHECK( access.is_hit);
+    CHECK( access.ready == 42_cl);
+
+    // Evict 0x1000 from L1, it is still in L2
+    caches.access_data( 0, 0x2000, false);
+    caches.access_data( 0, 0x3000, false);
+    caches.clock( 100_cl);
+    access = caches.access_data( 0, 0x1000, false);
+    CHECK( !access.is_hit);
+    CHECK( access.ready == 111_cl);
+
+    CHECK( caches.get_l1d().get_statistics().hits == 1);
+    CHECK( caches.get_l1d().get_statistics().misses == 4);
+    CHECK( caches.get_l2().get_statistics().hits == 1);
+    CHECK( caches.get_l2().get_statistics().misses == 3);
+}
+
+TEST_CASE( "Cache hierarchy: misses are merged in MSHR")
+{
+    auto caches = create_hierarchy( 4);
+    const auto first = caches.access_data( 0, 0x1000, false);
+    caches.clock( 5_cl);
+    const auto second = caches.access_data( 0, 0x1010, true);
+    CHECK( !second.is_hit);
+    CHECK( second.ready == first.ready);
+    CHECK( caches.get_l1d().get_statistics().merged_misses == 1);
+    CHECK( caches.get_l2().get_statistics().misses == 1);
+}
+
+TEST_CASE( "Cache hierarchy: hit under miss")
+{
+    auto caches = create_hierarchy( 4);
+    caches.access_data( 0, 0x1000, false);
+    caches.clock( 41_cl);
+    caches.access_data( 0, 0x2000, false);
+    caches.clock( 42_cl);
+    const auto access = caches.access_data( 0, 0x1000, false);
+    CHECK( access.is_hit);
+    CHECK( access.ready == 43_cl);
+}
+
+TEST_CASE( "Cache hierarchy: MSHRs are exhausted")
+{
+    auto caches = create_hierarchy( 1);
+    const auto first = caches.access_data( 0, 0x1000, false);
+    const auto second = caches.access_data( 0, 0x2000, false);
+    CHECK( second.issue == first.ready);
+    CHECK( second.ready == first.ready + 41_lt);
+    CHECK( caches.get_l1d().get_statistics().mshr_stalls == 1);
+}
+
+TEST_CASE( "Cache hierarchy: dirty lines are written back")
+{
+    auto caches = create_hierarchy( 4);
+    caches.access_data( 0, 0x1000, true);
+    caches.access_data( 0, 0x2000, false);
+    caches.access_data( 0, 0x3000, false);
+    CHECK( caches.get_l1d().get_statistics().writebacks == 1);
+
+    // Written back line hits in L2
+    CHECK( caches.get_l2().get_statistics().hits == 1);
+}
+
+TEST_CASE( "Cache hierarchy: instruction and data caches are separate")
+{
+    auto caches = create_hierarchy( 4);
+    caches.access_instruction( 0x1000);
+    caches.clock( 100_cl);
+    const auto access = caches.access_data( 0, 0x1000, false);
+    CHECK( !access.is_hit);
+    CHECK( access.ready == 111_cl);
+    CHECK( caches.get_l1i().get_statistics().misses == 1);
+}
+
+static auto create_prefetching_hierarchy( const std::string& prefetcher)
+{
+    return CacheHierarchy( CacheParameters{ "LRU", 1024, 4, 64, 8},
+                           CacheParameters{ "LRU", 1024, 4, 64, 8, prefetcher, 2},
+                           CacheParameters{ "LRU", 4096, 4, 64, 0},
+                           10_lt, 30_lt);
+}
+
+TEST_CASE( "Prefetcher: invalid mode")
+{
+    CHECK_THROWS_AS( create_prefetching_hierarchy( "oracle"), PrefetcherInvalidMode);
+    CHECK( Prefetcher::create( "none", 2, 64) == nullptr);
+}
+
+TEST_CASE( "Prefetcher: next lines")
+{
+    auto caches = create_prefetching_hierarchy( "next_line");
+    caches.access_data( 0, 0x1000, false);
+    CHECK( caches.get_l1d().get_statistics().prefetches == 2);
+
+    caches.clock( 100_cl);
+    CHECK( caches.access_data( 0, 0x1040, false).is_hit);
+    CHECK( caches.access_data( 0, 0x1080, false).is_hit);
+    CHECK( caches.get_l1d().get_statistics().useful_prefetches == 2);
+    CHECK( caches.get_l1d().get_statistics().late_prefetches == 0);
+
+    // Hits to prefetched lines trigger next prefetches
+    CHECK( caches.get_l1d().get_statistics().prefetches == 4);
+}
+
+TEST_CASE( "Prefetcher: late prefetch")
+{
+    auto caches = create_prefetching_hierarchy( "next_line");
+    caches.access_data( 0, 0x1000, false);
+    caches.clock( 5_cl);
+    const auto access = caches.access_data( 0, 0x1040, false);
+    CHECK( !access.is_hit);
+    CHECK( access.ready == 41_cl);
+    CHECK( caches.get_l1d().get_statistics().useful_prefetches == 1);
+    CHECK( caches.get_l1d().get_statistics().late_prefetches == 1);
+}
+
+TEST_CASE( "Prefetcher: stride")
+{
+    auto caches = create_prefetching_hierarchy( "stride");
+    for ( Addr addr = 0x1000; addr < 0x1400; addr += 0x100)
+        caches.access_data( 0x400000, addr, false);
+
+    // The stride is confirmed twice before prefetching
+    CHECK( caches.get_l1d().get_statistics().prefetches == 2);
+    caches.clock( 100_cl);
+    CHECK( caches.access_data( 0x400000, 0x1400, false).is_hit);
+    CHECK( caches.access_data( 0x400000, 0x1500, false).is_hit);
+    CHECK( caches.get_l1d().get_statistics().prefetches == 4);
+
+    // Other instructions do not use the entry
+    caches.access_data( 0x400004, 0x8000, false);
+    CHECK( caches.get_l1d().get_statistics().prefetches == 4);
+}
+
+TEST_CASE( "Prefetcher: stream buffer")
+{
+    auto caches = create_prefetching_hierarchy( "stream_buffer");
+    caches.access_data( 0, 0x1000, false);
+    CHECK( caches.get_l1d().get_statistics().prefetches == 0);
+
+    // The second miss confirms the stream
+    caches.clock( 100_cl);
+    caches.access_data( 0, 0x1040, false);
+    CHECK( caches.get_l1d().get_statistics().prefetches == 2);
+
+    caches.clock( 200_cl);
+    CHECK( caches.access_data( 0, 0x1080, false).is_hit);
+    CHECK( caches.get_l1d().get_statistics().useful_prefetches == 1);
+}
+
+static uint32 count_working_set_hits( const std::string& policy)
+{
+    // 4 sets of 4 ways, the working set takes two ways of each set and is used twice,
+    // the stream puts three lines to each set between the uses
+    auto cache = CacheTagArray::create( policy, 1024, 4, 64, 32);
+    const auto access = [&cache]( Addr addr) {
+        const bool is_hit = cache->lookup( addr);
+        if ( !is_hit)
+            cache->write( addr);
+        return is_hit;
+    };
+
+    uint32 hits = 0;
+    for ( Addr stream = 0x10000; stream < 0x20000; stream += 0x400)
+    {
+        for ( int i = 0; i < 2; ++i)
+            for ( Addr addr = 0; addr < 0x200; addr += 64)
+                hits += access( addr) ? 1 : 0;
+
+        for ( Addr addr = stream; addr < stream + 0x300; addr += 64)
+            access( addr);
+    }
+    return hits;
+}
+
+TEST_CASE( "RRIP cache: streaming does not evict the working set")
+{
+    CHECK( count_working_set_hits( "LRU") == 64 * 8);
+    CHECK( count_working_set_hits( "SRRIP") > 64 * 15);
+    CHECK( count_working_set_hits( "DRRIP") > 64 * 14);
+    CHECK( CacheTagArray::create( "LRU", 1024, 4, 64, 32)->get_replacement_statistics().empty());
+}
+
+TEST_CASE( "RRIP cache: dueling statistics in the dump")
+{
+    CacheLevel cache( "l1d: ", CacheParameters{ "DRRIP", 65536, 4, 64, 0});
+    for ( Addr addr = 0; addr < 0x100000; addr += 64)
+        cache.access( addr, false);
+
+    std::ostringstream oss;
+    cache.dump_statistics( oss);
+    CHECK( oss.str().find( "replacement insertions: ") != std::string::npos);
+    CHECK( oss.str().find( "dueling winners: SRRIP ") != std::string::npos);
+}
@@ -0,0 +1,31 @@
+/*
+ * memory_trace.h - interface for consumers of memory access streams
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef MEMORY_TRACE_H
+#define MEMORY_TRACE_H
+
+#include <infra/types.h>
+
+struct MemoryAccess
+{
+    Addr addr = 0;
+    bool is_write = false;
+    uint8 size = 0; // zero if the size is unknown
+};
+
+class MemoryTraceSink
+{
+public:
+    MemoryTraceSink() = default;
+    virtual ~MemoryTraceSink() = default;
+    MemoryTraceSink( const MemoryTraceSink&) = delete;
+    MemoryTraceSink( MemoryTraceSink&&) = delete;
+    MemoryTraceSink& operator=( const MemoryTraceSink&) = delete;
+    MemoryTraceSink& operator=( MemoryTraceSink&&) = delete;
+
+    virtual void emit( const MemoryAccess& access) = 0;
+};
+
+#endif // MEMORY_TRACE_H
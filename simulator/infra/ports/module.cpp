@@ -11,8 +11,14 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <fstream>
+
 namespace pt = boost::property_tree;
 
+namespace config {
+    const Value<std::string> stats_json = { "stats-json", "", "file of all statistics in JSON format"};
+} // namespace config
+
 Module::Module( Module* parent, std::string name)
     : parent( parent), name( std::move( name))
 {
@@ -104,6 +110,38 @@ pt::ptree Module::topology_dumping_impl() const
     return topology;
 }
 
+void Module::statistics_dumping_impl( std::ostream& out, const std::string& prefix) const
+{
+    subtree_statistics_dumping( out, prefix + name + ".");
+}
+
+void Module::statistics_dumping_impl( pt::ptree* modules) const
+{
+    modules->add_child( name, subtree_statistics_dumping());
+}
+
+// NOLINTNEXTLINE(misc-no-recursion) Recursive, but must be finite
+void Module::subtree_statistics_dumping( std::ostream& out, const std::string& path) const
+{
+    statistics.dump( out, path);
+    for ( const auto& c : children)
+        c->subtree_statistics_dumping( out, path + c->name + ".");
+    for ( const auto& [module, key] : statistics_children)
+        module->subtree_statistics_dumping( out, path + key + ".");
+}
+
+// NOLINTNEXTLINE(misc-no-recursion) Recursive, but must be finite
+pt::ptree Module::subtree_statistics_dumping() const
+{
+    pt::ptree module;
+    statistics.dump( &module);
+    for ( const auto& c : children)
+        module.add_child( c->name, c->subtree_statistics_dumping());
+    for ( const auto& [child, key] : statistics_children)
+        module.add_child( key, child->subtree_statistics_dumping());
+    return module;
+}
+
 pt::ptree Root::portmap_dumping() const
 {
     return portmap->dump();
@@ -125,3 +163,16 @@ void Root::topology_dumping( bool dump, const std::string& filename)
     pt::write_json( filename, topology);
     sout << std::endl << "Module topology dumped into " + filename << std::endl;
 }
+
+void Root::statistics_dumping( const std::string& filename) const
+{
+    if ( filename.empty())
+        return;
+
+    pt::ptree tree;
+    statistics_dumping_impl( &tree);
+    std::ofstream out( filename);
+    if ( !out.is_open())
+        throw InvalidStatisticsFile( filename);
+    write_statistics_json( out, tree);
+}
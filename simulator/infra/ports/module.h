@@ -7,14 +7,20 @@
 #ifndef INFRA_PORTS_MODULE_H
 #define INFRA_PORTS_MODULE_H
  
+#include <infra/config/config.h>
 #include <infra/log.h>
 #include <infra/ports/ports.h>
+#include <infra/statistics/statistics.h>
 
 #include <boost/property_tree/ptree_fwd.hpp>
 
 #include <set>
 #include <unordered_set>
 
+namespace config {
+    extern const Value<std::string> stats_json;
+} // namespace config
+
 class Module : public Log
 {
 public:
@@ -39,8 +45,33 @@ protected:
         return ptr;
     }
 
+    // statistics are owned by the module, so the pointers are valid for its lifetime
+    Counter* make_counter( const std::string& key, std::string description)
+    {
+        return statistics.add_counter( key, std::move( description));
+    }
+
+    Distribution* make_distribution( const std::string& key, std::string description, size_t buckets_num, uint64 bucket_size)
+    {
+        return statistics.add_distribution( key, std::move( description), buckets_num, bucket_size);
+    }
+
+    void make_formula( const std::string& key, std::string description, Formula formula)
+    {
+        statistics.add_formula( key, std::move( description), std::move( formula));
+    }
+
+    // statistics of a separate module tree are dumped as a child named 'key',
+    // e.g. cores of a multi-core simulator are nested in its statistics
+    void add_statistics_child( const Module* module, std::string key)
+    {
+        statistics_children.emplace_back( module, std::move( key));
+    }
+
     void enable_logging_impl( const std::unordered_set<std::string>& names);
     boost::property_tree::ptree topology_dumping_impl() const;
+    void statistics_dumping_impl( std::ostream& out, const std::string& prefix) const;
+    void statistics_dumping_impl( boost::property_tree::ptree* modules) const;
 
 private:
     // NOLINTNEXTLINE(misc-no-recursion) Recursive, but must be finite
@@ -57,11 +88,16 @@ private:
     void module_dumping( boost::property_tree::ptree* modules) const;
     void modulemap_dumping( boost::property_tree::ptree* modulemap) const;
 
+    void subtree_statistics_dumping( std::ostream& out, const std::string& path) const;
+    boost::property_tree::ptree subtree_statistics_dumping() const;
+
     Module* const parent;
     std::vector<Module*> children;
     const std::string name;
     std::vector<std::unique_ptr<BasicWritePort>> write_ports;
     std::vector<std::unique_ptr<BasicReadPort>> read_ports;
+    StatisticsSet statistics;
+    std::vector<std::pair<const Module*, std::string>> statistics_children;
 };
 
 class Root : public Module
@@ -78,6 +114,12 @@ protected:
     
     void topology_dumping( bool dump, const std::string& filename);
 
+    // human-readable lines named by paths in the module tree
+    void statistics_dumping( std::ostream& out) const { statistics_dumping_impl( out, ""); }
+
+    // JSON object mirroring the module tree, nothing is written if the file name is empty
+    void statistics_dumping( const std::string& filename) const;
+
 private:
     std::shared_ptr<PortMap> get_portmap() const final { return portmap; }
     std::shared_ptr<PortMap> portmap;
@@ -126,7 +126,7 @@ template<class T> class ReadPort;
 template<class T> class WritePort : public BasicWritePort
 {
 public:
-    WritePort<T>( const std::shared_ptr<PortMap>& port_map, const std::string& key, uint32 bandwidth)
+    WritePort( const std::shared_ptr<PortMap>& port_map, const std::string& key, uint32 bandwidth)
         : BasicWritePort( port_map, key, bandwidth)
     { }
 
@@ -153,7 +153,7 @@ private:
 template<class T> class ReadPort : public BasicReadPort
 {
 public:
-    ReadPort<T>( const std::shared_ptr<PortMap>& port_map, const std::string& key, Latency latency)
+    ReadPort( const std::shared_ptr<PortMap>& port_map, const std::string& key, Latency latency)
         : BasicReadPort( port_map, key, latency)
     { }
 
@@ -42,6 +42,7 @@ class Cycle
             return is >> cycle.value;
         }
         std::string to_string() const { return std::to_string( value); }
+        constexpr uint64 to_uint64() const { return value; }
 
     private:
         uint64 value;
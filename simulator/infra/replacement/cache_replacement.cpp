@@ -7,7 +7,9 @@
 #include "infra/replacement/cache_replacement.h"
 #include "infra/macro.h"
 
+#include <algorithm>
 #include <list>
+#include <ostream>
 #include <vector>
 
 class LRU : public CacheReplacement
@@ -115,13 +117,191 @@ void PseudoLRU::set_to_erase( std::size_t /* way */)
 
 ////////////////////////////////////////////////////////////////////////////////////
 
-std::unique_ptr<CacheReplacement> create_cache_replacement( const std::string& name, std::size_t ways)
+/*
+ * Re-Reference Interval Prediction keeps a 2-bit prediction per way.
+ * A hit predicts a near re-reference, the victim is a line with a distant one.
+ * Lines are inserted with a long interval (SRRIP), mostly with a distant one (BRRIP),
+ * or by the policy which misses less in leader sets (DRRIP).
+ */
+class RRIP : public CacheReplacement
+{
+    public:
+        enum class Insertion { Static, Bimodal, Dynamic };
+
+        RRIP( std::size_t ways, Insertion insertion, std::size_t set, std::size_t sets, std::shared_ptr<SharedReplacementState> state);
+        void touch( std::size_t way) override { intervals[ way] = 0; }
+        void set_to_erase( std::size_t way) override { intervals[ way] = DISTANT; }
+        std::size_t update() override;
+        std::size_t get_ways() const override { return intervals.size(); }
+
+    private:
+        static const constexpr uint8 DISTANT = 3;
+        static const constexpr std::size_t DUELING_PERIOD = 32;
+
+        bool is_bimodal_insertion();
+
+        std::vector<uint8> intervals;
+        Insertion insertion;
+        const std::shared_ptr<SharedReplacementState> state;
+};
+
+RRIP::RRIP( std::size_t ways, Insertion insertion, std::size_t set, std::size_t sets, std::shared_ptr<SharedReplacementState> state)
+    : intervals( ways, DISTANT)
+    , insertion( insertion)
+    , state( std::move( state))
+{
+    if ( insertion != Insertion::Dynamic)
+        return;
+
+    if ( sets < 2)
+        throw CacheReplacementException( "DRRIP needs at least 2 sets for set dueling");
+
+    // leaders are spread over the cache, other sets follow the winner;
+    // small caches have leaders of both policies in a closer spacing
+    const auto period = std::min( DUELING_PERIOD, sets);
+    if ( set % period == 0)
+        this->insertion = Insertion::Static;
+    else if ( set % period == period / 2)
+        this->insertion = Insertion::Bimodal;
+}
+
+bool RRIP::is_bimodal_insertion()
+{
+    if ( insertion != Insertion::Dynamic) {
+        const bool is_bimodal = insertion == Insertion::Bimodal;
+        state->count_leader_miss( is_bimodal);
+        return is_bimodal;
+    }
+
+    const bool is_bimodal = state->is_bimodal_winning();
+    ++( is_bimodal ? state->statistics.brrip_wins : state->statistics.srrip_wins);
+    return is_bimodal;
+}
+
+std::size_t RRIP::update()
+{
+    // age all lines until some of them is predicted to be distant
+    auto victim = std::find( intervals.begin(), intervals.end(), DISTANT);
+    if ( victim == intervals.end()) {
+        const auto oldest = *std::max_element( intervals.begin(), intervals.end());
+        for ( auto& interval : intervals)
+            interval += DISTANT - oldest;
+        victim = std::find( intervals.begin(), intervals.end(), DISTANT);
+    }
+
+    if ( is_bimodal_insertion() && !state->is_bimodal_near()) {
+        ++state->statistics.distant_insertions;
+        *victim = DISTANT;
+    }
+    else {
+        ++state->statistics.near_insertions;
+        *victim = DISTANT - 1;
+    }
+    return narrow_cast<std::size_t>( victim - intervals.begin());
+}
+
+//////////////////////////////////////////////////////////////////
+
+// Hits do not change the order of lines
+class FIFO : public CacheReplacement
+{
+    public:
+        explicit FIFO( std::size_t ways) : insertions( ways, 0) { }
+        void touch( std::size_t /* unused */) override { }
+        void set_to_erase( std::size_t way) override { insertions[ way] = 0; }
+        std::size_t update() override;
+        std::size_t get_ways() const override { return insertions.size(); }
+
+    private:
+        std::vector<uint64> insertions; // zero is for empty ways
+        uint64 counter = 0;
+};
+
+std::size_t FIFO::update()
+{
+    const auto victim = std::min_element( insertions.begin(), insertions.end());
+    *victim = ++counter;
+    return narrow_cast<std::size_t>( victim - insertions.begin());
+}
+
+//////////////////////////////////////////////////////////////////
+
+// Empty ways are filled first, then victims are random
+class RandomReplacement : public CacheReplacement
+{
+    public:
+        RandomReplacement( std::size_t ways, std::shared_ptr<SharedReplacementState> state)
+            : ways( ways), state( std::move( state))
+        { }
+        void touch( std::size_t /* unused */) override { }
+        void set_to_erase( std::size_t /* unused */) override;
+        std::size_t update() override { return filled < ways ? filled++ : state->get_random( ways); }
+        std::size_t get_ways() const override { return ways; }
+
+    private:
+        const std::size_t ways;
+        std::size_t filled = 0;
+        const std::shared_ptr<SharedReplacementState> state;
+};
+
+void RandomReplacement::set_to_erase( std::size_t /* way */)
+{
+    throw CacheReplacementException( "Random replacement does not support inverted access");
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+void SharedReplacementState::count_leader_miss( bool is_bimodal_leader)
+{
+    if ( is_bimodal_leader)
+        selector = selector > 0 ? selector - 1 : 0;
+    else
+        selector = std::min( selector + 1, SELECTOR_MAX);
+}
+
+std::size_t SharedReplacementState::get_random( std::size_t limit)
+{
+    return std::uniform_int_distribution<std::size_t>( 0, limit - 1)( generator);
+}
+
+std::ostream& operator<<( std::ostream& out, const ReplacementStatistics& rhs)
+{
+    out << "insertions: " << rhs.near_insertions << " near, " << rhs.distant_insertions << " distant";
+    if ( rhs.srrip_wins + rhs.brrip_wins != 0)
+        out << "; dueling winners: SRRIP " << rhs.srrip_wins << ", BRRIP " << rhs.brrip_wins;
+
+    return out;
+}
+
+std::unique_ptr<CacheReplacement> create_cache_replacement( const std::string& name, std::size_t ways,
+                                                            std::size_t set,
+                                                            std::shared_ptr<SharedReplacementState> state,
+                                                            std::size_t sets)
 {
+    if ( state == nullptr && name != "LRU" && name != "pseudo-LRU" && name != "FIFO")
+        state = std::make_shared<SharedReplacementState>();
+
     if (name == "LRU")
         return std::make_unique<LRU>( ways);
 
     if (name == "pseudo-LRU")
         return std::make_unique<PseudoLRU>( ways);
 
-    throw CacheReplacementException("\"" + name + "\" replacement policy is not defined, supported polices are:\nLRU\npseudo-LRU\n");
+    if (name == "SRRIP")
+        return std::make_unique<RRIP>( ways, RRIP::Insertion::Static, set, sets, std::move( state));
+
+    if (name == "BRRIP")
+        return std::make_unique<RRIP>( ways, RRIP::Insertion::Bimodal, set, sets, std::move( state));
+
+    if (name == "DRRIP")
+        return std::make_unique<RRIP>( ways, RRIP::Insertion::Dynamic, set, sets, std::move( state));
+
+    if (name == "FIFO")
+        return std::make_unique<FIFO>( ways);
+
+    if (name == "random")
+        return std::make_unique<RandomReplacement>( ways, std::move( state));
+
+    throw CacheReplacementException("\"" + name + "\" replacement policy is not defined, supported polices are:\n"
+                                    "LRU\npseudo-LRU\nSRRIP\nBRRIP\nDRRIP\nFIFO\nrandom\n");
 }
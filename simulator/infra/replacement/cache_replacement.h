@@ -8,8 +8,11 @@
 #define CACHEREPLACEMENT_H
 
 #include <infra/exception.h>
+#include <infra/types.h>
 
+#include <iosfwd>
 #include <memory>
+#include <random>
 
 struct CacheReplacementException final : Exception
 {
@@ -34,6 +37,59 @@ public:
     virtual std::size_t get_ways() const = 0;
 };
 
-std::unique_ptr<CacheReplacement> create_cache_replacement( const std::string& name, std::size_t ways);
+struct ReplacementStatistics
+{
+    // RRIP insertion positions
+    uint64 near_insertions = 0;     // long re-reference interval
+    uint64 distant_insertions = 0;  // distant re-reference interval
+
+    // DRRIP set dueling: policy used by follower sets on misses
+    uint64 srrip_wins = 0;
+    uint64 brrip_wins = 0;
+
+    bool empty() const noexcept { return near_insertions + distant_insertions == 0; }
+    friend std::ostream& operator<<( std::ostream& out, const ReplacementStatistics& rhs);
+};
+
+/*
+ * State shared by replacement modules of all sets of a cache:
+ * the set dueling selector, the bimodal throttle and the random generator.
+ */
+class SharedReplacementState
+{
+public:
+    static const constexpr uint32 DEFAULT_SEED = 5489;
+
+    explicit SharedReplacementState( uint32 seed = DEFAULT_SEED) : generator( seed) { }
+
+    // BRRIP inserts every BIMODAL_PERIOD-th line with a long interval
+    bool is_bimodal_near() { return ++bimodal_insertions % BIMODAL_PERIOD == 0; }
+
+    // Misses of leader sets move the selector towards the other policy
+    void count_leader_miss( bool is_bimodal_leader);
+    bool is_bimodal_winning() const noexcept { return selector > SELECTOR_MAX / 2; }
+
+    std::size_t get_random( std::size_t limit);
+
+    ReplacementStatistics statistics;
+
+private:
+    static const constexpr uint32 BIMODAL_PERIOD = 32;
+    static const constexpr uint32 SELECTOR_MAX = ( 1U << 10U) - 1;
+
+    uint64 bimodal_insertions = 0;
+    uint32 selector = SELECTOR_MAX / 2;
+    std::mt19937 generator;
+};
+
+/*
+ * Modules of different sets of the same cache have to share the state,
+ * otherwise each module gets its own one.
+ * DRRIP places leader sets by the set index among 'sets' sets of the cache.
+ */
+std::unique_ptr<CacheReplacement> create_cache_replacement( const std::string& name, std::size_t ways,
+                                                            std::size_t set = 0,
+                                                            std::shared_ptr<SharedReplacementState> state = nullptr,
+                                                            std::size_t sets = 1);
 
 #endif // CACHEREPLACEMENT_H
@@ -3,10 +3,14 @@
  * @author Andrey Agrachev
  */
 
+#include <infra/macro.h>
 #include <infra/replacement/cache_replacement.h>
 
 #include <catch.hpp>
 
+#include <algorithm>
+#include <vector>
+
 TEST_CASE( "Check_bad_string_pass_to_factory_method")
 {
     CHECK_THROWS_AS( create_cache_replacement( "BAD STRING", 3), CacheReplacementException);
@@ -131,3 +135,157 @@ TEST_CASE ( "Pseudo-LRU: Check_touch_method_with_big_number_of elements")
     CHECK( test_lru_module->update() == 1024);
     CHECK( test_lru_module->update() == 512);
 }
+
+TEST_CASE( "SRRIP: empty ways are filled in order")
+{
+    auto module = create_cache_replacement( "SRRIP", 4);
+    CHECK( module->update() == 0);
+    CHECK( module->update() == 1);
+    CHECK( module->update() == 2);
+    CHECK( module->update() == 3);
+}
+
+TEST_CASE( "SRRIP: hit lines survive a scan")
+{
+    auto module = create_cache_replacement( "SRRIP", 4);
+    for ( std::size_t i = 0; i < 4; ++i)
+        module->update();
+
+    module->touch( 0);
+    module->touch( 1);
+
+    // scanned lines are inserted with a long interval and evict each other
+    for ( int i = 0; i < 4; ++i) {
+        const auto victim = module->update();
+        CHECK( victim != 0);
+        CHECK( victim != 1);
+    }
+}
+
+TEST_CASE( "SRRIP: set_to_erase makes the way a victim")
+{
+    auto module = create_cache_replacement( "SRRIP", 4);
+    for ( std::size_t i = 0; i < 4; ++i)
+        module->update();
+
+    module->set_to_erase( 2);
+    CHECK( module->update() == 2);
+}
+
+// Cyclic accesses to a working set which exceeds the set by one line
+static uint64 count_thrashing_hits( const std::string& policy)
+{
+    const std::size_t ways = 4;
+    auto module = create_cache_replacement( policy, ways);
+    std::vector<std::size_t> lines( ways, ways + 1);
+    uint64 hits = 0;
+    for ( std::size_t i = 0; i < 1000; ++i) {
+        const auto line = i % ( ways + 1);
+        const auto way = std::find( lines.begin(), lines.end(), line);
+        if ( way != lines.end()) {
+            ++hits;
+            module->touch( narrow_cast<std::size_t>( way - lines.begin()));
+        }
+        else {
+            lines[ module->update()] = line;
+        }
+    }
+    return hits;
+}
+
+TEST_CASE( "BRRIP: thrash resistance")
+{
+    CHECK( count_thrashing_hits( "LRU") == 0);
+    CHECK( count_thrashing_hits( "FIFO") == 0);
+    CHECK( count_thrashing_hits( "SRRIP") < count_thrashing_hits( "BRRIP"));
+    CHECK( count_thrashing_hits( "BRRIP") > 500);
+}
+
+TEST_CASE( "BRRIP: statistics of insertions")
+{
+    auto state = std::make_shared<SharedReplacementState>();
+    auto module = create_cache_replacement( "BRRIP", 4, 0, state);
+    for ( int i = 0; i < 64; ++i)
+        module->update();
+
+    CHECK( state->statistics.near_insertions == 2);
+    CHECK( state->statistics.distant_insertions == 62);
+    CHECK( state->statistics.srrip_wins + state->statistics.brrip_wins == 0);
+}
+
+TEST_CASE( "DRRIP: followers pick the policy of the better leader")
+{
+    auto state = std::make_shared<SharedReplacementState>();
+    auto srrip_leader = create_cache_replacement( "DRRIP", 4, 0, state, 64);
+    auto brrip_leader = create_cache_replacement( "DRRIP", 4, 16, state, 64);
+    auto follower = create_cache_replacement( "DRRIP", 4, 1, state, 64);
+
+    // a tie is resolved to SRRIP
+    follower->update();
+    CHECK( state->statistics.srrip_wins == 1);
+
+    // SRRIP leader misses more
+    for ( int i = 0; i < 10; ++i)
+        srrip_leader->update();
+    brrip_leader->update();
+
+    follower->update();
+    CHECK( state->statistics.brrip_wins == 1);
+
+    for ( int i = 0; i < 20; ++i)
+        brrip_leader->update();
+
+    follower->update();
+    CHECK( state->statistics.srrip_wins == 2);
+}
+
+TEST_CASE( "DRRIP: leaders of a small cache")
+{
+    CHECK_THROWS_AS( create_cache_replacement( "DRRIP", 4, 0, nullptr, 1), CacheReplacementException);
+
+    // 8 sets: set 0 is the SRRIP leader, set 4 is the BRRIP leader
+    auto state = std::make_shared<SharedReplacementState>();
+    auto brrip_leader = create_cache_replacement( "DRRIP", 4, 4, state, 8);
+    auto follower = create_cache_replacement( "DRRIP", 4, 5, state, 8);
+
+    brrip_leader->update();
+    CHECK( state->statistics.distant_insertions == 1);
+
+    follower->update();
+    CHECK( state->statistics.srrip_wins == 1);
+}
+
+TEST_CASE( "FIFO: hits do not change the order")
+{
+    auto module = create_cache_replacement( "FIFO", 4);
+    for ( std::size_t i = 0; i < 4; ++i)
+        CHECK( module->update() == i);
+
+    module->touch( 0);
+    CHECK( module->update() == 0);
+    module->set_to_erase( 3);
+    CHECK( module->update() == 3);
+    CHECK( module->update() == 1);
+}
+
+TEST_CASE( "Random: reproducible with the same seed")
+{
+    auto first = create_cache_replacement( "random", 8, 0, std::make_shared<SharedReplacementState>( 42));
+    auto second = create_cache_replacement( "random", 8, 0, std::make_shared<SharedReplacementState>( 42));
+    for ( std::size_t i = 0; i < 8; ++i)
+        CHECK( first->update() == i);
+    for ( std::size_t i = 0; i < 8; ++i)
+        second->update();
+
+    bool is_different = false;
+    std::size_t previous = first->update();
+    CHECK( previous == second->update());
+    for ( int i = 0; i < 100; ++i) {
+        const auto victim = first->update();
+        CHECK( victim < 8);
+        CHECK( victim == second->update());
+        is_different |= victim != previous;
+    }
+    CHECK( is_different);
+    CHECK_THROWS_AS( first->set_to_erase( 0), CacheReplacementException);
+}
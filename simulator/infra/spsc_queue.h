@@ -0,0 +1,78 @@
+/**
+ * spsc_queue.h - lock-free bounded queue
+ * for a single producer thread and a single consumer thread
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+template<typename T>
+class SPSCQueue
+{
+public:
+    explicit SPSCQueue( size_t capacity)
+        : buffer( std::bit_ceil( capacity))
+        , mask( buffer.size() - 1)
+    { }
+
+    // Called by the producer only
+    bool try_push( T&& value)
+    {
+        const auto t = tail.load( std::memory_order_relaxed);
+        if ( t - cached_head == buffer.size()) {
+            cached_head = head.load( std::memory_order_acquire);
+            if ( t - cached_head == buffer.size())
+                return false;
+        }
+        buffer[ t & mask].emplace( std::move( value));
+        tail.store( t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Called by the consumer only
+    std::optional<T> try_pop()
+    {
+        const auto h = head.load( std::memory_order_relaxed);
+        if ( h == cached_tail) {
+            cached_tail = tail.load( std::memory_order_acquire);
+            if ( h == cached_tail)
+                return std::nullopt;
+        }
+        auto& slot = buffer[ h & mask];
+        std::optional<T> result( std::move( slot));
+        slot.reset();
+        head.store( h + 1, std::memory_order_release);
+        return result;
+    }
+
+    bool empty() const noexcept
+    {
+        return head.load( std::memory_order_acquire) == tail.load( std::memory_order_acquire);
+    }
+
+    size_t capacity() const noexcept { return buffer.size(); }
+
+private:
+    static constexpr const size_t CACHE_LINE = 64;
+
+    // Elements are not required to be assignable
+    std::vector<std::optional<T>> buffer;
+    const size_t mask;
+
+    // Each side owns its index and caches the other one,
+    // so the shared cache lines are touched only if the queue looks full or empty
+    alignas(CACHE_LINE) std::atomic<size_t> head = 0;
+    size_t cached_tail = 0;
+
+    alignas(CACHE_LINE) std::atomic<size_t> tail = 0;
+    size_t cached_head = 0;
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,172 @@
+/*
+ * statistics.cpp - registry of performance counters
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "statistics.h"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace pt = boost::property_tree;
+
+Distribution::Distribution( size_t buckets_num, uint64 bucket_size)
+    : bucket_size( std::max<uint64>( bucket_size, 1))
+    , buckets( std::max<size_t>( buckets_num, 1), 0)
+{ }
+
+double Distribution::get_mean() const noexcept
+{
+    return samples != 0 ? 1.0 * sum / samples : NAN;
+}
+
+Formula make_ratio( const Counter* piece, const Counter* total)
+{
+    return [piece, total]() { return total->get() != 0 ? 1.0 * piece->get() / total->get() : NAN; };
+}
+
+Formula make_value( const uint64* value)
+{
+    return [value]() { return 1.0 * *value; };
+}
+
+Formula make_ratio( const uint64* piece, const uint64* total)
+{
+    return [piece, total]() { return *total != 0 ? 1.0 * *piece / *total : NAN; };
+}
+
+StatisticsSet::Entry* StatisticsSet::add_entry( const std::string& name, std::string description)
+{
+    if ( std::any_of( entries.begin(), entries.end(), [&name]( const Entry& e) { return e.name == name; }))
+        throw DuplicateStatistic( name);
+
+    entries.push_back( Entry{ name, std::move( description), nullptr, nullptr, nullptr});
+    return &entries.back();
+}
+
+Counter* StatisticsSet::add_counter( const std::string& name, std::string description)
+{
+    auto* entry = add_entry( name, std::move( description));
+    entry->counter = std::make_unique<Counter>();
+    return entry->counter.get();
+}
+
+Distribution* StatisticsSet::add_distribution( const std::string& name, std::string description, size_t buckets_num, uint64 bucket_size)
+{
+    auto* entry = add_entry( name, std::move( description));
+    entry->distribution = std::make_unique<Distribution>( buckets_num, bucket_size);
+    return entry->distribution.get();
+}
+
+void StatisticsSet::add_formula( const std::string& name, std::string description, Formula formula)
+{
+    add_entry( name, std::move( description))->formula = std::move( formula);
+}
+
+// integral values are printed without exponents, undefined values are JSON nulls
+static std::string format_value( double value)
+{
+    if ( !std::isfinite( value))
+        return "null";
+
+    std::ostringstream oss;
+    if ( value == std::floor( value) && std::abs( value) < 1e15)
+        oss << static_cast<int64>( value);
+    else
+        oss << value;
+    return oss.str();
+}
+
+static std::string format_value( uint64 value)
+{
+    return std::to_string( value);
+}
+
+static std::string get_bucket_name( const Distribution& distribution, size_t index)
+{
+    const auto low = index * distribution.get_bucket_size();
+    if ( index + 1 == distribution.get_buckets_num())
+        return std::to_string( low) + "+";
+    if ( distribution.get_bucket_size() == 1)
+        return std::to_string( low);
+    return std::to_string( low) + "-" + std::to_string( low + distribution.get_bucket_size() - 1);
+}
+
+// Distribution is flattened to a list of named values
+static std::vector<std::pair<std::string, std::string>> get_values( const Distribution& distribution)
+{
+    std::vector<std::pair<std::string, std::string>> values = {
+        { "samples", format_value( distribution.get_samples())},
+        { "mean",    format_value( distribution.get_mean())},
+        { "min",     format_value( distribution.get_min())},
+        { "max",     format_value( distribution.get_max())}
+    };
+    for ( size_t i = 0; i < distribution.get_buckets_num(); ++i)
+        values.emplace_back( "buckets." + get_bucket_name( distribution, i), format_value( distribution.get_bucket( i)));
+    return values;
+}
+
+void StatisticsSet::dump( std::ostream& out, const std::string& prefix) const
+{
+    const auto print_line = [&]( const std::string& name, const std::string& value, const std::string& description) {
+        out << std::left << std::setw( 48) << prefix + name << ' ';
+        if ( description.empty())
+            out << value;
+        else
+            out << std::setw( 16) << value << " # " << description;
+        out << std::right << '\n';
+    };
+
+    for ( const auto& entry : entries) {
+        if ( entry.counter != nullptr)
+            print_line( entry.name, format_value( entry.counter->get()), entry.description);
+        else if ( entry.formula != nullptr)
+            print_line( entry.name, format_value( entry.formula()), entry.description);
+        else
+            for ( const auto& [name, value] : get_values( *entry.distribution))
+                if ( value != "0" || !name.starts_with( "buckets."))
+                    print_line( entry.name + "." + name, value, name == "samples" ? entry.description : "");
+    }
+}
+
+void StatisticsSet::dump( pt::ptree* tree) const
+{
+    for ( const auto& entry : entries) {
+        if ( entry.counter != nullptr)
+            tree->put( entry.name, format_value( entry.counter->get()));
+        else if ( entry.formula != nullptr)
+            tree->put( entry.name, format_value( entry.formula()));
+        else
+            for ( const auto& [name, value] : get_values( *entry.distribution))
+                tree->put( entry.name + "." + name, value);
+    }
+}
+
+// NOLINTNEXTLINE(misc-no-recursion) Recursive, but must be finite
+static void write_json_node( std::ostream& out, const pt::ptree& node, size_t indent)
+{
+    if ( node.empty() && !node.data().empty()) {
+        out << node.data();
+        return;
+    }
+
+    out << '{';
+    const char* separator = "\n";
+    for ( const auto& [key, child] : node) {
+        out << separator << std::string( indent + 4, ' ') << '"' << key << "\": ";
+        write_json_node( out, child, indent + 4);
+        separator = ",\n";
+    }
+    if ( !node.empty())
+        out << '\n' << std::string( indent, ' ');
+    out << '}';
+}
+
+void write_statistics_json( std::ostream& out, const pt::ptree& tree)
+{
+    write_json_node( out, tree, 0);
+    out << '\n';
+}
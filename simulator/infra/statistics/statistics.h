@@ -0,0 +1,133 @@
+/*
+ * statistics.h - registry of performance counters
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef INFRA_STATISTICS_H
+#define INFRA_STATISTICS_H
+
+#include <infra/exception.h>
+#include <infra/types.h>
+
+#include <boost/property_tree/ptree_fwd.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct DuplicateStatistic final : Exception
+{
+    explicit DuplicateStatistic( const std::string& name)
+        : Exception( "Statistic is registered twice", name)
+    { }
+};
+
+struct InvalidStatisticsFile final : Exception
+{
+    explicit InvalidStatisticsFile( const std::string& filename)
+        : Exception( "Invalid statistics file", "cannot open " + filename)
+    { }
+};
+
+// Incremented on the hot path, so it is a plain integer
+class Counter
+{
+public:
+    Counter& operator++() noexcept { ++value; return *this; }
+    Counter& operator+=( uint64 delta) noexcept { value += delta; return *this; }
+    uint64 get() const noexcept { return value; }
+
+private:
+    uint64 value = 0;
+};
+
+// Buckets are of the same size, the last one collects all larger values
+class Distribution
+{
+public:
+    Distribution( size_t buckets_num, uint64 bucket_size);
+
+    void add( uint64 value) noexcept
+    {
+        ++samples;
+        sum += value;
+        min = std::min( min, value);
+        max = std::max( max, value);
+        ++buckets[ std::min<uint64>( value / bucket_size, buckets.size() - 1)];
+    }
+
+    uint64 get_samples() const noexcept { return samples; }
+    uint64 get_min() const noexcept { return samples != 0 ? min : 0; }
+    uint64 get_max() const noexcept { return max; }
+    double get_mean() const noexcept;
+    uint64 get_bucket( size_t index) const { return buckets.at( index); }
+    size_t get_buckets_num() const noexcept { return buckets.size(); }
+    uint64 get_bucket_size() const noexcept { return bucket_size; }
+
+private:
+    const uint64 bucket_size;
+    std::vector<uint64> buckets;
+    uint64 samples = 0;
+    uint64 sum = 0;
+    uint64 min = MAX_VAL64;
+    uint64 max = 0;
+};
+
+// Computed from other statistics at the dump, NaN is for undefined values
+using Formula = std::function<double()>;
+
+// Share of events, it is undefined if there are no events at all
+Formula make_ratio( const Counter* piece, const Counter* total);
+
+// Counters kept by a model outside of modules, like a cache, are registered as formulas
+Formula make_value( const uint64* value);
+Formula make_ratio( const uint64* piece, const uint64* total);
+
+// Statistics of a model to be registered by the module using it
+struct NamedFormula
+{
+    std::string name;
+    std::string description;
+    Formula formula;
+};
+
+/*
+ * Statistics of a single module in the order of registration.
+ * Dots in names group statistics, like 'l1i.hits' and 'l1i.misses'.
+ */
+class StatisticsSet
+{
+public:
+    Counter* add_counter( const std::string& name, std::string description);
+    Distribution* add_distribution( const std::string& name, std::string description, size_t buckets_num, uint64 bucket_size);
+    void add_formula( const std::string& name, std::string description, Formula formula);
+
+    bool empty() const noexcept { return entries.empty(); }
+
+    // 'prefix.name value # description' lines, empty buckets of distributions are skipped
+    void dump( std::ostream& out, const std::string& prefix) const;
+
+    // leaves are numbers and nulls in JSON notation
+    void dump( boost::property_tree::ptree* tree) const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        std::string description;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Distribution> distribution;
+        Formula formula;
+    };
+    std::vector<Entry> entries;
+
+    Entry* add_entry( const std::string& name, std::string description);
+};
+
+// Unlike boost::property_tree::write_json, numbers are not quoted
+void write_statistics_json( std::ostream& out, const boost::property_tree::ptree& tree);
+
+#endif // INFRA_STATISTICS_H
@@ -0,0 +1,142 @@
+/*
+ * Unit tests for the registry of performance counters
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include <catch.hpp>
+
+#include <infra/ports/module.h>
+#include <infra/statistics/statistics.h>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <cmath>
+#include <sstream>
+
+namespace pt = boost::property_tree;
+
+TEST_CASE( "Statistics: counter")
+{
+    Counter counter;
+    ++counter;
+    counter += 5;
+    CHECK( counter.get() == 6);
+}
+
+TEST_CASE( "Statistics: distribution")
+{
+    Distribution distribution( 4, 10);
+    CHECK( distribution.get_min() == 0);
+    CHECK( std::isnan( distribution.get_mean()));
+
+    for ( uint64 value : { 3, 15, 17, 100})
+        distribution.add( value);
+
+    CHECK( distribution.get_samples() == 4);
+    CHECK( distribution.get_min() == 3);
+    CHECK( distribution.get_max() == 100);
+    CHECK( distribution.get_mean() == 33.75);
+    CHECK( distribution.get_bucket( 0) == 1);
+    CHECK( distribution.get_bucket( 1) == 2);
+    CHECK( distribution.get_bucket( 2) == 0);
+    CHECK( distribution.get_bucket( 3) == 1);
+}
+
+TEST_CASE( "Statistics: duplicate name")
+{
+    StatisticsSet set;
+    set.add_counter( "hits", "");
+    CHECK_THROWS_AS( set.add_formula( "hits", "", []() { return 0.0; }), DuplicateStatistic);
+}
+
+TEST_CASE( "Statistics: human-readable dump")
+{
+    StatisticsSet set;
+    auto* hits = set.add_counter( "hits", "cache hits");
+    auto* accesses = set.add_counter( "accesses", "");
+    set.add_formula( "hit_rate", "", make_ratio( hits, accesses));
+    auto* latency = set.add_distribution( "latency", "access latency", 2, 1);
+
+    std::ostringstream empty;
+    set.dump( empty, "cache.");
+    CHECK_THAT( empty.str(), Catch::Contains( "cache.hit_rate ") && Catch::Contains( " null"));
+
+    ++*hits;
+    *accesses += 4;
+    latency->add( 7);
+    latency->add( 9);
+
+    std::ostringstream oss;
+    set.dump( oss, "cache.");
+    std::istringstream lines( oss.str());
+    std::string line;
+    std::getline( lines, line);
+    CHECK_THAT( line, Catch::StartsWith( "cache.hits ") && Catch::Contains( " 1 ") && Catch::EndsWith( " # cache hits"));
+    std::getline( lines, line);
+    CHECK_THAT( line, Catch::StartsWith( "cache.accesses ") && !Catch::Contains( "#"));
+    std::getline( lines, line);
+    CHECK_THAT( line, Catch::StartsWith( "cache.hit_rate ") && Catch::EndsWith( " 0.25"));
+    std::getline( lines, line);
+    CHECK_THAT( line, Catch::StartsWith( "cache.latency.samples ") && Catch::EndsWith( " # access latency"));
+    CHECK_THAT( oss.str(), Catch::Contains( "cache.latency.mean" + std::string( 31, ' ') + "8\n")
+                        && !Catch::Contains( "cache.latency.buckets.0 ") && Catch::Contains( "cache.latency.buckets.1+ "));
+}
+
+struct StatisticsTopology : public Root
+{
+    struct Stage : public Module
+    {
+        Counter* instrs = nullptr;
+        explicit Stage( Module* parent, const std::string& name) : Module( parent, name)
+        {
+            instrs = make_counter( "instrs", "instructions");
+            make_formula( "cache.miss_rate", "", []() { return 0.5; });
+        }
+    };
+
+    Stage fetch;
+    Stage decode;
+
+    StatisticsTopology() : Root( "cpu"), fetch( this, "fetch"), decode( &fetch, "decode")
+    {
+        make_formula( "ipc", "", []() { return NAN; });
+    }
+
+    auto dump_text() const
+    {
+        std::ostringstream oss;
+        statistics_dumping( oss);
+        return oss.str();
+    }
+
+    auto dump_json() const
+    {
+        pt::ptree tree;
+        statistics_dumping_impl( &tree);
+        std::ostringstream oss;
+        write_statistics_json( oss, tree);
+        return oss.str();
+    }
+};
+
+TEST_CASE( "Statistics: module tree")
+{
+    StatisticsTopology t;
+    ++*t.fetch.instrs;
+    *t.decode.instrs += 2;
+
+    CHECK_THAT( t.dump_text(), Catch::Contains( "cpu.ipc ")
+                            && Catch::Contains( "cpu.fetch.instrs ")
+                            && Catch::Contains( "cpu.fetch.decode.cache.miss_rate "));
+
+    const auto json = t.dump_json();
+    CHECK_THAT( json, Catch::Contains( "\"instrs\": 2") && Catch::Contains( "\"ipc\": null"));
+
+    pt::ptree tree;
+    std::istringstream iss( json);
+    pt::read_json( iss, tree);
+    CHECK( tree.get<uint64>( "cpu.fetch.instrs") == 1);
+    CHECK( tree.get<uint64>( "cpu.fetch.decode.instrs") == 2);
+    CHECK( tree.get<double>( "cpu.fetch.decode.cache.miss_rate") == 0.5);
+}
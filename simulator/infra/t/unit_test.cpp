@@ -12,11 +12,13 @@
 #include <infra/exception.h>
 #include <infra/log.h>
 #include <infra/macro.h>
+#include <infra/spsc_queue.h>
 #include <infra/target.h>
 
 #include <cctype>
 #include <memory>
 #include <sstream>
+#include <thread>
 
 static_assert(CHAR_BIT == 8, "MIPT-MIPS supports only 8-bit byte host machines");
 static_assert(std::endian::native == std::endian::little || std::endian::native == std::endian::big, "MIPT-MIPS does not support mixed-endian hosts");
@@ -193,3 +195,46 @@ TEST_CASE("Valid target print")
     oss << std::hex << Target( 0x400, 15);
     CHECK( oss.str() == "400" );
 }
+
+TEST_CASE("SPSC queue: order and capacity")
+{
+    SPSCQueue<int> queue( 3);
+    CHECK( queue.capacity() == 4);
+    CHECK( queue.empty());
+    for ( int i = 0; i < 4; ++i)
+        CHECK( queue.try_push( int{ i}));
+    CHECK_FALSE( queue.try_push( 4));
+
+    for ( int i = 0; i < 4; ++i)
+        CHECK( queue.try_pop() == i);
+    CHECK_FALSE( queue.try_pop().has_value());
+    CHECK( queue.empty());
+}
+
+TEST_CASE("SPSC queue: two threads")
+{
+    static const constexpr uint64 COUNT = 100000;
+    SPSCQueue<uint64> queue( 16);
+    uint64 sum = 0;
+    bool ordered = true;
+    {
+        std::jthread consumer( [&]() {
+            uint64 expected = 0;
+            while ( expected < COUNT) {
+                auto value = queue.try_pop();
+                if ( !value.has_value()) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                ordered = ordered && *value == expected;
+                sum += *value;
+                ++expected;
+            }
+        });
+        for ( uint64 i = 0; i < COUNT; ++i)
+            while ( !queue.try_push( uint64{ i}))
+                std::this_thread::yield();
+    }
+    CHECK( ordered);
+    CHECK( sum == COUNT * ( COUNT - 1) / 2);
+}
@@ -20,6 +20,7 @@ void BaseKernel::load_file( const std::string& name)
     ElfLoader loader( name);
     loader.load_to( mem.get());
     start_pc = loader.get_startPC();
+    symbols = loader.get_symbols();
 }
 
 class DummyKernel : public BaseKernel
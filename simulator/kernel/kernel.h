@@ -9,6 +9,7 @@
 
 #include <func_sim/traps/trap.h>
 #include <infra/exception.h>
+#include <memory/elf/symbol_table.h>
 #include <memory/memory.h>
 #include <simulator.h>
 
@@ -52,11 +53,13 @@ public:
 
     int get_exit_code() const { return exit_code; }
     Addr get_start_pc() const { return start_pc; }
+    const SymbolTable& get_symbols() const { return symbols; }
 
 protected:
     std::ostream& cerr;
     int exit_code = 0;
     Addr start_pc = 0;
+    SymbolTable symbols;
 };
 
 #endif //KERNEL_H
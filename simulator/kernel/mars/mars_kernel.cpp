@@ -10,6 +10,8 @@
 #include <kernel/base_kernel.h>
 #include <memory/elf/elf_loader.h>
 
+#include <algorithm>
+#include <array>
 #include <fstream>
 #include <string>
 #include <unordered_map>
@@ -120,7 +122,16 @@ void MARSKernel::read_character() {
 }
 
 void MARSKernel::print_string() {
-    outstream << mem->read_string( sim->read_cpu_register( a0));
+    // copy by chunks to keep the syscall off the heap
+    std::array<char, 256> buffer{};
+    Addr addr = sim->read_cpu_register( a0);
+    for ( auto size = mem->strlen( addr); size > 0; ) {
+        const auto chunk = std::min( size, buffer.size());
+        mem->memcpy_guest_to_host( byte_cast( buffer.data()), addr, chunk);
+        outstream.write( buffer.data(), narrow_cast<std::streamsize>( chunk));
+        addr += chunk;
+        size -= chunk;
+    }
 }
 
 void MARSKernel::read_string() {
@@ -10,6 +10,7 @@
 #include <memory/memory.h>
 
 #include <string>
+#include <vector>
 
 static void load_elf_section( WriteableMemory* memory, const ELFIO::section& section, AddrDiff offset)
 {
@@ -75,4 +76,42 @@ Addr ElfLoader::get_startPC() const
     throw InvalidEntryPoint();
 }
 
+// Code is named by functions and labels, sections and files are skipped;
+// assemblers may mark labels as objects
+SymbolTable ElfLoader::get_symbols() const
+{
+    std::vector<ElfSymbol> result;
+    for ( const auto& section : reader->sections) {
+        if ( section->get_type() != SHT_SYMTAB)
+            continue;
+
+        ELFIO::symbol_section_accessor symbols(*reader, section);
+        for ( ELFIO::Elf_Xword j = 0; j < symbols.get_symbols_num(); ++j) {
+            ElfSymbol symbol;
+            ELFIO::Elf64_Addr value = 0;
+            ELFIO::Elf_Xword size = 0;
+            unsigned char bind = 0;
+            unsigned char type = 0;
+            ELFIO::Elf_Half section_index = 0;
+            unsigned char other = 0;
+            symbols.get_symbol( j, symbol.name, value, size, bind, type, section_index, other);
+            if ( ( type != STT_FUNC && type != STT_NOTYPE && type != STT_OBJECT) || section_index == SHN_UNDEF || section_index >= SHN_LORESERVE || symbol.name.empty() || value == 0)
+                continue;
+
+            // labels do not go beyond their sections, labels like _gp may point outside
+            const auto* symbol_section = reader->sections[ section_index];
+            const auto section_end = symbol_section->get_address() + symbol_section->get_size();
+            if ( size == 0 && value >= section_end)
+                continue;
+            if ( size == 0)
+                size = section_end - value;
+
+            symbol.address = value;
+            symbol.size = size;
+            result.push_back( std::move( symbol));
+        }
+    }
+    return SymbolTable( std::move( result));
+}
+
 ElfLoader::~ElfLoader() = default;
@@ -7,6 +7,8 @@
 #ifndef ELF_LOADER_H
 #define ELF_LOADER_H
 
+#include "symbol_table.h"
+
 #include <infra/exception.h>
 #include <infra/types.h>
 
@@ -55,6 +57,7 @@ public:
     void load_to( WriteableMemory *memory) const { load_to( memory, 0); }
     Addr get_startPC() const;
     Addr get_text_section_addr() const;
+    SymbolTable get_symbols() const;
 private:
     const std::unique_ptr<ELFIO::elfio> reader;
 };
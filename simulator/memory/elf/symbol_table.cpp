@@ -0,0 +1,47 @@
+/**
+ * symbol_table.cpp: symbols of ELF files to name guest addresses
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "symbol_table.h"
+
+#include <algorithm>
+#include <sstream>
+
+SymbolTable::SymbolTable( std::vector<ElfSymbol> values)
+    : symbols( std::move( values))
+{
+    std::stable_sort( symbols.begin(), symbols.end(),
+                      []( const auto& lhs, const auto& rhs) { return lhs.address < rhs.address; });
+}
+
+const ElfSymbol* SymbolTable::find( Addr address) const
+{
+    auto it = std::upper_bound( symbols.begin(), symbols.end(), address,
+                                []( Addr value, const auto& symbol) { return value < symbol.address; });
+    if ( it == symbols.begin())
+        return nullptr;
+
+    // the first one of symbols with the same address is chosen
+    const auto& symbol = *std::lower_bound( symbols.begin(), it, std::prev( it)->address,
+                                            []( const auto& lhs, Addr value) { return lhs.address < value; });
+    if ( symbol.size != 0 && address - symbol.address >= symbol.size)
+        return nullptr;
+
+    return &symbol;
+}
+
+std::string SymbolTable::symbolize( Addr address) const
+{
+    std::ostringstream oss;
+    const auto* symbol = find( address);
+    if ( symbol == nullptr) {
+        oss << "0x" << std::hex << address;
+        return oss.str();
+    }
+
+    oss << symbol->name;
+    if ( address != symbol->address)
+        oss << "+0x" << std::hex << address - symbol->address;
+    return oss.str();
+}
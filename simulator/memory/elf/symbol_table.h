@@ -0,0 +1,40 @@
+/**
+ * symbol_table.h: symbols of ELF files to name guest addresses
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <infra/types.h>
+
+#include <string>
+#include <vector>
+
+struct ElfSymbol
+{
+    Addr address = 0;
+    Addr size = 0;
+    std::string name;
+};
+
+class SymbolTable
+{
+public:
+    SymbolTable() = default;
+    explicit SymbolTable( std::vector<ElfSymbol> symbols);
+
+    // Returns the symbol covering the address, nullptr if there is no one.
+    // Labels without size cover addresses up to the next symbol.
+    const ElfSymbol* find( Addr address) const;
+
+    // Returns 'name+0xoffset' or the hexadecimal address
+    std::string symbolize( Addr address) const;
+
+    bool empty() const noexcept { return symbols.empty(); }
+
+private:
+    std::vector<ElfSymbol> symbols;
+};
+
+#endif
@@ -0,0 +1,38 @@
+/**
+ * locked_memory.cpp - guest memory shared by several host threads.
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "locked_memory.h"
+
+#include <mutex>
+
+size_t LockedMemory::memcpy_guest_to_host( std::byte* dst, Addr src, size_t size) const noexcept
+{
+    std::shared_lock lock( mutex);
+    return shared->memcpy_guest_to_host( dst, src, size);
+}
+
+size_t LockedMemory::memcpy_host_to_guest( Addr dst, const std::byte* src, size_t size)
+{
+    std::unique_lock lock( mutex);
+    return shared->memcpy_host_to_guest( dst, src, size);
+}
+
+void LockedMemory::duplicate_to( std::shared_ptr<WriteableMemory> target) const
+{
+    std::shared_lock lock( mutex);
+    shared->duplicate_to( std::move( target));
+}
+
+std::string LockedMemory::dump() const
+{
+    std::shared_lock lock( mutex);
+    return shared->dump();
+}
+
+size_t LockedMemory::strlen( Addr addr) const
+{
+    std::shared_lock lock( mutex);
+    return shared->strlen( addr);
+}
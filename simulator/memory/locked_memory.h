@@ -0,0 +1,33 @@
+/**
+ * locked_memory.h - guest memory shared by several host threads.
+ * Each access is atomic, but the order of accesses from different
+ * threads is not specified.
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef LOCKED_MEMORY_H
+#define LOCKED_MEMORY_H
+
+#include <memory/memory.h>
+
+#include <shared_mutex>
+
+class LockedMemory : public FuncMemory
+{
+public:
+    explicit LockedMemory( std::shared_ptr<FuncMemory> memory) : shared( std::move( memory)) { }
+
+    size_t memcpy_guest_to_host( std::byte* dst, Addr src, size_t size) const noexcept final;
+    size_t memcpy_host_to_guest( Addr dst, const std::byte* src, size_t size) final;
+    void duplicate_to( std::shared_ptr<WriteableMemory> target) const final;
+    std::string dump() const final;
+    size_t strlen( Addr addr) const final;
+
+private:
+    std::shared_ptr<FuncMemory> shared;
+
+    // Writes may allocate pages of the underlying memory, so reads must be excluded
+    mutable std::shared_mutex mutex;
+};
+
+#endif // LOCKED_MEMORY_H
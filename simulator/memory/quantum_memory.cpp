@@ -0,0 +1,60 @@
+/**
+ * quantum_memory.cpp - private view of a shared guest memory.
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "quantum_memory.h"
+
+size_t QuantumMemory::memcpy_guest_to_host( std::byte* dst, Addr src, size_t size) const noexcept
+{
+    auto result = shared->memcpy_guest_to_host( dst, src, size);
+    if ( overlay.empty())
+        return result;
+
+    for ( size_t i = 0; i < size; ++i) {
+        auto it = overlay.find( src + i);
+        if ( it != overlay.end())
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic) Low level access
+            dst[i] = it->second;
+    }
+    return result;
+}
+
+size_t QuantumMemory::memcpy_host_to_guest( Addr dst, const std::byte* src, size_t size)
+{
+    stores.push_back( Store{ dst, data.size(), size});
+    for ( size_t i = 0; i < size; ++i) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic) Low level access
+        data.push_back( src[i]);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic) Low level access
+        overlay[ dst + i] = src[i];
+    }
+    return size;
+}
+
+void QuantumMemory::duplicate_to( std::shared_ptr<WriteableMemory> target) const
+{
+    shared->duplicate_to( target);
+    for ( const auto& e : stores)
+        target->memcpy_host_to_guest( e.addr, &data[ e.offset], e.size);
+}
+
+size_t QuantumMemory::strlen( Addr addr) const
+{
+    size_t result = 0;
+    while ( read<uint8, std::endian::little>( addr + result) != 0)
+        ++result;
+
+    return result;
+}
+
+void QuantumMemory::commit()
+{
+    for ( const auto& e : stores)
+        shared->memcpy_host_to_guest( e.addr, &data[ e.offset], e.size);
+
+    committed_stores += stores.size();
+    stores.clear();
+    data.clear();
+    overlay.clear();
+}
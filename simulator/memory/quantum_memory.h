@@ -0,0 +1,49 @@
+/**
+ * quantum_memory.h - private view of a shared guest memory.
+ * Stores are buffered until the end of the synchronization quantum
+ * and then committed to the shared memory in program order.
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef QUANTUM_MEMORY_H
+#define QUANTUM_MEMORY_H
+
+#include <memory/memory.h>
+
+#include <unordered_map>
+#include <vector>
+
+class QuantumMemory : public FuncMemory
+{
+public:
+    explicit QuantumMemory( std::shared_ptr<FuncMemory> memory) : shared( std::move( memory)) { }
+
+    size_t memcpy_guest_to_host( std::byte* dst, Addr src, size_t size) const noexcept final;
+    size_t memcpy_host_to_guest( Addr dst, const std::byte* src, size_t size) final;
+    void duplicate_to( std::shared_ptr<WriteableMemory> target) const final;
+    std::string dump() const final { return shared->dump(); }
+    size_t strlen( Addr addr) const final;
+
+    // Applies buffered stores to the shared memory in the order they were issued
+    void commit();
+    bool has_pending_stores() const noexcept { return !stores.empty(); }
+    auto get_committed_stores() const noexcept { return committed_stores; }
+
+private:
+    struct Store
+    {
+        Addr addr;
+        size_t offset; // in 'data'
+        size_t size;
+    };
+
+    std::shared_ptr<FuncMemory> shared;
+    std::vector<Store> stores;
+    std::vector<std::byte> data;
+
+    // Latest value of each byte written in the current quantum
+    std::unordered_map<Addr, std::byte> overlay;
+    uint64 committed_stores = 0;
+};
+
+#endif // QUANTUM_MEMORY_H
@@ -11,6 +11,7 @@
 #include <func_sim/operation.h>
 #include <memory/elf/elf_loader.h>
 #include <memory/memory.h>
+#include <memory/quantum_memory.h>
 #include <memory/t/check_coherency.h>
 
 static const std::string_view valid_elf_file = TEST_PATH "/elf/mips_bin_exmpl.out";
@@ -51,6 +52,16 @@ TEST_CASE( "Func_memory: StartPC_Method_Test")
     CHECK( ElfLoader( valid_elf_file).get_startPC() == 0x4000b0U /*address of the "__start" label*/);
 }
 
+TEST_CASE( "Func_memory: Symbols")
+{
+    const auto symbols = ElfLoader( TEST_PATH "/elf/qsort.riscv").get_symbols();
+    CHECK( symbols.symbolize( 0x800018d6) == "main");
+    CHECK( symbols.symbolize( 0x800018da) == "main+0x4");
+    CHECK( symbols.symbolize( 0x800018d6 + 94).find( "main") == std::string::npos);
+    CHECK( ElfLoader( valid_elf_file).get_symbols().symbolize( 0x4000b0) == "__start");
+    CHECK( SymbolTable().symbolize( 0x4000b0) == "0x4000b0");
+}
+
 TEST_CASE( "Func_memory: StartPC Invalid")
 {
     CHECK_THROWS_AS( ElfLoader( TEST_PATH "/elf/nop.bin").get_startPC(), InvalidEntryPoint);
@@ -407,3 +418,36 @@ TEST_CASE( "Func_memory Replicant: read and write")
     CHECK( mem3->read_string( 0x20) == "Hello World");
     CHECK( mem12.dump() == mem1->dump());
 }
+
+TEST_CASE( "Quantum_memory: stores are invisible until commit")
+{
+    auto shared = FuncMemory::create_4M_plain_memory();
+    auto view = std::make_shared<QuantumMemory>( shared);
+
+    view->write<uint32, std::endian::little>( 0xdeadbeef, 0x100);
+    CHECK( view->has_pending_stores());
+    CHECK( view->read<uint32, std::endian::little>( 0x100) == 0xdeadbeef);
+    CHECK( shared->read<uint32, std::endian::little>( 0x100) == 0);
+
+    view->commit();
+    CHECK_FALSE( view->has_pending_stores());
+    CHECK( view->get_committed_stores() == 1);
+    CHECK( shared->read<uint32, std::endian::little>( 0x100) == 0xdeadbeef);
+}
+
+TEST_CASE( "Quantum_memory: commit order")
+{
+    auto shared = FuncMemory::create_4M_plain_memory();
+    auto view0 = std::make_shared<QuantumMemory>( shared);
+    auto view1 = std::make_shared<QuantumMemory>( shared);
+
+    view1->write<uint16, std::endian::little>( 0x1111, 0x100);
+    view0->write<uint32, std::endian::little>( 0x22222222, 0x100);
+    view0->write<uint8, std::endian::little>( 0x33, 0x101);
+    CHECK( view0->read<uint32, std::endian::little>( 0x100) == 0x22223322);
+    CHECK( view1->read<uint32, std::endian::little>( 0x100) == 0x1111);
+
+    view0->commit();
+    view1->commit();
+    CHECK( shared->read<uint32, std::endian::little>( 0x100) == 0x22221111);
+}
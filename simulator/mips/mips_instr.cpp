@@ -705,14 +705,14 @@ static const MIPSTableEntry<I> instr_nop =
 { "nop" , do_nothing<I>, OUT_ARITHM, 0, 'N', Imm::NO, { }, { Dst::ZERO }, MIPS_I_Instr};
 
 template<typename I>
-static MIPSTableEntry<I> get_table_entry( const Table<I>& table, uint32 key)
+static const MIPSTableEntry<I>& get_table_entry( const Table<I>& table, uint32 key)
 {
     auto it = table.find( key);
     return it == table.end() ? unknown_instruction<I> : it->second;
 }
 
 template<typename I>
-static MIPSTableEntry<I> get_opcode_special_entry( const MIPSInstrDecoder& instr)
+static const MIPSTableEntry<I>& get_opcode_special_entry( const MIPSInstrDecoder& instr)
 {
     if ( instr.funct == 0x1)
         return get_table_entry( isaMapMOVCI<I>, instr.ft);
@@ -720,7 +720,7 @@ static MIPSTableEntry<I> get_opcode_special_entry( const MIPSInstrDecoder& instr
 }
 
 template<typename I>
-static MIPSTableEntry<I> get_COP1_s_entry( const MIPSInstrDecoder& instr)
+static const MIPSTableEntry<I>& get_COP1_s_entry( const MIPSInstrDecoder& instr)
 {
     if ( instr.funct == 0x11)
         return get_table_entry( isaMapMOVCF_s<I>, instr.ft);
@@ -728,7 +728,7 @@ static MIPSTableEntry<I> get_COP1_s_entry( const MIPSInstrDecoder& instr)
 }
 
 template<typename I>
-static MIPSTableEntry<I> get_COP1_d_entry( const MIPSInstrDecoder& instr)
+static const MIPSTableEntry<I>& get_COP1_d_entry( const MIPSInstrDecoder& instr)
 {
     if ( instr.funct == 0x11)
         return get_table_entry( isaMapMOVCF_d<I>, instr.ft);
@@ -736,7 +736,7 @@ static MIPSTableEntry<I> get_COP1_d_entry( const MIPSInstrDecoder& instr)
 }
 
 template<typename I>
-static MIPSTableEntry<I> get_cp0_entry( const MIPSInstrDecoder& instr)
+static const MIPSTableEntry<I>& get_cp0_entry( const MIPSInstrDecoder& instr)
 {
     switch ( instr.funct)
     {
@@ -746,7 +746,7 @@ static MIPSTableEntry<I> get_cp0_entry( const MIPSInstrDecoder& instr)
 }
 
 template<typename I>
-static MIPSTableEntry<I> get_cp1_entry( const MIPSInstrDecoder& instr)
+static const MIPSTableEntry<I>& get_cp1_entry( const MIPSInstrDecoder& instr)
 {
     switch ( instr.fmt)
     {
@@ -760,7 +760,7 @@ static MIPSTableEntry<I> get_cp1_entry( const MIPSInstrDecoder& instr)
 }
 
 template<typename I>
-static MIPSTableEntry<I> get_table_entry( uint32 bytes)
+static const MIPSTableEntry<I>& get_table_entry( uint32 bytes)
 {
     MIPSInstrDecoder instr( bytes);
 
@@ -788,7 +788,7 @@ static auto find_entry( const M& map, std::string_view name)
 }
 
 template<typename I>
-static MIPSTableEntry<I> get_table_entry( std::string_view str_opcode)
+static const MIPSTableEntry<I>& get_table_entry( std::string_view str_opcode)
 {
     if ( str_opcode == "nop")
         return instr_nop<I>;
@@ -823,7 +823,7 @@ BaseMIPSInstr<R>::BaseMIPSInstr( MIPSVersion version, std::endian endian, uint32
     , raw_valid( true)
     , endian( endian)
 {
-    auto entry = get_table_entry<MyDatapath>( raw);
+    const auto& entry = get_table_entry<MyDatapath>( raw);
     MIPSInstrDecoder instr( raw);
     init( entry, version);
 
@@ -842,7 +842,7 @@ BaseMIPSInstr<R>::BaseMIPSInstr( MIPSVersion version, std::string_view str_opcod
     , raw( 0)
     , endian( endian)
 {
-    auto entry = get_table_entry<MyDatapath>( str_opcode);
+    const auto& entry = get_table_entry<MyDatapath>( str_opcode);
     init( entry, version);
     this->v_imm = MIPSInstrDecoder::get_immediate<R>( entry.imm_type, immediate);
     init_target();
@@ -6,6 +6,22 @@
 
 #include "branch.h"
 
+#include <string_view>
+
+static std::string_view get_branch_type_name( size_t type)
+{
+    static const std::array<std::string_view, BRANCH_TYPES_NUM> names = {
+        "not_jumps",
+        "conditional_branches",
+        "direct_jumps",
+        "direct_calls",
+        "indirect_calls",
+        "returns",
+        "indirect_jumps"
+    };
+    return names.at( type);
+}
+
 template <typename FuncInstr>
 Branch<FuncInstr>::Branch( Module* parent) : Module( parent, "branch")
 {
@@ -22,6 +38,20 @@ Branch<FuncInstr>::Branch( Module* parent) : Module( parent, "branch")
     wp_bypass = make_write_port<InstructionOutput>("BRANCH_2_EXECUTE_BYPASS", Port::BW);
 
     wp_bypassing_unit_flush_notify = make_write_port<bool>("BRANCH_2_BYPASSING_UNIT_FLUSH_NOTIFY", Port::BW);
+
+    num_jumps = make_counter( "jumps", "jumps seen at branch stage");
+    num_mispredictions = make_counter( "mispredictions", "mispredictions detected at branch stage");
+    num_btb_hits = make_counter( "btb_hits", "jumps found in the branch target buffer");
+    make_formula( "mispredict_rate", "share of jumps mispredicted at branch stage", make_ratio( num_mispredictions, num_jumps));
+    make_formula( "btb_hit_rate", "share of jumps found in the branch target buffer", make_ratio( num_btb_hits, num_jumps));
+
+    // split by the class of the jump
+    for ( size_t type = 0; type < BRANCH_TYPES_NUM; ++type) {
+        const std::string name( get_branch_type_name( type));
+        num_jumps_by_type.at( type) = make_counter( name + ".jumps", "");
+        num_mispredictions_by_type.at( type) = make_counter( name + ".mispredictions", "");
+        make_formula( name + ".mispredict_rate", "", make_ratio( num_mispredictions_by_type.at( type), num_jumps_by_type.at( type)));
+    }
 }
 
 template <typename FuncInstr>
@@ -42,13 +72,20 @@ void Branch<FuncInstr>::clock( Cycle cycle)
     /* acquiring real information for BPU */
     wp_bp_update->write( instr.get_bp_upd(), cycle);
 
+    const auto type = static_cast<size_t>( instr.get_bp_data().type);
     if ( instr.is_jump())
-        num_jumps++;
+    {
+        ++*num_jumps;
+        ++*num_jumps_by_type.at( type);
+        if ( instr.get_bp_data().is_hit)
+            ++*num_btb_hits;
+    }
 
     /* handle misprediction */
     if ( is_misprediction( instr, instr.get_bp_data()))
     {
-        num_mispredictions++;
+        ++*num_mispredictions;
+        ++*num_mispredictions_by_type.at( type);
 
         /* flushing the pipeline */
         wp_flush_all->write( true, cycle);
@@ -58,6 +95,7 @@ void Branch<FuncInstr>::clock( Cycle cycle)
 
         /* sending valid PC to fetch stage */
         wp_flush_target->write( instr.get_actual_target(), cycle);
+        cpi_stack->flush( instr.get_PC(), instr.get_sequence_id(), CpiComponent::BRANCH_FLUSH);
         sout << "misprediction on ";
     }
 
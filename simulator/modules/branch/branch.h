@@ -8,6 +8,7 @@
 #define BRANCH_H
 
 #include <func_sim/operation.h>
+#include <modules/core/cpi_stack.h>
 #include <modules/core/perf_instr.h>
 #include <modules/ports_instance.h>
 
@@ -21,8 +22,14 @@ class Branch : public Module
     using InstructionOutput = std::array< RegisterUInt, MAX_DST_NUM>;
 
     private:
-        uint64 num_mispredictions = 0;
-        uint64 num_jumps          = 0;
+        Counter* num_mispredictions = nullptr;
+        Counter* num_jumps          = nullptr;
+        Counter* num_btb_hits       = nullptr;
+        CpiStack* cpi_stack = nullptr;
+
+        // indexed by the class of the jump
+        std::array<Counter*, BRANCH_TYPES_NUM> num_mispredictions_by_type = {};
+        std::array<Counter*, BRANCH_TYPES_NUM> num_jumps_by_type          = {};
 
         ReadPort<Instr>* rp_datapath = nullptr;
         WritePort<Instr>* wp_datapath = nullptr;
@@ -43,8 +50,12 @@ class Branch : public Module
     public:
         explicit Branch( Module* parent);
         void clock( Cycle cycle);
-        auto get_mispredictions_num() const { return num_mispredictions; }
-        auto get_jumps_num() const { return num_jumps; }
+        void set_cpi_stack( CpiStack* value) { cpi_stack = value; }
+        auto get_mispredictions_num() const { return num_mispredictions->get(); }
+        auto get_jumps_num() const { return num_jumps->get(); }
+        auto get_btb_hits_num() const { return num_btb_hits->get(); }
+        auto get_mispredictions_num( BranchType type) const { return num_mispredictions_by_type.at( static_cast<size_t>( type))->get(); }
+        auto get_jumps_num( BranchType type) const { return num_jumps_by_type.at( static_cast<size_t>( type))->get(); }
 
         bool is_misprediction( const Instr& instr, const BPInterface& bp_data) const
         {
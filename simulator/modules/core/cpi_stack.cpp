@@ -0,0 +1,128 @@
+/*
+ * cpi_stack.cpp - attribution of pipeline cycles to their causes
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "cpi_stack.h"
+
+#include <memory/elf/symbol_table.h>
+
+#include <algorithm>
+#include <numeric>
+#include <ostream>
+#include <vector>
+
+std::string_view get_cpi_component_name( CpiComponent component)
+{
+    static const std::array<std::string_view, CPI_COMPONENTS_NUM> names = {
+        "base",
+        "data hazard",
+        "long-latency unit busy",
+        "writeback bandwidth",
+        "branch flush",
+        "icache miss",
+        "dcache miss",
+        "other"
+    };
+    return names.at( static_cast<size_t>( component));
+}
+
+std::string get_cpi_component_key( CpiComponent component)
+{
+    std::string key( get_cpi_component_name( component));
+    std::replace_if( key.begin(), key.end(), []( char c) { return c == ' ' || c == '-'; }, '_');
+    return key;
+}
+
+void CpiStack::add( Addr pc, CpiComponent component)
+{
+    const auto index = static_cast<size_t>( component);
+    ++total.at( index);
+    if ( hot_pcs_num != 0 && pc != NO_PC)
+        ++pcs[ pc].at( index);
+}
+
+void CpiStack::remove( Addr pc, CpiComponent component)
+{
+    const auto index = static_cast<size_t>( component);
+    --total.at( index);
+    if ( hot_pcs_num != 0 && pc != NO_PC)
+        --pcs[ pc].at( index);
+}
+
+void CpiStack::add_instr_cycle( Addr pc, uint64 sequence_id, CpiComponent component)
+{
+    add( pc, component);
+    recent.at( recent_end) = Charge{ pc, sequence_id, component};
+    recent_end = ( recent_end + 1) % recent.size();
+    recent_size = std::min( recent_size + 1, recent.size());
+}
+
+void CpiStack::flush( Addr pc, uint64 sequence_id, CpiComponent component)
+{
+    while ( recent_size != 0) {
+        const auto last = ( recent_end + recent.size() - 1) % recent.size();
+        const auto& charge = recent.at( last);
+        if ( charge.sequence_id <= sequence_id)
+            break;
+
+        remove( charge.pc, charge.component);
+        add( pc, component);
+        recent_end = last;
+        --recent_size;
+    }
+    set_frontend_stall( pc, component);
+}
+
+uint64 CpiStack::get_cycles( Addr pc, CpiComponent component) const
+{
+    const auto it = pcs.find( pc);
+    return it == pcs.end() ? 0 : it->second.at( static_cast<size_t>( component));
+}
+
+void CpiStack::dump( std::ostream& out, uint64 instrs, const SymbolTable& symbols) const
+{
+    const auto cycles = std::accumulate( total.begin(), total.end(), uint64{ 0});
+    if ( cycles == 0 || instrs == 0)
+        return;
+
+    out << std::endl << "CPI stack:  " << 1.0 * cycles / instrs;
+    for ( size_t i = 0; i < CPI_COMPONENTS_NUM; ++i)
+        if ( total.at( i) != 0)
+            out << std::endl << "            " << get_cpi_component_name( static_cast<CpiComponent>( i)) << " - "
+                << 1.0 * total.at( i) / instrs << " (" << 100.0 * total.at( i) / cycles << "%)";
+
+    if ( hot_pcs_num != 0)
+        dump_hot_pcs( out, symbols);
+}
+
+void CpiStack::dump_hot_pcs( std::ostream& out, const SymbolTable& symbols) const
+{
+    std::vector<std::pair<uint64, Addr>> hottest;
+    hottest.reserve( pcs.size());
+    for ( const auto& [pc, cycles] : pcs)
+        hottest.emplace_back( std::accumulate( cycles.begin(), cycles.end(), uint64{ 0}), pc);
+
+    const auto num = std::min( hot_pcs_num, hottest.size());
+    std::partial_sort( hottest.begin(), hottest.begin() + num, hottest.end(),
+                       []( const auto& lhs, const auto& rhs) {
+                           return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+                       });
+
+    out << std::endl << "hot PCs:";
+    for ( size_t i = 0; i < num; ++i) {
+        const auto [sum, pc] = hottest[ i];
+        const auto& cycles = pcs.at( pc);
+        out << std::endl << "            0x" << std::hex << pc << std::dec;
+        if ( symbols.find( pc) != nullptr)
+            out << " (" << symbols.symbolize( pc) << ")";
+        out << " - " << sum << " cycles";
+        char separator = ':';
+        for ( size_t j = 0; j < CPI_COMPONENTS_NUM; ++j) {
+            if ( cycles.at( j) == 0)
+                continue;
+            out << separator << " " << get_cpi_component_name( static_cast<CpiComponent>( j)) << " " << cycles.at( j);
+            separator = ',';
+        }
+    }
+}
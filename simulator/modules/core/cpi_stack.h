@@ -0,0 +1,103 @@
+/*
+ * cpi_stack.h - attribution of pipeline cycles to their causes
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef CPI_STACK_H
+#define CPI_STACK_H
+
+#include <infra/macro.h>
+#include <infra/types.h>
+
+#include <array>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class SymbolTable;
+
+enum class CpiComponent : uint8
+{
+    BASE,
+    DATA_HAZARD,
+    LONG_LATENCY_UNIT,
+    WRITEBACK_BANDWIDTH,
+    BRANCH_FLUSH,
+    ICACHE_MISS,
+    DCACHE_MISS,
+    OTHER
+};
+
+static constexpr const size_t CPI_COMPONENTS_NUM = 8;
+
+std::string_view get_cpi_component_name( CpiComponent component);
+
+// the name as an identifier of machine-readable outputs, like 'data_hazard'
+std::string get_cpi_component_key( CpiComponent component);
+
+/*
+ * Each cycle of the pipeline is charged to a component and a static PC.
+ * Decode charges a cycle to the instruction it holds, or to the stall of the front-end
+ * if it has no instruction. The front-end stall is set by the stage which causes it:
+ * fetch on instruction cache misses, branch and decode on mispredictions,
+ * writeback on traps. Cycles of instructions on a wrong path are charged to the flush.
+ */
+class CpiStack
+{
+public:
+    static constexpr const Addr NO_PC = all_ones<Addr>();
+
+    // PCs are traced only if the table of the hottest PCs is requested
+    explicit CpiStack( size_t hot_pcs_num = 0) : hot_pcs_num( hot_pcs_num) { }
+
+    void add_instr_cycle( Addr pc, uint64 sequence_id, CpiComponent component);
+    void add_frontend_cycle() { add( frontend_pc, frontend_component); }
+    void add_dcache_miss_cycle() { add( dcache_miss_pc, CpiComponent::DCACHE_MISS); }
+
+    void set_frontend_stall( Addr pc, CpiComponent component) noexcept
+    {
+        frontend_pc = pc;
+        frontend_component = component;
+    }
+
+    void set_dcache_miss( Addr pc) noexcept { dcache_miss_pc = pc; }
+
+    // cycles of instructions younger than the flushing one are charged to the flush
+    void flush( Addr pc, uint64 sequence_id, CpiComponent component);
+
+    uint64 get_cycles( CpiComponent component) const { return total.at( static_cast<size_t>( component)); }
+    uint64 get_cycles( Addr pc, CpiComponent component) const;
+
+    void dump( std::ostream& out, uint64 instrs, const SymbolTable& symbols) const;
+
+private:
+    using Cycles = std::array<uint64, CPI_COMPONENTS_NUM>;
+
+    struct Charge
+    {
+        Addr pc = NO_PC;
+        uint64 sequence_id = 0;
+        CpiComponent component = CpiComponent::OTHER;
+    };
+
+    void add( Addr pc, CpiComponent component);
+    void remove( Addr pc, CpiComponent component);
+    void dump_hot_pcs( std::ostream& out, const SymbolTable& symbols) const;
+
+    const size_t hot_pcs_num;
+    Cycles total = {};
+    std::unordered_map<Addr, Cycles> pcs;
+
+    // recent cycles charged to instructions, they may be on a wrong path; it is a ring buffer
+    static constexpr const size_t RECENT_CHARGES_NUM = 256;
+    std::array<Charge, RECENT_CHARGES_NUM> recent = {};
+    size_t recent_end = 0;
+    size_t recent_size = 0;
+
+    Addr frontend_pc = NO_PC;
+    CpiComponent frontend_component = CpiComponent::OTHER;
+    Addr dcache_miss_pc = NO_PC;
+};
+
+#endif // CPI_STACK_H
@@ -0,0 +1,169 @@
+/*
+ * interval_statistics.cpp - time series of performance statistics
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "interval_statistics.h"
+
+#include <infra/config/config.h>
+
+#include <iostream>
+#include <optional>
+
+namespace config {
+    static const Value<uint64> stats_cycles = { "stats-cycles", 0, "period of interval statistics in cycles"};
+    static const Value<uint64> stats_instrs = { "stats-instrs", 0, "period of interval statistics in retired instructions"};
+    static const Value<std::string> stats_file = { "stats-file", "", "file of interval statistics, standard output by default"};
+    static const Value<std::string> stats_format = { "stats-format", "csv", "format of interval statistics: csv or json"};
+} // namespace config
+
+static bool is_json_format( const std::string& format)
+{
+    if ( format != "csv" && format != "json")
+        throw InvalidStatisticsFormat( format);
+
+    return format == "json";
+}
+
+static uint64 get_next( uint64 now, uint64 period)
+{
+    return period != 0 ? now + period : MAX_VAL64;
+}
+
+IntervalStatistics::IntervalStatistics( std::ostream* out, const std::string& format, uint64 cycles_period, uint64 instrs_period)
+    : out( out)
+    , is_json( is_json_format( format))
+    , cycles_period( cycles_period)
+    , instrs_period( instrs_period)
+    , next_cycles( get_next( 0, cycles_period))
+    , next_instrs( get_next( 0, instrs_period))
+{ }
+
+IntervalStatistics::IntervalStatistics( const std::string& filename, const std::string& format, uint64 cycles_period, uint64 instrs_period)
+    : IntervalStatistics( &std::cout, format, cycles_period, instrs_period)
+{
+    if ( filename.empty())
+        return;
+
+    file.open( filename);
+    if ( !file.is_open())
+        throw InvalidStatisticsFile( filename);
+    out = &file;
+}
+
+std::unique_ptr<IntervalStatistics> IntervalStatistics::create_configured()
+{
+    if ( uint64{ config::stats_cycles} == 0 && uint64{ config::stats_instrs} == 0)
+        return nullptr;
+
+    return std::make_unique<IntervalStatistics>( config::stats_file, config::stats_format, config::stats_cycles, config::stats_instrs);
+}
+
+void IntervalStatistics::sample( const IntervalCounters& counters)
+{
+    const auto now = std::chrono::steady_clock::now();
+    write_record( counters, std::chrono::duration<double, std::milli>( now - previous_time).count());
+
+    previous = counters;
+    previous_time = now;
+    next_cycles = get_next( counters.cycles, cycles_period);
+    next_instrs = get_next( counters.instrs, instrs_period);
+}
+
+void IntervalStatistics::finish( const IntervalCounters& counters)
+{
+    if ( counters.cycles != previous.cycles)
+        sample( counters);
+    out->flush();
+}
+
+// rates of empty intervals are undefined
+static std::optional<double> get_rate( uint64 piece, uint64 total)
+{
+    if ( total == 0)
+        return std::nullopt;
+
+    return 1.0 * piece / total;
+}
+
+static std::optional<double> get_rate( int64 piece, uint64 total)
+{
+    if ( total == 0)
+        return std::nullopt;
+
+    return 1.0 * piece / narrow_cast<double>( total);
+}
+
+static void write_csv_value( std::ostream* out, const std::optional<double>& value)
+{
+    *out << ',';
+    if ( value.has_value())
+        *out << *value;
+}
+
+static void write_json_value( std::ostream* out, const std::optional<double>& value)
+{
+    if ( value.has_value())
+        *out << *value;
+    else
+        *out << "null";
+}
+
+void IntervalStatistics::write_header()
+{
+    *out << "cycles,instrs,ipc,mispredict_rate,decode_mispredict_rate,bp_hit_rate,icache_hit_rate,dcache_hit_rate";
+    for ( size_t i = 0; i < CPI_COMPONENTS_NUM; ++i)
+        *out << ",cpi_" << get_cpi_component_key( static_cast<CpiComponent>( i));
+    *out << ",host_kips,host_khz\n";
+}
+
+void IntervalStatistics::write_record( const IntervalCounters& counters, double host_ms)
+{
+    const auto cycles = counters.cycles - previous.cycles;
+    const auto instrs = counters.instrs - previous.instrs;
+    const auto jumps = counters.jumps - previous.jumps;
+    const auto icache_accesses = counters.icache_hits + counters.icache_misses - previous.icache_hits - previous.icache_misses;
+    const auto dcache_accesses = counters.dcache_hits + counters.dcache_misses - previous.dcache_hits - previous.dcache_misses;
+
+    std::array<std::optional<double>, CPI_COMPONENTS_NUM> cpi_stack;
+    for ( size_t i = 0; i < CPI_COMPONENTS_NUM; ++i)
+        cpi_stack.at( i) = get_rate( narrow_cast<int64>( counters.stall_cycles.at( i)) - narrow_cast<int64>( previous.stall_cycles.at( i)), instrs);
+
+    const std::array<std::pair<std::string, std::optional<double>>, 6> rates = {{
+        { "ipc",                    get_rate( instrs, cycles)},
+        { "mispredict_rate",        get_rate( counters.mispredictions - previous.mispredictions, jumps)},
+        { "decode_mispredict_rate", get_rate( counters.decode_mispredictions - previous.decode_mispredictions, counters.decode_jumps - previous.decode_jumps)},
+        { "bp_hit_rate",            get_rate( counters.btb_hits - previous.btb_hits, jumps)},
+        { "icache_hit_rate",        get_rate( counters.icache_hits - previous.icache_hits, icache_accesses)},
+        { "dcache_hit_rate",        get_rate( counters.dcache_hits - previous.dcache_hits, dcache_accesses)}
+    }};
+
+    const auto host_kips = host_ms > 0 ? instrs / host_ms : 0;
+    const auto host_khz = host_ms > 0 ? cycles / host_ms : 0;
+
+    if ( !is_json) {
+        if ( !has_header)
+            write_header();
+        has_header = true;
+
+        *out << counters.cycles << ',' << counters.instrs;
+        for ( const auto& rate : rates)
+            write_csv_value( out, rate.second);
+        for ( const auto& value : cpi_stack)
+            write_csv_value( out, value);
+        *out << ',' << host_kips << ',' << host_khz << '\n';
+        return;
+    }
+
+    *out << "{\"cycles\":" << counters.cycles << ",\"instrs\":" << counters.instrs;
+    for ( const auto& [name, rate] : rates) {
+        *out << ",\"" << name << "\":";
+        write_json_value( out, rate);
+    }
+    *out << ",\"cpi_stack\":{";
+    for ( size_t i = 0; i < CPI_COMPONENTS_NUM; ++i) {
+        *out << ( i == 0 ? "\"" : ",\"") << get_cpi_component_key( static_cast<CpiComponent>( i)) << "\":";
+        write_json_value( out, cpi_stack.at( i));
+    }
+    *out << "},\"host_kips\":" << host_kips << ",\"host_khz\":" << host_khz << "}\n";
+}
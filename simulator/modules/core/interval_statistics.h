@@ -0,0 +1,92 @@
+/*
+ * interval_statistics.h - time series of performance statistics
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef INTERVAL_STATISTICS_H
+#define INTERVAL_STATISTICS_H
+
+#include "cpi_stack.h"
+
+#include <infra/exception.h>
+#include <infra/statistics/statistics.h>
+#include <infra/types.h>
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+struct InvalidStatisticsFormat final : Exception
+{
+    explicit InvalidStatisticsFormat( const std::string& format)
+        : Exception( "Invalid format of interval statistics", format + ", csv or json is expected")
+    { }
+};
+
+// Cumulative values of the counters, rates of an interval are computed from their differences
+struct IntervalCounters
+{
+    uint64 cycles = 0;
+    uint64 instrs = 0;
+    uint64 jumps = 0;
+    uint64 mispredictions = 0;
+    uint64 decode_jumps = 0;
+    uint64 decode_mispredictions = 0;
+    uint64 btb_hits = 0;
+    uint64 icache_hits = 0;
+    uint64 icache_misses = 0;
+    uint64 dcache_hits = 0;
+    uint64 dcache_misses = 0;
+    std::array<uint64, CPI_COMPONENTS_NUM> stall_cycles = {};
+};
+
+/*
+ * A record is written each N cycles or each N retired instructions, whatever comes first.
+ * Records are lines of CSV with a header, or JSON objects, one per line.
+ *
+ * A component of the CPI stack may be negative in an interval: a flush moves
+ * cycles of the wrong path to the branch, including ones charged in the previous interval.
+ */
+class IntervalStatistics
+{
+public:
+    // zero period disables the sampling by cycles or by instructions
+    IntervalStatistics( std::ostream* out, const std::string& format, uint64 cycles_period, uint64 instrs_period);
+
+    // the standard output is used if the file name is empty
+    IntervalStatistics( const std::string& filename, const std::string& format, uint64 cycles_period, uint64 instrs_period);
+
+    // returns nothing if the sampling is disabled
+    static std::unique_ptr<IntervalStatistics> create_configured();
+
+    bool is_due( uint64 cycles, uint64 instrs) const noexcept
+    {
+        return cycles >= next_cycles || instrs >= next_instrs;
+    }
+
+    void sample( const IntervalCounters& counters);
+
+    // writes the last incomplete interval
+    void finish( const IntervalCounters& counters);
+
+private:
+    std::ofstream file;
+    std::ostream* out;
+    const bool is_json;
+    const uint64 cycles_period;
+    const uint64 instrs_period;
+    uint64 next_cycles;
+    uint64 next_instrs;
+    bool has_header = false;
+
+    IntervalCounters previous;
+    std::chrono::steady_clock::time_point previous_time = std::chrono::steady_clock::now();
+
+    void write_header();
+    void write_record( const IntervalCounters& counters, double host_ms);
+};
+
+#endif // INTERVAL_STATISTICS_H
@@ -0,0 +1,215 @@
+/*
+ * multi_core.cpp - several performance simulators over a shared memory
+ * clocked in parallel on host threads
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "multi_core.h"
+
+#include <kernel/kernel.h>
+#include <memory/quantum_memory.h>
+
+#include <algorithm>
+#include <barrier>
+#include <iostream>
+#include <thread>
+
+MultiCoreSimulator::MultiCoreSimulator( const std::string& isa, size_t num_cores, uint64 quantum)
+    : Root( "multicore")
+    , cores( num_cores)
+    , quantum( quantum)
+{
+    if ( num_cores == 0)
+        throw InvalidMultiCoreConfig( "number of cores should be greater than zero");
+
+    if ( quantum == 0)
+        throw InvalidMultiCoreConfig( "synchronization quantum should be greater than zero");
+
+    for ( auto& core : cores)
+        core.sim = CycleAccurateSimulator::create_simulator( isa);
+
+    register_statistics();
+}
+
+MultiCoreSimulator::~MultiCoreSimulator() = default;
+
+void MultiCoreSimulator::set_memory( const std::shared_ptr<FuncMemory>& memory)
+{
+    for ( auto& core : cores) {
+        core.memory = std::make_shared<QuantumMemory>( memory);
+        core.sim->set_memory( core.memory);
+    }
+}
+
+void MultiCoreSimulator::set_kernel( size_t core_id, const std::shared_ptr<Kernel>& kernel)
+{
+    auto& core = cores.at( core_id);
+    if ( core.memory == nullptr)
+        throw InvalidMultiCoreConfig( "memory should be set before kernels");
+
+    core.kernel = kernel;
+    kernel->set_simulator( core.sim);
+    kernel->connect_memory( core.memory);
+    kernel->connect_exception_handler();
+    core.sim->set_kernel( kernel);
+
+    // Checker has a private memory and cannot observe stores of other cores
+    core.sim->disable_checker();
+    core.sim->write_csr_register( "mhartid", core_id);
+}
+
+void MultiCoreSimulator::load_file( const std::string& name)
+{
+    const auto& kernel = cores.front().kernel;
+    if ( kernel == nullptr)
+        throw InvalidMultiCoreConfig( "kernel of core 0 should be set to load a file");
+
+    kernel->load_file( name);
+    set_pc( kernel->get_start_pc());
+}
+
+void MultiCoreSimulator::set_pc( Addr pc)
+{
+    for ( auto& core : cores)
+        core.sim->set_pc( pc);
+}
+
+void MultiCoreSimulator::clock_quantum( Core* core) const
+{
+    if ( core->halted)
+        return;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    try {
+        for ( uint64 i = 0; i < quantum && core->sim->get_trap() == Trap::NO_TRAP; ++i)
+            core->sim->clock();
+    }
+    catch (...) {
+        core->exception = std::current_exception();
+    }
+    core->halted = core->exception != nullptr || core->sim->get_trap() != Trap::NO_TRAP;
+    core->busy_time += std::chrono::high_resolution_clock::now() - start;
+}
+
+void MultiCoreSimulator::end_quantum() noexcept
+{
+    // Barrier completion is executed by a single thread,
+    // so the shared memory is updated deterministically
+    try {
+        for ( auto& core : cores)
+            core.memory->commit();
+    }
+    catch (...) {
+        commit_exception = std::current_exception();
+    }
+
+    cycles += quantum;
+    ++quantums;
+    finished = commit_exception != nullptr
+        || std::all_of( cores.begin(), cores.end(), []( const auto& core) { return core.halted; })
+        || std::any_of( cores.begin(), cores.end(), []( const auto& core) { return core.exception != nullptr; });
+}
+
+Trap MultiCoreSimulator::run( uint64 instrs_to_run)
+{
+    for ( auto& core : cores) {
+        core.sim->start_run( instrs_to_run);
+        core.memory->commit(); // Apply stores issued by loaders and kernels
+        core.halted = false;
+        core.exception = nullptr;
+    }
+
+    finished = false;
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        std::barrier sync( narrow_cast<std::ptrdiff_t>( cores.size()), [this]() noexcept { end_quantum(); });
+        std::vector<std::jthread> threads;
+        threads.reserve( cores.size());
+        for ( auto& core : cores)
+            threads.emplace_back( [this, &core, &sync]() {
+                while ( !finished) {
+                    clock_quantum( &core);
+                    sync.arrive_and_wait();
+                }
+            });
+    }
+    wall_time = std::chrono::high_resolution_clock::now() - start;
+
+    dump_statistics();
+
+    if ( commit_exception != nullptr)
+        std::rethrow_exception( commit_exception);
+
+    for ( const auto& core : cores)
+        if ( core.exception != nullptr)
+            std::rethrow_exception( core.exception);
+
+    return get_result_trap();
+}
+
+Trap MultiCoreSimulator::get_result_trap() const
+{
+    // Report the first unusual stop, otherwise all cores halted normally
+    for ( const auto& core : cores)
+        if ( core.sim->get_trap() != Trap::HALT)
+            return core.sim->get_trap();
+
+    return Trap( Trap::HALT);
+}
+
+int MultiCoreSimulator::get_exit_code() const noexcept
+{
+    for ( const auto& core : cores)
+        if ( core.sim->get_exit_code() != 0)
+            return core.sim->get_exit_code();
+
+    return 0;
+}
+
+uint64 MultiCoreSimulator::get_executed_instrs() const noexcept
+{
+    uint64 instrs = 0;
+    for ( const auto& core : cores)
+        instrs += core.sim->get_executed_instrs();
+    return instrs;
+}
+
+double MultiCoreSimulator::get_busy_time() const noexcept
+{
+    double time = 0;
+    for ( const auto& core : cores)
+        time += core.busy_time.count();
+    return time;
+}
+
+void MultiCoreSimulator::register_statistics()
+{
+    const auto get_instrs = [this]() { return 1.0 * get_executed_instrs(); };
+    const auto get_cycles = [this]() { return 1.0 * cycles; };
+    const auto get_time = [this]() { return wall_time.count(); };
+
+    make_formula( "cores", "", [this]() { return 1.0 * cores.size(); });
+    make_formula( "quantum", "cycles between synchronizations of cores", [this]() { return 1.0 * quantum; });
+    make_formula( "instrs", "instructions retired by all cores", get_instrs);
+    make_formula( "cycles", "simulated cycles", get_cycles);
+    make_formula( "ipc", "instructions retired by all cores per cycle", [=]() { return get_instrs() / get_cycles(); });
+    make_formula( "sim_ips", "retired instructions per host millisecond, kips", [=]() { return get_instrs() / get_time(); });
+    make_formula( "host_time", "host milliseconds", get_time);
+    make_formula( "host_threads", "", []() { return 1.0 * std::thread::hardware_concurrency(); });
+    make_formula( "speedup", "host time of all cores over the elapsed host time", [=, this]() { return get_busy_time() / get_time(); });
+
+    for ( size_t i = 0; i < cores.size(); ++i) {
+        make_formula( "busy_time.core" + std::to_string( i), "host milliseconds spent on clocking the core",
+                      [this, i]() { return cores[i].busy_time.count(); });
+        add_statistics_child( cores[i].sim.get(), "core" + std::to_string( i));
+    }
+}
+
+void MultiCoreSimulator::dump_statistics() const
+{
+    std::cout << std::endl << "****************************" << std::endl;
+    statistics_dumping( std::cout);
+    std::cout << "****************************" << std::endl;
+
+    statistics_dumping( config::stats_json);
+}
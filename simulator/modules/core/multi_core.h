@@ -0,0 +1,91 @@
+/*
+ * multi_core.h - several performance simulators over a shared memory
+ * clocked in parallel on host threads
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef MULTI_CORE_H
+#define MULTI_CORE_H
+
+#include <infra/exception.h>
+#include <infra/ports/module.h>
+#include <simulator.h>
+
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+class FuncMemory;
+class Kernel;
+class QuantumMemory;
+
+struct InvalidMultiCoreConfig final : Exception
+{
+    explicit InvalidMultiCoreConfig( const std::string& msg)
+        : Exception("Invalid multi-core configuration", msg)
+    { }
+};
+
+/*
+ * Each core owns its register file, kernel context and a private view of
+ * the shared memory. Cores are clocked independently for 'quantum' cycles,
+ * then synchronize on a barrier. At the barrier, stores buffered during the
+ * quantum are committed to the shared memory in the order of core ids,
+ * so the result of a simulation does not depend on host scheduling.
+ * Statistics of cores are nested in the 'multicore' statistics.
+ */
+class MultiCoreSimulator : public Root
+{
+public:
+    MultiCoreSimulator( const std::string& isa, size_t num_cores, uint64 quantum);
+    ~MultiCoreSimulator() override;
+    MultiCoreSimulator( const MultiCoreSimulator&) = delete;
+    MultiCoreSimulator( MultiCoreSimulator&&) = delete;
+    MultiCoreSimulator& operator=( const MultiCoreSimulator&) = delete;
+    MultiCoreSimulator& operator=( MultiCoreSimulator&&) = delete;
+
+    void set_memory( const std::shared_ptr<FuncMemory>& memory);
+    void set_kernel( size_t core_id, const std::shared_ptr<Kernel>& kernel);
+    void load_file( const std::string& name);
+    void set_pc( Addr pc);
+
+    Trap run( uint64 instrs_to_run);
+    Trap run_no_limit() { return run( MAX_VAL64); }
+
+    size_t get_cores_num() const noexcept { return cores.size(); }
+    CycleAccurateSimulator* get_core( size_t core_id) const { return cores.at( core_id).sim.get(); }
+    int get_exit_code() const noexcept;
+    uint64 get_cycles() const noexcept { return cycles; }
+
+    void dump_statistics() const;
+
+private:
+    struct Core
+    {
+        std::shared_ptr<CycleAccurateSimulator> sim;
+        std::shared_ptr<QuantumMemory> memory;
+        std::shared_ptr<Kernel> kernel;
+        std::chrono::duration<double, std::milli> busy_time{};
+        std::exception_ptr exception = nullptr;
+        bool halted = false;
+    };
+
+    void clock_quantum( Core* core) const;
+    void end_quantum() noexcept;
+    Trap get_result_trap() const;
+    void register_statistics();
+    uint64 get_executed_instrs() const noexcept;
+    double get_busy_time() const noexcept;
+
+    std::vector<Core> cores;
+    const uint64 quantum;
+    uint64 cycles = 0;
+    uint64 quantums = 0;
+    bool finished = false;
+    std::exception_ptr commit_exception = nullptr;
+    std::chrono::duration<double, std::milli> wall_time{};
+};
+
+#endif // MULTI_CORE_H
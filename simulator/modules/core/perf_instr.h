@@ -11,6 +11,7 @@
 #define PERF_INSTR_H
 
 #include <infra/types.h>
+#include <modules/execute/func_units.h>
 #include <modules/fetch/bpu/bp_interface.h>
 
 #include <utility>
@@ -22,6 +23,10 @@ class PerfInstr : public FuncInstr
 {
     /* info for branch misprediction unit */
     const BPInterface bp_data = {};
+    const FuncUnitClass func_unit_class;
+
+    /* ALU stage chosen by the decode stage */
+    uint8 execution_stage = 0;
 
     // Returns address used to train branch target prediction
     auto get_bp_upd_address() const {
@@ -29,9 +34,11 @@ class PerfInstr : public FuncInstr
     }
 
 public:
-    uint8 alu_number_instruction = 0;
-
-    PerfInstr( const FuncInstr& instr, const BPInterface& bp_info) : FuncInstr( instr), bp_data( bp_info) { }
+    PerfInstr( const FuncInstr& instr, const BPInterface& bp_info)
+        : FuncInstr( instr)
+        , bp_data( bp_info)
+        , func_unit_class( ::get_func_unit_class( instr))
+    { }
 
     const auto& get_bp_data() const { return bp_data; }
 
@@ -48,15 +55,24 @@ public:
         return Target( this->get_decoded_target(), this->get_sequence_id() + 1);
     }
 
+    // Prediction state is kept to train and repair predictors
     BPInterface get_bp_upd() const {
-        return BPInterface( this->get_PC(), this->is_taken(), this->get_bp_upd_address(), true);
+        auto result = bp_data;
+        result.is_taken = this->is_taken();
+        result.target = this->get_bp_upd_address();
+        result.is_hit = true;
+        return result;
     }
 
     bool is_bypassible() const { return !this->is_conditional_move() &&
                                         !this->is_partial_load()     &&
                                         this->get_accumulation_type() == 0; }
 
-    auto is_long_arithmetic() const { return this->is_divmult(); }
+    auto get_func_unit_class() const { return func_unit_class; }
+    void set_execution_stage( uint32 stage) { execution_stage = narrow_cast<uint8>( stage); }
+    uint32 get_execution_stage() const { return execution_stage; }
+    auto is_long_arithmetic() const { return func_unit_class == FuncUnitClass::MULTIPLIER
+                                          || func_unit_class == FuncUnitClass::DIVIDER; }
 
     auto is_mem_stage_required() const { return this->is_load()  ||
                                                 this->is_store() ||
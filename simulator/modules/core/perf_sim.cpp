@@ -5,30 +5,51 @@
 
 #include "perf_sim.h"
 #include <func_sim/instr_memory.h>
+#include <kernel/kernel.h>
 #include <memory/elf/elf_loader.h>
 
+#include <array>
 #include <chrono>
 #include <iostream>
+#include <string_view>
 
 namespace config {
     static const AliasedValue<std::string> units_to_log = { "l", "logs", "nothing", "print logs for modules"};
     static const Switch topology_dump = { "tdump", "module topology dump into topology.json" };
+    static const Value<uint32> hot_pcs = { "hot-pcs", 0, "number of the hottest PCs in the CPI stack"};
 } // namespace config
 
 template <typename ISA>
 PerfSim<ISA>::PerfSim( std::endian endian, std::string_view isa)
         :CycleAccurateSimulator( isa)
+        , cpi_stack( config::hot_pcs)
+        , interval_statistics( IntervalStatistics::create_configured())
+        , caches( CacheHierarchy::create_configured())
         , endian( endian)
-        , fetch( this), decode( this), execute( this),late_alu(this),  mem( this),  branch( this), writeback( this, endian)
+        , fetch( this), decode( this), execute( this), mem( this), branch( this), writeback( this, endian)
 {
+    const auto last_alu_stage = AluClusters::create_configured().get_last_stage();
+    for ( uint32 stage = 1; stage <= last_alu_stage; ++stage)
+        late_alus.push_back( std::make_unique<Late_alu<FuncInstr>>( this, stage, last_alu_stage));
+
     rp_halt = make_read_port<Trap>("WRITEBACK_2_CORE_HALT", Port::LATENCY);
+    rp_mem_stall = make_read_port<uint64>("MEMORY_2_CORE_STALL", Port::LATENCY);
 
+    fetch.set_cache_hierarchy( caches.get());
+    mem.set_cache_hierarchy( caches.get());
+    fetch.set_cpi_stack( &cpi_stack);
+    decode.set_cpi_stack( &cpi_stack);
+    mem.set_cpi_stack( &cpi_stack);
+    branch.set_cpi_stack( &cpi_stack);
+    writeback.set_cpi_stack( &cpi_stack);
     decode.set_RF( &rf);
-    late_alu.set_RF(&rf);
+    for ( auto& late_alu : late_alus)
+        late_alu->set_RF( &rf);
     writeback.set_RF( &rf);
     writeback.set_driver( ISA::create_driver( this));
 
     set_writeback_bandwidth( Port::BW);
+    register_statistics();
 
     init_portmap();
     enable_logging( config::units_to_log);
@@ -45,10 +66,24 @@ void PerfSim<ISA>::set_memory( std::shared_ptr<FuncMemory> m)
     mem.set_memory( m);
 }
 
+template <typename ISA>
+void PerfSim<ISA>::set_kernel( std::shared_ptr<Kernel> k)
+{
+    kernel = k;
+    writeback.set_kernel( k, get_isa());
+}
+
+template <typename ISA>
+void PerfSim<ISA>::set_profiler( std::shared_ptr<GuestProfiler> value)
+{
+    profiler = std::move( value);
+    writeback.set_profiler( profiler.get());
+}
+
 template <typename ISA>
 void PerfSim<ISA>::set_target( const Target& target)
 {
-    writeback.set_target( target, curr_cycle);
+    writeback.set_target( target, pipeline_cycle);
 }
 
 template<typename ISA>
@@ -58,16 +93,33 @@ Addr PerfSim<ISA>::get_pc() const
 }
 
 template<typename ISA>
-Trap PerfSim<ISA>::run( uint64 instrs_to_run)
+void PerfSim<ISA>::start_run( uint64 instrs_to_run)
 {
     current_trap = Trap( Trap::NO_TRAP);
 
     writeback.set_instrs_to_run( instrs_to_run);
 
     start_time = std::chrono::high_resolution_clock::now();
+}
+
+template<typename ISA>
+Trap PerfSim<ISA>::run( uint64 instrs_to_run)
+{
+    start_run( instrs_to_run);
 
-    while (current_trap == Trap::NO_TRAP)
-        clock();
+    try {
+        while (current_trap == Trap::NO_TRAP)
+            clock();
+    }
+    catch (...) {
+        // Checker lags behind, and its mismatch would be the root cause
+        writeback.sync_checker();
+        throw;
+    }
+    writeback.sync_checker();
+
+    if ( interval_statistics != nullptr)
+        interval_statistics->finish( get_interval_counters());
 
     dump_statistics();
 
@@ -77,8 +129,30 @@ Trap PerfSim<ISA>::run( uint64 instrs_to_run)
 template<typename ISA>
 void PerfSim<ISA>::clock()
 {
-    clock_tree( curr_cycle);
+    caches->clock( curr_cycle);
+    if ( profiler != nullptr)
+        profiler->add_cycle();
+
+    /* In-order pipeline is frozen as a whole on a data cache miss */
+    if ( rp_mem_stall->is_ready( pipeline_cycle)) {
+        stall_cycles = rp_mem_stall->read( pipeline_cycle);
+        dcache_stalls->add( stall_cycles);
+    }
+
+    if ( stall_cycles != 0)
+    {
+        --stall_cycles;
+        cpi_stack.add_dcache_miss_cycle();
+    }
+    else
+    {
+        clock_tree( pipeline_cycle);
+        pipeline_cycle.inc();
+    }
     curr_cycle.inc();
+
+    if ( interval_statistics != nullptr && interval_statistics->is_due( curr_cycle.to_uint64(), writeback.get_executed_instrs()))
+        interval_statistics->sample( get_interval_counters());
 }
 
 template<typename ISA>
@@ -87,7 +161,8 @@ void PerfSim<ISA>::clock_tree( Cycle cycle)
     fetch.clock( cycle);
     decode.clock( cycle);
     execute.clock( cycle);
-    late_alu.clock( cycle);
+    for ( auto& late_alu : late_alus)
+        late_alu->clock( cycle);
     mem.clock( cycle);
     branch.clock( cycle);
     writeback.clock( cycle);
@@ -96,34 +171,65 @@ void PerfSim<ISA>::clock_tree( Cycle cycle)
     sout << "******************\n";
 }
 
-auto get_rate( int total, float64 piece)
+template<typename ISA>
+IntervalCounters PerfSim<ISA>::get_interval_counters() const
 {
-    return total != 0 ? ( piece / total * 100) : 0;
+    IntervalCounters counters;
+    counters.cycles = curr_cycle.to_uint64();
+    counters.instrs = writeback.get_executed_instrs();
+    counters.jumps = branch.get_jumps_num();
+    counters.mispredictions = branch.get_mispredictions_num();
+    counters.decode_jumps = decode.get_jumps_num();
+    counters.decode_mispredictions = decode.get_mispredictions_num();
+    counters.btb_hits = branch.get_btb_hits_num();
+    counters.icache_hits = caches->get_l1i().get_statistics().hits;
+    counters.icache_misses = caches->get_l1i().get_statistics().misses;
+    counters.dcache_hits = caches->get_l1d().get_statistics().hits;
+    counters.dcache_misses = caches->get_l1d().get_statistics().misses;
+    for ( size_t i = 0; i < CPI_COMPONENTS_NUM; ++i)
+        counters.stall_cycles.at( i) = cpi_stack.get_cycles( static_cast<CpiComponent>( i));
+    return counters;
 }
 
 template<typename ISA>
-void PerfSim<ISA>::dump_statistics() const
+void PerfSim<ISA>::register_statistics()
 {
-    auto executed_instrs = writeback.get_executed_instrs();
-    auto now_time = std::chrono::high_resolution_clock::now();
-    auto time = std::chrono::duration<double, std::milli>(now_time - start_time).count();
-    auto frequency = double{ curr_cycle} / time; // cycles per millisecond = kHz
-    auto ipc = 1.0 * executed_instrs / double{ curr_cycle};
-    auto simips = executed_instrs / time;
-    auto decode_mispredict_rate = 1.0 * get_rate( decode.get_jumps_num(), decode.get_mispredictions_num());
-    auto branch_mispredict_rate = 1.0 * get_rate( branch.get_jumps_num(), branch.get_mispredictions_num());
+    const auto get_time = [this]() {
+        return std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start_time).count();
+    };
+    const auto get_instrs = [this]() { return 1.0 * writeback.get_executed_instrs(); };
+    const auto get_cycles = [this]() { return 1.0 * curr_cycle.to_uint64(); };
+
+    make_formula( "instrs", "retired instructions", get_instrs);
+    make_formula( "cycles", "simulated cycles", get_cycles);
+    make_formula( "ipc", "retired instructions per cycle", [=]() { return get_instrs() / get_cycles(); });
+    make_formula( "sim_freq", "simulated cycles per host millisecond, kHz", [=]() { return get_cycles() / get_time(); });
+    make_formula( "sim_ips", "retired instructions per host millisecond, kips", [=]() { return get_instrs() / get_time(); });
+    make_formula( "instr_size", "size of a pipeline instruction in bytes", []() { return 1.0 * sizeof( Instr); });
+    dcache_stalls = make_distribution( "dcache_stalls", "cycles of pipeline freezes on data cache misses", 16, 16);
 
+    for ( size_t i = 0; i < CPI_COMPONENTS_NUM; ++i) {
+        const auto component = static_cast<CpiComponent>( i);
+        make_formula( "cpi_stack." + get_cpi_component_key( component), std::string( get_cpi_component_name( component)) + " cycles per instruction",
+                      [=, this]() { return cpi_stack.get_cycles( component) / get_instrs(); });
+    }
+
+    // L1 caches are registered by the fetch and memory stages, L2 is shared by them
+    for ( auto& [name, description, formula] : caches->get_l2().get_statistics_formulas())
+        make_formula( "l2." + name, std::move( description), std::move( formula));
+}
+
+template<typename ISA>
+void PerfSim<ISA>::dump_statistics() const
+{
+    std::cout << std::endl << "****************************" << std::endl;
+    statistics_dumping( std::cout);
+    cpi_stack.dump( std::cout, writeback.get_executed_instrs(), kernel != nullptr ? kernel->get_symbols() : SymbolTable());
+    caches->dump_statistics( std::cout);
     std::cout << std::endl << "****************************"
-              << std::endl << "instrs:     " << executed_instrs
-              << std::endl << "cycles:     " << curr_cycle
-              << std::endl << "IPC:        " << ipc
-              << std::endl << "sim freq:   " << frequency << " kHz"
-              << std::endl << "sim IPS:    " << simips    << " kips"
-              << std::endl << "instr size: " << sizeof(Instr) << " bytes"
-              << std::endl << "mispredict: detected on decode stage - " << decode_mispredict_rate << "%"
-              << std::endl << "            detected on branch stage - " << branch_mispredict_rate << "%"
-              << std::endl << "****************************"
               << std::endl;
+
+    statistics_dumping( config::stats_json);
 }
 
 template <typename ISA>
@@ -6,6 +6,8 @@
 #ifndef PERF_SIM_H
 #define PERF_SIM_H
 
+#include "cpi_stack.h"
+#include "interval_statistics.h"
 #include "perf_instr.h"
 
 #include <modules/branch/branch.h>
@@ -17,7 +19,9 @@
 #include <modules/writeback/writeback.h>
 #include <simulator.h>
 #include <chrono>
+#include <memory>
 #include <modules/late_alu/late_alu.h>
+#include <vector>
 
 template <typename ISA>
 class PerfSim : public CycleAccurateSimulator
@@ -29,9 +33,15 @@ public:
     Trap run( uint64 instrs_to_run) final;
     void set_target( const Target& target) final;
     void set_memory( std::shared_ptr<FuncMemory> memory) final;
-    void set_kernel( std::shared_ptr<Kernel> k) final { writeback.set_kernel( k, get_isa()); }
+    void set_kernel( std::shared_ptr<Kernel> k) final;
+    void set_profiler( std::shared_ptr<GuestProfiler> value) final;
     void disable_checker() final { writeback.disable_checker(); }
+    void set_checker_period( uint64 period) final { writeback.set_checker_period( period); }
     void clock() final;
+    void start_run( uint64 instrs_to_run) final;
+    Trap get_trap() const final { return current_trap; }
+    uint64 get_executed_instrs() const final { return writeback.get_executed_instrs(); }
+    uint64 get_cycles() const final { return curr_cycle.to_uint64(); }
     void enable_driver_hooks() final { writeback.enable_driver_hooks(); }
     void set_writeback_bandwidth( uint32 wb_bandwidth) { decode.set_wb_bandwidth( wb_bandwidth);}
     int get_exit_code() const noexcept final { return writeback.get_exit_code(); }
@@ -60,26 +70,39 @@ private:
     using Instr = PerfInstr<FuncInstr>;
 
     Cycle curr_cycle = 0_cl;
+
+    /* Pipeline does not advance while the data cache serves a miss */
+    Cycle pipeline_cycle = 0_cl;
+    uint64 stall_cycles = 0;
+    Distribution* dcache_stalls = nullptr;
     decltype( std::chrono::high_resolution_clock::now()) start_time = {};
+    CpiStack cpi_stack;
+    std::unique_ptr<IntervalStatistics> interval_statistics;
 
     /* simulator units */
     RF<FuncInstr> rf;
     std::shared_ptr<FuncMemory> memory;
+    std::unique_ptr<CacheHierarchy> caches;
+    std::shared_ptr<Kernel> kernel;
+    std::shared_ptr<GuestProfiler> profiler;
     const std::endian endian;
 
     Fetch<FuncInstr> fetch;
     Decode<FuncInstr> decode;
     Execute<FuncInstr> execute;
-    Late_alu<FuncInstr> late_alu;
+    std::vector<std::unique_ptr<Late_alu<FuncInstr>>> late_alus;
     Mem<FuncInstr> mem;
     Branch<FuncInstr> branch;
     Writeback<ISA> writeback;
 
     /* ports */
     ReadPort<Trap>* rp_halt = nullptr;
+    ReadPort<uint64>* rp_mem_stall = nullptr;
 
     void clock_tree( Cycle cycle);
+    void register_statistics();
     void dump_statistics() const;
+    IntervalCounters get_interval_counters() const;
     Trap current_trap = Trap(Trap::NO_TRAP);
 
     uint64 read_register( Register index) const { return narrow_cast<uint64>( rf.read( index)); }
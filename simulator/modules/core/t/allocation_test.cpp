@@ -0,0 +1,102 @@
+/**
+ * Test for heap allocations in the cycle loop of Performance Simulation
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include <catch.hpp>
+
+#include <kernel/kernel.h>
+#include <memory/memory.h>
+#include <simulator.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Counting global allocator, it replaces allocation functions of the whole executable
+static std::atomic<uint64> allocations = 0;
+
+static void* counted_malloc( size_t size)
+{
+    ++allocations;
+    if ( void* ptr = std::malloc( size == 0 ? 1 : size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+static void* counted_aligned_alloc( size_t size, std::align_val_t alignment)
+{
+    ++allocations;
+    const auto align = static_cast<size_t>( alignment);
+    if ( void* ptr = std::aligned_alloc( align, ( size + align - 1) / align * align))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new( size_t size) { return counted_malloc( size); }
+void* operator new[]( size_t size) { return counted_malloc( size); }
+void* operator new( size_t size, std::align_val_t alignment) { return counted_aligned_alloc( size, alignment); }
+void* operator new[]( size_t size, std::align_val_t alignment) { return counted_aligned_alloc( size, alignment); }
+void operator delete( void* ptr) noexcept { std::free( ptr); }
+void operator delete[]( void* ptr) noexcept { std::free( ptr); }
+void operator delete( void* ptr, size_t) noexcept { std::free( ptr); }
+void operator delete[]( void* ptr, size_t) noexcept { std::free( ptr); }
+void operator delete( void* ptr, std::align_val_t) noexcept { std::free( ptr); }
+void operator delete[]( void* ptr, std::align_val_t) noexcept { std::free( ptr); }
+void operator delete( void* ptr, size_t, std::align_val_t) noexcept { std::free( ptr); }
+void operator delete[]( void* ptr, size_t, std::align_val_t) noexcept { std::free( ptr); }
+
+static auto create_sim( const std::string& isa, const std::string& binary_name)
+{
+    auto sim = CycleAccurateSimulator::create_simulator( isa);
+    auto mem = FuncMemory::create_default_hierarchied_memory();
+    sim->set_memory( mem);
+
+    static std::istream nullin( nullptr);
+    static std::ostream nullout( nullptr);
+    auto kernel = Kernel::create_kernel( true, nullin, nullout, nullout);
+    kernel->set_simulator( sim);
+    kernel->connect_memory( mem);
+    kernel->connect_exception_handler();
+    kernel->load_file( binary_name);
+    sim->set_kernel( kernel);
+
+    sim->set_pc( kernel->get_start_pc());
+    return sim;
+}
+
+// Returns the number of allocations after warm-up,
+// which also lets the checker thread touch the guest pages written by the program
+static uint64 count_steady_state_allocations( CycleAccurateSimulator* sim)
+{
+    static const constexpr uint64 WARM_UP_CYCLES = 4000;
+    sim->start_run( MAX_VAL64);
+
+    uint64 cycles = 0;
+    for ( ; cycles < WARM_UP_CYCLES && sim->get_trap() == Trap::NO_TRAP; ++cycles)
+        sim->clock();
+
+    const auto warm_allocations = allocations.load();
+    for ( ; sim->get_trap() == Trap::NO_TRAP; ++cycles)
+        sim->clock();
+
+    CHECK( cycles > WARM_UP_CYCLES);
+    return allocations.load() - warm_allocations;
+}
+
+TEST_CASE( "Perf_Sim: no allocations in steady state")
+{
+    // the checker is enabled, retired instructions are passed to its thread by value
+    auto sim = create_sim( "mars", TEST_PATH "/mips/mips-tt-no-delayed-branches.bin");
+    CHECK( count_steady_state_allocations( sim.get()) == 0);
+}
+
+TEST_CASE( "Perf_Sim: no allocations with the hash checker")
+{
+    // records of checked periods are stored in a preallocated ring
+    auto sim = create_sim( "mars", TEST_PATH "/mips/mips-tt-no-delayed-branches.bin");
+    sim->set_checker_period( 4);
+    CHECK( count_steady_state_allocations( sim.get()) == 0);
+}
@@ -0,0 +1,103 @@
+/**
+ * Test for multi-core Performance Simulation
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include <catch.hpp>
+
+#include <kernel/kernel.h>
+#include <memory/memory.h>
+#include <modules/core/multi_core.h>
+
+#include <sstream>
+
+static auto init( const std::string& isa, size_t num_cores, uint64 quantum, const std::shared_ptr<FuncMemory>& mem)
+{
+    auto sim = std::make_unique<MultiCoreSimulator>( isa, num_cores, quantum);
+    sim->set_memory( mem);
+    for ( size_t i = 0; i < num_cores; ++i)
+        sim->set_kernel( i, Kernel::create_kernel( false, std::cin, std::cout, std::cerr));
+
+    return sim;
+}
+
+// Redirect std::cout to /dev/null
+static auto run_silent( MultiCoreSimulator* sim, uint64 steps)
+{
+    std::ostream nullout( nullptr);
+    OStreamWrapper cout_wrapper( std::cout, nullout);
+    return sim->run( steps);
+}
+
+TEST_CASE( "Multi_core: invalid configuration")
+{
+    CHECK_THROWS_AS( MultiCoreSimulator( "mips32", 0, 100), InvalidMultiCoreConfig);
+    CHECK_THROWS_AS( MultiCoreSimulator( "mips32", 2, 0), InvalidMultiCoreConfig);
+}
+
+TEST_CASE( "Multi_core: kernel before memory")
+{
+    MultiCoreSimulator sim( "mips32", 2, 100);
+    CHECK_THROWS_AS( sim.set_kernel( 0, Kernel::create_kernel( false, std::cin, std::cout, std::cerr)), InvalidMultiCoreConfig);
+}
+
+TEST_CASE( "Multi_core: run nops")
+{
+    auto sim = init( "mips32", 2, 16, FuncMemory::create_default_hierarchied_memory());
+    sim->set_pc( 0x10);
+
+    CHECK( run_silent( sim.get(), 100) == Trap::BREAKPOINT);
+    CHECK( sim->get_cores_num() == 2);
+    for ( size_t i = 0; i < sim->get_cores_num(); ++i) {
+        CHECK( sim->get_core( i)->get_executed_instrs() >= 100);
+        CHECK( sim->get_core( i)->get_cycles() <= sim->get_cycles());
+    }
+    CHECK( sim->get_exit_code() == 0);
+}
+
+TEST_CASE( "Multi_core: statistics of cores")
+{
+    auto sim = init( "mips32", 2, 16, FuncMemory::create_default_hierarchied_memory());
+    sim->set_pc( 0x10);
+
+    std::ostringstream oss;
+    OStreamWrapper cout_wrapper( std::cout, oss);
+    CHECK( sim->run( 100) == Trap::BREAKPOINT);
+    CHECK_THAT( oss.str(), Catch::Contains( "\nmulticore.ipc ")
+                        && Catch::Contains( "\nmulticore.busy_time.core1 ")
+                        && Catch::Contains( "\nmulticore.core0.writeback.instrs ")
+                        && Catch::Contains( "\nmulticore.core1.fetch.btb.hits "));
+
+    std::istringstream lines( oss.str().substr( oss.str().find( "\nmulticore.instrs ")));
+    std::string name;
+    uint64 instrs = 0;
+    lines >> name >> instrs;
+    CHECK( instrs == sim->get_core( 0)->get_executed_instrs() + sim->get_core( 1)->get_executed_instrs());
+}
+
+TEST_CASE( "Multi_core: hart ids and deterministic shared stores")
+{
+    auto mem = FuncMemory::create_default_hierarchied_memory();
+    const std::vector<uint32> program = {
+        0xf1402573, // csrr a0, mhartid
+        0x00000013, // nop
+        0x00000013, // nop
+        0x00000013, // nop
+        0x00000013, // nop
+        0x00000013, // nop
+        0x10a02023, // sw a0, 0x100(zero)
+        0x0000006f, // j . (halts the hart)
+    };
+    for ( size_t i = 0; i < program.size(); ++i)
+        mem->write<uint32, std::endian::little>( program[i], 0x1000 + i * 4);
+
+    auto sim = init( "riscv32", 4, 8, mem);
+    sim->set_pc( 0x1000);
+    for ( size_t i = 0; i < sim->get_cores_num(); ++i)
+        CHECK( sim->get_core( i)->read_csr_register( "mhartid") == i);
+
+    CHECK( run_silent( sim.get(), 1000) == Trap::HALT);
+
+    // All cores store to the same address, the core with the highest id commits last
+    CHECK( mem->read<uint32, std::endian::little>( 0x100) == 3);
+}
@@ -9,6 +9,8 @@
 #include <modules/core/perf_sim.h>
 #include <modules/writeback/writeback.h>
 
+#include <sstream>
+
 static auto init( const std::string& isa)
 {
     // Just call a constructor
@@ -80,6 +82,33 @@ TEST_CASE( "Perf_Sim_init: push a nop")
     CHECK( sim->get_exit_code() == 0);
 }
 
+static auto run_instruction( uint32 raw)
+{
+    auto sim = CycleAccurateSimulator::create_simulator( "mars");
+    auto mem = FuncMemory::create_default_hierarchied_memory();
+    sim->set_memory( mem);
+
+    auto kernel = Kernel::create_kernel( false, std::cin, std::cout, std::cerr);
+    kernel->set_simulator( sim);
+    kernel->connect_memory( mem);
+    kernel->connect_exception_handler();
+    sim->set_kernel( kernel);
+
+    // Checker has its own copy of the memory
+    sim->disable_checker();
+    mem->write<uint32, std::endian::little>( raw, 0x10);
+    sim->set_pc( 0x10);
+    run_silent( sim, 2);
+    return sim->get_cycles();
+}
+
+TEST_CASE( "Perf_Sim: data cache miss stalls pipeline")
+{
+    const auto nop_cycles = run_instruction( 0x0);
+    const auto load_cycles = run_instruction( 0x8c010100); // lw $1, 0x100($0)
+    CHECK( load_cycles >= nop_cycles + ( Port::LONG_LATENCY - Port::LATENCY).to_size_t());
+}
+
 TEST_CASE( "PerfSim: create empty memory and get lost")
 {
     auto m = FuncMemory::create_default_hierarchied_memory();
@@ -160,6 +189,163 @@ TEST_CASE( "Torture_Test: Perf_Sim, MARS 32, Core Universal")
     CHECK( sim->get_exit_code() == 0);
 }
 
+TEST_CASE( "Perf_Sim: CPI stack")
+{
+    std::istream nullin( nullptr);
+    std::ostream nullout( nullptr);
+    std::ostringstream oss;
+    auto sim = create_mars_sim( "mars", TEST_PATH "/mips/mips-tt-no-delayed-branches.bin", nullin, nullout, false);
+    OStreamWrapper cout_wrapper( std::cout, oss);
+    CHECK( sim->run_no_limit() == Trap::HALT);
+    CHECK_THAT( oss.str(), Catch::Contains( "CPI stack:") && Catch::Contains( "base - ") && Catch::Contains( "branch flush - "));
+}
+
+TEST_CASE( "Perf_Sim: statistics of modules")
+{
+    std::istream nullin( nullptr);
+    std::ostream nullout( nullptr);
+    std::ostringstream oss;
+    auto sim = create_mars_sim( "mars", TEST_PATH "/mips/mips-tt-no-delayed-branches.bin", nullin, nullout, false);
+    OStreamWrapper cout_wrapper( std::cout, oss);
+    CHECK( sim->run_no_limit() == Trap::HALT);
+    CHECK_THAT( oss.str(), Catch::Contains( "\ncpu.ipc ")
+                        && Catch::Contains( "\ncpu.mem.l1d.miss_rate ")
+                        && Catch::Contains( "\ncpu.fetch.btb.hit_rate ")
+                        && Catch::Contains( "\ncpu.execute.instrs ")
+                        && Catch::Contains( "\ncpu.l2.hits ")
+                        && Catch::Contains( "\ncpu.decode.mispredictions ")
+                        && Catch::Contains( "\ncpu.branch.direct_calls.jumps "));
+
+    std::istringstream lines( oss.str().substr( oss.str().find( "\ncpu.writeback.instrs ")));
+    std::string name;
+    uint64 instrs = 0;
+    lines >> name >> instrs;
+    CHECK( instrs == sim->get_executed_instrs());
+}
+
+TEST_CASE( "CPI stack: wrong path cycles are charged to the flush")
+{
+    CpiStack stack( 2);
+    stack.add_instr_cycle( 0x10, 1, CpiComponent::BASE);
+    stack.add_instr_cycle( 0x14, 2, CpiComponent::DATA_HAZARD);
+    stack.add_instr_cycle( 0x18, 3, CpiComponent::BASE);
+    stack.add_instr_cycle( 0x1c, 4, CpiComponent::BASE);
+    stack.flush( 0x14, 2, CpiComponent::BRANCH_FLUSH);
+    stack.add_frontend_cycle();
+    stack.set_dcache_miss( 0x10);
+    stack.add_dcache_miss_cycle();
+
+    CHECK( stack.get_cycles( CpiComponent::BASE) == 1);
+    CHECK( stack.get_cycles( CpiComponent::DATA_HAZARD) == 1);
+    CHECK( stack.get_cycles( CpiComponent::BRANCH_FLUSH) == 3);
+    CHECK( stack.get_cycles( CpiComponent::DCACHE_MISS) == 1);
+    CHECK( stack.get_cycles( 0x14, CpiComponent::BRANCH_FLUSH) == 3);
+    CHECK( stack.get_cycles( 0x18, CpiComponent::BASE) == 0);
+    CHECK( stack.get_cycles( 0x10, CpiComponent::DCACHE_MISS) == 1);
+
+    std::ostringstream oss;
+    stack.dump( oss, 3, SymbolTable( { ElfSymbol{ 0x10, 0x10, "loop"} }));
+    CHECK_THAT( oss.str(), Catch::Contains( "CPI stack:  2") && Catch::Contains( "branch flush - 1 (50%)")
+                        && Catch::Contains( "0x14 (loop+0x4) - 4 cycles: data hazard 1, branch flush 3"));
+}
+
+static IntervalCounters get_counters( uint64 cycles, uint64 instrs)
+{
+    IntervalCounters counters;
+    counters.cycles = cycles;
+    counters.instrs = instrs;
+    counters.jumps = instrs / 4;
+    counters.mispredictions = instrs / 8;
+    counters.btb_hits = instrs / 8;
+    counters.icache_hits = instrs;
+    counters.stall_cycles.at( static_cast<size_t>( CpiComponent::BASE)) = instrs;
+    counters.stall_cycles.at( static_cast<size_t>( CpiComponent::BRANCH_FLUSH)) = cycles - instrs;
+    return counters;
+}
+
+TEST_CASE( "Interval statistics: CSV")
+{
+    std::ostringstream oss;
+    IntervalStatistics stats( &oss, "csv", 100, 40);
+    CHECK_FALSE( stats.is_due( 99, 39));
+    CHECK( stats.is_due( 100, 10));
+    CHECK( stats.is_due( 10, 40));
+
+    stats.sample( get_counters( 100, 32));
+    CHECK_FALSE( stats.is_due( 150, 71));
+    CHECK( stats.is_due( 150, 72));
+    stats.sample( get_counters( 200, 96));
+    stats.finish( get_counters( 200, 96));
+
+    std::istringstream lines( oss.str());
+    std::string header;
+    std::string first;
+    std::string second;
+    std::string end;
+    std::getline( lines, header);
+    std::getline( lines, first);
+    std::getline( lines, second);
+    CHECK_FALSE( std::getline( lines, end));
+
+    CHECK_THAT( header, Catch::StartsWith( "cycles,instrs,ipc,mispredict_rate,decode_mispredict_rate,bp_hit_rate,icache_hit_rate,dcache_hit_rate,cpi_base,")
+                     && Catch::EndsWith( ",host_kips,host_khz"));
+    CHECK_THAT( first, Catch::StartsWith( "100,32,0.32,0.5,,0.5,1,,1,0,0,0,2.125,0,0,0,"));
+    CHECK_THAT( second, Catch::StartsWith( "200,96,0.64,0.5,,0.5,1,,1,0,0,0,0.5625,0,0,0,"));
+}
+
+TEST_CASE( "Interval statistics: JSON")
+{
+    std::ostringstream oss;
+    IntervalStatistics stats( &oss, "json", 0, 10);
+    CHECK_FALSE( stats.is_due( 1000000, 9));
+    stats.finish( get_counters( 50, 20));
+    CHECK_THAT( oss.str(), Catch::StartsWith( "{\"cycles\":50,\"instrs\":20,\"ipc\":0.4,\"mispredict_rate\":0.4,\"decode_mispredict_rate\":null,")
+                        && Catch::Contains( ",\"cpi_stack\":{\"base\":1,\"data_hazard\":0,") && Catch::EndsWith( "}\n"));
+}
+
+TEST_CASE( "Interval statistics: cycles flushed from the previous interval")
+{
+    CpiStack stack( 2);
+    const auto get_stack_counters = [&stack]( uint64 cycles, uint64 instrs) {
+        IntervalCounters counters;
+        counters.cycles = cycles;
+        counters.instrs = instrs;
+        for ( size_t i = 0; i < CPI_COMPONENTS_NUM; ++i)
+            counters.stall_cycles.at( i) = stack.get_cycles( static_cast<CpiComponent>( i));
+        return counters;
+    };
+
+    std::ostringstream oss;
+    IntervalStatistics stats( &oss, "json", 2, 0);
+    stack.add_instr_cycle( 0x10, 1, CpiComponent::BASE);
+    stack.add_instr_cycle( 0x14, 2, CpiComponent::BASE);
+    stats.sample( get_stack_counters( 2, 2));
+
+    // the cycle of the wrong path instruction is charged to the branch
+    stack.flush( 0x10, 1, CpiComponent::BRANCH_FLUSH);
+    stack.add_frontend_cycle();
+    stats.sample( get_stack_counters( 3, 3));
+
+    std::istringstream lines( oss.str());
+    std::string first;
+    std::string second;
+    std::getline( lines, first);
+    std::getline( lines, second);
+    CHECK_THAT( first, Catch::Contains( "\"base\":1,"));
+    CHECK_THAT( second, Catch::Contains( "\"base\":-1,") && Catch::Contains( "\"branch_flush\":2,"));
+}
+
+TEST_CASE( "Interval statistics: invalid format")
+{
+    std::ostringstream oss;
+    CHECK_THROWS_AS( IntervalStatistics( &oss, "xml", 100, 0), InvalidStatisticsFormat);
+}
+
+TEST_CASE( "Interval statistics: invalid file")
+{
+    CHECK_THROWS_AS( IntervalStatistics( "no_such_directory/stats.csv", "csv", 100, 0), InvalidStatisticsFile);
+}
+
 TEST_CASE( "Torture_Test: Perf_Sim, MARS 32, Core Universal hooked")
 {
     std::istream nullin( nullptr);
@@ -179,6 +365,17 @@ TEST_CASE( "Perf_Sim: Run_SMC_Trace_WithChecker")
     CHECK_THROWS_AS( create_mars_sim( "mars", TEST_PATH "/mips/mips-smc.bin", nullin, nullout, false)->run_no_limit(), CheckerMismatch);
 }
 
+TEST_CASE( "Perf_Sim: Run_SMC_Trace_WithHashChecker")
+{
+    std::istream nullin( nullptr);
+    std::ostream nullout( nullptr);
+    for ( uint64 period : { 7, 1000000}) {
+        auto sim = create_mars_sim( "mars", TEST_PATH "/mips/mips-smc.bin", nullin, nullout, false);
+        sim->set_checker_period( period);
+        CHECK_THROWS_WITH( sim->run_no_limit(), Catch::Contains( "First divergent instruction"));
+    }
+}
+
 TEST_CASE( "Perf_Sim: Run_SMC_Trace_WithoutChecker")
 {
     std::istream nullin( nullptr);
@@ -9,66 +9,98 @@
 #define DATA_BYPASS_H
 
 #include "data_bypass_interface.h"
+#include <modules/core/cpi_stack.h>
 #include <modules/core/perf_instr.h>
+#include <modules/execute/func_units.h>
 
+#include <algorithm>
 #include <array>
-#include <cassert>
-
+#include <bitset>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/*
+ * The scoreboard is a timeline of the next cycles, each cycle has a mask of registers
+ * which cannot be bypassed yet, so hazard checks of any number of sources
+ * are bitwise operations. Producers of the registers are kept in per-register arrays,
+ * the forwarding source is derived from the producer stage in the requested cycle.
+ */
 template <typename FuncInstr>
 class DataBypass
 {
     using Register  = typename FuncInstr::Register;
     using Instr     = PerfInstr<FuncInstr>;
+    static constexpr const uint8 SRC_REGISTERS_NUM = 2;
 
     public:
-        explicit DataBypass( uint64 long_alu_latency) noexcept
-            : long_alu_latency( long_alu_latency)
-        { }
+        using RegisterMask = std::bitset<Register::MAX_REG>;
 
-        auto get_operation_latency()
+        DataBypass( FuncUnitTable units, AluClusters clusters)
+            : func_units( std::move( units))
+            , clusters( std::move( clusters))
         {
-            return writeback_stage_info.operation_latency;
+            for ( size_t i = 0; i < FUNC_UNIT_CLASSES_NUM; ++i)
+                busy_cycles.at( i).assign( func_units.get_count( static_cast<FuncUnitClass>( i)), 0);
         }
 
         // checks whether a source register of an instruction is in the RF
         auto is_in_RF( const Instr& instr, size_t src_index) const noexcept
         {
-            const auto reg_num = instr.get_src( src_index);
-            return get_entry( reg_num).current_stage.is_in_RF();
+            return !is_traced( instr.get_src( src_index).to_rf_index(), now);
         }
 
-        // checks whether a source register of an instruction is bypassible
-        auto is_bypassible( const Instr& instr, size_t src_index) const noexcept
+        // returns a mask of source registers, masks of several instructions may be merged
+        static RegisterMask get_sources_mask( const Instr& instr) noexcept
         {
-            const auto reg_num = instr.get_src( src_index);
-            return get_entry( reg_num).is_bypassible;
+            RegisterMask mask;
+            for ( size_t i = 0; i < SRC_REGISTERS_NUM; ++i)
+                mask.set( instr.get_src( i).to_rf_index());
+            return mask;
         }
 
+        // checks whether registers of the mask are ready to be executed in the given ALU stage
+        bool are_sources_ready( const RegisterMask& sources, uint32 stage) const noexcept
+        {
+            return ( sources & get_slot( Latency( stage)).unavailable).none();
+        }
+
+        // returns the earliest ALU stage where sources of an instruction are ready
+        // and its unit and writeback are free, nothing if the instruction stalls
+        std::optional<uint32> get_execution_stage( const Instr& instr) const noexcept;
+
         // checks whether the stall is needed for an instruction
         auto is_stall( const Instr& instr) const noexcept
         {
-            const auto instruction_latency = get_instruction_latency( instr);
-            return (( !is_in_RF( instr, 0) && !is_bypassible( instr, 0)) ||
-                    ( !is_in_RF( instr, 1) && !is_bypassible( instr, 1)) ||
-                    ( instruction_latency < writeback_stage_info.operation_latency &&
-                        Latency( writeback_stage_info.writeback_bandwidth) <
-                                writeback_stage_info.operation_latency));
+            return !get_execution_stage( instr).has_value();
+        }
+
+        // returns the cause of the stall of an instruction
+        CpiComponent get_stall_cause( const Instr& instr) const noexcept
+        {
+            if ( !has_free_unit( instr))
+                return CpiComponent::LONG_LATENCY_UNIT;
+            if ( has_writeback_conflict( instr))
+                return CpiComponent::WRITEBACK_BANDWIDTH;
+            return CpiComponent::DATA_HAZARD;
         }
 
         // returns a bypass command for a source register of an instruction
-        // in accordance with a current state of the scoreboard
-        auto get_bypass_command( const Instr& instr, size_t src_index, uint8 value) const noexcept
+        // executed in the given ALU stage, the register must not be in the RF
+        auto get_bypass_command( const Instr& instr, size_t src_index, uint32 stage) const noexcept
         {
-            const auto reg_num = instr.get_src( src_index);
-            auto result_ready = BypassCommand<Register>(get_entry(reg_num).current_stage, long_alu_latency - 1_lt);
-            result_ready.set_ready(value);
-            return result_ready;
+            const auto index = instr.get_src( src_index).to_rf_index();
+            const auto cycle = now + Latency( stage);
+            if ( !is_traced( index, cycle))
+                return BypassCommand<Register>::read_RF();
+
+            return BypassCommand<Register>( get_bypass_source( index, cycle - issue_cycles[ index]));
         }
 
-        // garners the information about a new instruction
+        // garners the information about a new instruction entered the first execution stage
         void trace_new_instr( const Instr& instr) noexcept;
 
-        // updates the scoreboard
+        // moves the timeline to the next cycle
         void update() noexcept;
 
         // handles a flush of the pipeline
@@ -76,138 +108,190 @@ class DataBypass
 
         void set_bandwidth( uint32 wb_bandwidth) noexcept
         {
-            writeback_stage_info.writeback_bandwidth = wb_bandwidth;
+            writeback_bandwidth = wb_bandwidth;
         }
 
     private:
-        const Latency long_alu_latency;
+        const FuncUnitTable func_units;
+        const AluClusters clusters;
+
+        // the cycle when the currently traced instruction enters the first execution stage
+        Cycle now = 0_cl;
+
+        // results of these operations enter the ALU stages after the first execution stage
+        enum class Producer : uint8 { ALU, LONG_ARITHMETIC, MEMORY, BRANCH };
+
+        // registers written by instructions in flight
+        RegisterMask traced;
+        std::array<Cycle, Register::MAX_REG> issue_cycles = get_zero_cycles( std::make_index_sequence<Register::MAX_REG>());
+        std::array<Producer, Register::MAX_REG> producers = {};
+        std::array<uint8, Register::MAX_REG> first_alu_stages = {};
+        std::array<uint8, Register::MAX_REG> ready_stages = {};
+        std::array<uint8, Register::MAX_REG> writeback_stages = {};
+
+        // Cycle has no default value
+        template <size_t ... I>
+        static std::array<Cycle, sizeof...( I)> get_zero_cycles( std::index_sequence<I...> /* unused */) noexcept
+        {
+            return { ( static_cast<void>( I), 0_cl)...};
+        }
 
-        struct RegisterInfo
+        struct TimelineSlot
         {
-            RegisterStage current_stage;
-            RegisterStage ready_stage;
-            RegisterStage next_stage_after_first_execution_stage;
-            bool is_bypassible = false;
-            bool is_traced = false;
-
-            void reset() noexcept { *this = RegisterInfo(); }
-
-            void set_next_stage_after_first_execution_stage( const Instr& instr) noexcept
-            {
-                if ( instr.is_long_arithmetic())
-                {
-                    next_stage_after_first_execution_stage.set_to_first_execution_stage();
-                    next_stage_after_first_execution_stage.inc();
-                }
-                else if ( instr.is_branch_stage_required())
-                {
-                    next_stage_after_first_execution_stage.set_to_branch_stage();
-                }
-                else if ( instr.is_mem_stage_required())
-                {
-                    next_stage_after_first_execution_stage.set_to_mem_stage();
-                }
-                else
-                {
-                    next_stage_after_first_execution_stage.set_to_writeback();
-                }
-            }
+            RegisterMask unavailable;
+            uint32 writebacks = 0;
         };
 
-        struct FuncUnitInfo
+        // the timeline starts from the current cycle; it is a ring buffer
+        static constexpr const size_t TIMELINE_SIZE = 128;
+        static_assert( TIMELINE_SIZE > FuncUnitTable::MAX_LATENCY + AluClusters::MAX_STAGE + 2);
+        std::array<TimelineSlot, TIMELINE_SIZE> timeline = {};
+        size_t timeline_head = 0;
+        uint32 writeback_bandwidth = 1;
+
+        // cycles before each unit of a class accepts a new operation
+        std::array<std::vector<uint32>, FUNC_UNIT_CLASSES_NUM> busy_cycles;
+
+        // instructions are written back in program order
+        Latency cycles_to_last_writeback = 0_lt;
+
+        TimelineSlot& get_slot( Latency offset) noexcept
         {
-            Latency operation_latency = 0_lt;
-            uint32 writeback_bandwidth = 1;
+            return timeline[ ( timeline_head + offset.to_size_t()) % timeline.size()];
+        }
 
-            void update() noexcept
-            {
-                if ( operation_latency != 0_lt)
-                    operation_latency = operation_latency - 1_lt;
-            }
-        };
+        const TimelineSlot& get_slot( Latency offset) const noexcept
+        {
+            return timeline[ ( timeline_head + offset.to_size_t()) % timeline.size()];
+        }
 
-        std::array<RegisterInfo, Register::MAX_REG> scoreboard = {};
-        FuncUnitInfo writeback_stage_info = {};
+        // the value is traced until it is written back
+        bool is_traced( size_t index, Cycle cycle) const noexcept
+        {
+            return traced.test( index) && cycle <= issue_cycles[ index] + Latency( writeback_stages[ index]);
+        }
 
-        RegisterInfo& get_entry( Register num) noexcept
+        // returns the bypassing source of a value the given number of cycles after its first execution stage
+        size_t get_bypass_source( size_t index, Latency stage) const noexcept
         {
-            auto idx = num.to_rf_index();
-            assert( idx <= scoreboard.size());
-            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index) Guaranteed
-            return scoreboard[ idx];
+            if ( stage == Latency( writeback_stages[ index]))
+                return BypassSource::WRITEBACK;
+
+            const auto first_alu_stage = Latency( first_alu_stages[ index]);
+            switch ( producers[ index]) {
+            case Producer::MEMORY: return BypassSource::MEMORY;
+            case Producer::BRANCH: return BypassSource::BRANCH;
+            case Producer::LONG_ARITHMETIC:
+                // long arithmetic unit passes its result to the ALU stage 0
+                if ( stage == first_alu_stage)
+                    return BypassSource::LONG_ARITHMETIC;
+                break;
+            default: break;
+            }
+            return BypassSource::alu_stage( stage - first_alu_stage);
         }
 
-        const RegisterInfo& get_entry( Register num) const noexcept
+        // other instructions are executed by the units of the execute stage
+        static bool is_alu_cluster_operation( const Instr& instr) noexcept
         {
-            auto idx = num.to_rf_index();
-            assert( idx <= scoreboard.size());
-            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index) Guaranteed
-            return scoreboard[ idx];
+            return !instr.is_long_arithmetic() && !instr.is_mem_stage_required() && !instr.is_branch_stage_required();
         }
 
-        // returns a latency of an instruction
-        // in accordance with a type of the instruction
-        Latency get_instruction_latency( const Instr& instr) const noexcept
+        // cycles from the first execution stage to writeback
+        Latency get_writeback_latency( const Instr& instr) const noexcept
         {
             if ( instr.is_mem_stage_required() || instr.is_branch_stage_required())
                 return 2_lt;
 
+            const auto alu_latency = Latency( clusters.get_last_stage()) + 1_lt;
             if ( instr.is_long_arithmetic())
-                return long_alu_latency;
+                return func_units.get_timing( instr).latency - 1_lt + alu_latency;
 
-            return 1_lt;
+            return alu_latency;
         }
 
-        // garners the information about a new register used for the 1st destination
-        void trace_new_dst_register( const Instr& instr, Register num) noexcept;
+        bool has_free_unit( const Instr& instr) const noexcept
+        {
+            const auto& units = busy_cycles[ static_cast<size_t>( instr.get_func_unit_class())];
+            return std::find( units.begin(), units.end(), 0) != units.end();
+        }
 
-        // garners the information about a new register used for the 2nd destination
-        void trace_new_dst2_register( const Instr& instr, Register num) noexcept;
+        bool has_writeback_conflict( const Instr& instr) const noexcept
+        {
+            // the instruction enters the first execution stage in the next cycle
+            const auto offset = get_writeback_latency( instr) + 1_lt;
+            return offset < cycles_to_last_writeback || get_slot( offset).writebacks >= writeback_bandwidth;
+        }
+
+        // garners the information about a new register used for a destination
+        void trace_new_register( const Instr& instr, Register num, bool is_bypassible) noexcept;
 };
 
 template <typename FuncInstr>
-void DataBypass<FuncInstr>::trace_new_dst_register( const Instr& instr, Register num) noexcept
+std::optional<uint32> DataBypass<FuncInstr>::get_execution_stage( const Instr& instr) const noexcept
 {
-    auto& entry = get_entry( num);
+    if ( !has_free_unit( instr) || has_writeback_conflict( instr))
+        return std::nullopt;
 
-    entry.current_stage.set_to_first_execution_stage();
-    entry.set_next_stage_after_first_execution_stage( instr);
+    const auto sources = get_sources_mask( instr);
+    if ( !is_alu_cluster_operation( instr))
+        return are_sources_ready( sources, 0) ? std::optional<uint32>( 0) : std::nullopt;
 
+    for ( const auto stage : clusters.get_stages())
+        if ( are_sources_ready( sources, stage))
+            return stage;
 
-    if ( instr.is_long_arithmetic())
+    return std::nullopt;
+}
+
+template <typename FuncInstr>
+void DataBypass<FuncInstr>::trace_new_register( const Instr& instr, Register num, bool is_bypassible) noexcept
+{
+    const auto index = num.to_rf_index();
+    const auto writeback_stage = get_writeback_latency( instr);
+    auto first_alu_stage = 0_lt;
+    auto ready_stage = 1_lt;
+
+    if ( instr.is_branch_stage_required())
     {
-        entry.ready_stage.set_to_stage( long_alu_latency - 1_lt);
+        producers[ index] = Producer::BRANCH;
     }
-    else if ( instr.is_jump())
+    else if ( instr.is_mem_stage_required())
     {
-        entry.ready_stage.set_to_branch_stage();
+        producers[ index] = Producer::MEMORY;
     }
-    else if ( instr.is_load())
+    else if ( instr.is_long_arithmetic())
     {
-        entry.ready_stage.set_to_mem_stage();
+        producers[ index] = Producer::LONG_ARITHMETIC;
+        first_alu_stage = func_units.get_timing( instr).latency - 1_lt;
+        ready_stage = first_alu_stage;
     }
     else
     {
-        entry.ready_stage.set_to_first_execution_stage();
+        producers[ index] = Producer::ALU;
+        ready_stage = Latency( instr.get_execution_stage());
     }
 
+    // the value is not bypassed, so it is read from the RF after writeback
+    if ( !is_bypassible)
+        ready_stage = writeback_stage + 1_lt;
 
-    entry.is_bypassible = ( entry.current_stage == entry.ready_stage);
-    entry.is_traced = true;
-}
-
-template <typename FuncInstr>
-void DataBypass<FuncInstr>::trace_new_dst2_register( const Instr& instr, Register num) noexcept
-{
-    auto& entry = get_entry( num);
-
-    entry.current_stage.set_to_first_execution_stage();
-    entry.set_next_stage_after_first_execution_stage( instr);
+    // the new value replaces the value of the previous producer,
+    // only the stages it has not passed yet are marked in the timeline
+    if ( traced.test( index)) {
+        const auto passed = now - issue_cycles[ index];
+        for ( auto stage = 0_lt; passed + stage < Latency( ready_stages[ index]); stage = stage + 1_lt)
+            get_slot( stage).unavailable.reset( index);
+    }
 
-    // values of registers used for the 2nd destination cannot be bypassed
-    entry.ready_stage.set_to_in_RF();
+    for ( auto stage = 0_lt; stage < ready_stage; stage = stage + 1_lt)
+        get_slot( stage).unavailable.set( index);
 
-    entry.is_traced = true;
+    traced.set( index);
+    issue_cycles[ index] = now;
+    first_alu_stages[ index] = narrow_cast<uint8>( first_alu_stage.to_size_t());
+    ready_stages[ index] = narrow_cast<uint8>( ready_stage.to_size_t());
+    writeback_stages[ index] = narrow_cast<uint8>( writeback_stage.to_size_t());
 }
 
 template <typename FuncInstr>
@@ -216,55 +300,51 @@ void DataBypass<FuncInstr>::trace_new_instr( const Instr& instr) noexcept
     const auto& dst  = instr.get_dst( 0);
     const auto& dst2 = instr.get_dst( 1);
 
-    writeback_stage_info.operation_latency = get_instruction_latency( instr);
+    const auto latency = get_writeback_latency( instr);
+    ++get_slot( latency).writebacks;
+    cycles_to_last_writeback = std::max( cycles_to_last_writeback, latency);
+
+    auto& units = busy_cycles[ static_cast<size_t>( instr.get_func_unit_class())];
+    auto unit = std::find( units.begin(), units.end(), 0);
+    if ( unit != units.end())
+        *unit = func_units.get_timing( instr).initiation_interval - 1;
 
     if ( !dst.is_zero())
-        trace_new_dst_register( instr, dst);
+        trace_new_register( instr, dst, instr.is_bypassible());
 
+    // values of registers used for the 2nd destination cannot be bypassed
     if ( !dst2.is_zero())
-        trace_new_dst2_register( instr, dst2);
+        trace_new_register( instr, dst2, false);
 }
 
 template <typename FuncInstr>
 void DataBypass<FuncInstr>::update() noexcept
 {
-    for ( auto& entry:scoreboard)
-    {
-        if ( !entry.is_traced)
-            continue;
-
-        if ( entry.current_stage.is_writeback())
-        {
-            entry.reset();
-            continue;
-        }
+    now.inc();
 
-        if ( entry.current_stage.is_first_execution_stage())
-            entry.current_stage = entry.next_stage_after_first_execution_stage;
-        else if ( entry.current_stage.is_late_alu())
-        {
-            entry.current_stage.set_to_first_execution_stage();
-        }
-        else if ( entry.current_stage.is_same_stage( long_alu_latency - 1_lt) || entry.current_stage.is_mem_or_branch_stage())
-            entry.current_stage.set_to_writeback();
-        else
-            entry.current_stage.inc();
+    for ( auto& units : busy_cycles)
+        for ( auto& unit : units)
+            if ( unit != 0)
+                --unit;
 
-        if ( entry.current_stage == entry.ready_stage)
-            entry.is_bypassible = true;
-    }
+    if ( cycles_to_last_writeback != 0_lt)
+        cycles_to_last_writeback = cycles_to_last_writeback - 1_lt;
 
-    writeback_stage_info.update();
+    // the past cycle becomes the farthest one
+    timeline[ timeline_head] = TimelineSlot();
+    timeline_head = ( timeline_head + 1) % timeline.size();
 }
 
 template <typename FuncInstr>
 void DataBypass<FuncInstr>::handle_flush() noexcept
 {
-    for ( auto& entry:scoreboard)
-        if ( entry.is_traced)
-            entry.reset();
+    traced.reset();
+    timeline.fill( TimelineSlot());
+
+    for ( auto& units : busy_cycles)
+        std::fill( units.begin(), units.end(), 0);
 
-    writeback_stage_info.operation_latency = 0_lt;
+    cycles_to_last_writeback = 0_lt;
 }
 
-#endif // DATA_BYPASS_H
\ No newline at end of file
+#endif // DATA_BYPASS_H
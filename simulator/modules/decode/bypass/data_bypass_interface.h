@@ -12,97 +12,84 @@
 #include <infra/ports/timing.h>
 #include <infra/types.h>
 
-class RegisterStage
-{
-public:
-    bool operator==(const RegisterStage& rhs) const noexcept { return is_same_stage( rhs.value); }
+#include <string>
 
-    void inc() noexcept { value = value + 1_lt; }
+// Stage 0 of ALU is the execute stage, the next ones are late ALU stages
+inline std::string get_alu_stage_name( uint32 stage)
+{
+    if ( stage == 0)
+        return "EXECUTE";
 
-    static constexpr const size_t BYPASSING_STAGES_NUMBER = 6;
+    std::string name = "LATE_ALU_";
+    name += std::to_string( stage);
+    return name;
+}
 
-    void set_to_stage( Latency v) noexcept { value = v; }
-    void set_to_first_execution_stage() noexcept
-    {
-        set_to_stage( 0_lt);
-        bypass_direction = 0;
-    }
-
-    void set_to_mem_stage() noexcept
-    {
-        set_to_stage( MEM_OR_BRANCH_STAGE);
-        bypass_direction = 2;
-    }
+// Instructions pass ALU stages one by one, the last one passes them to writeback
+inline std::string get_alu_datapath_port_name( uint32 stage, uint32 last_stage)
+{
+    std::string name = get_alu_stage_name( stage);
+    name += "_2_";
+    name += stage == last_stage ? std::string( "WRITEBACK") : get_alu_stage_name( stage + 1);
+    return name;
+}
+
+/*
+ * Ports with bypassed data are numbered by their sources,
+ * the fixed sources are followed by the ALU stages
+ */
+struct BypassSource
+{
+    static constexpr const size_t MEMORY = 0;
+    static constexpr const size_t BRANCH = 1;
+    static constexpr const size_t WRITEBACK = 2;
+    static constexpr const size_t LONG_ARITHMETIC = 3;
 
-    void set_to_writeback() noexcept
-    {
-        set_to_stage( WB_STAGE);
-        bypass_direction = 3;
-    }
+    static size_t alu_stage( Latency stage) noexcept { return LONG_ARITHMETIC + 1 + stage.to_size_t(); }
+    static size_t get_sources_num( uint32 last_alu_stage) noexcept { return alu_stage( Latency( last_alu_stage)) + 1; }
 
-    void set_to_branch_stage() noexcept
+    static std::string get_port_name( size_t source)
     {
-        set_to_stage( MEM_OR_BRANCH_STAGE);
-        bypass_direction = 4;
+        std::string name;
+        switch ( source) {
+        case MEMORY:          name = "MEMORY"; break;
+        case BRANCH:          name = "BRANCH"; break;
+        case WRITEBACK:       name = "WRITEBACK"; break;
+        case LONG_ARITHMETIC: name = "EXECUTE_COMPLEX_ALU"; break;
+        default:              name = get_alu_stage_name( narrow_cast<uint32>( source - alu_stage( 0_lt))); break;
+        }
+        name += "_2_EXECUTE_BYPASS";
+        return name;
     }
-
-    void set_to_in_RF() noexcept
-    {
-        set_to_stage( IN_RF_STAGE);
-    }
-
-    bool is_same_stage( Latency v) const noexcept { return value == v; }
-    bool is_first_execution_stage() const noexcept { return is_same_stage( 0_lt); }
-    bool is_late_alu() const noexcept { return is_same_stage(LATE_ALU_STAGE); }
-    bool is_mem_or_branch_stage() const noexcept { return is_same_stage( MEM_OR_BRANCH_STAGE); }
-    bool is_writeback() const noexcept { return is_same_stage( WB_STAGE); }
-    bool is_in_RF() const noexcept     { return is_same_stage( IN_RF_STAGE); }
-
-    auto get_bypass_direction_value() const noexcept { return bypass_direction; }
-
-private:
-    size_t bypass_direction = 0;
-    Latency value = IN_RF_STAGE;
-
-    // EXECUTE_0  - 0                              | Bypassing stage
-    //  .......
-    // EXECUTE_N  - last_execution_stage_value     | Bypassing stage
-    // MEM        - MAX_VAL8 - 2                   | Bypassing stage
-    // BRANCH     - MAX_VAL8 - 2                   | Bypassing stage
-    // WRITEBACK  - MAX_VAL8 - 1                   | Bypassing stage
-    // IN_RF      - MAX_VAL8
-
-    static constexpr const Latency IN_RF_STAGE  = Latency( MAX_VAL8);
-    static constexpr const Latency LATE_ALU_STAGE         = IN_RF_STAGE - 3_lt;
-    static constexpr const Latency MEM_OR_BRANCH_STAGE    = IN_RF_STAGE - 2_lt;
-    static constexpr const Latency WB_STAGE     = IN_RF_STAGE - 1_lt;
 };
 
-
 template<typename Register>
 class BypassCommand
 {
 public:
-    BypassCommand(RegisterStage bypassing_stage, Latency last_execution_stage) noexcept
-            : bypassing_stage(bypassing_stage)
-            , last_execution_stage(last_execution_stage)
-    { }
+    explicit BypassCommand( size_t source) noexcept : source( source) { }
 
-    // returns an index of the port where bypassed data should be get from
-    size_t get_bypass_direction() const noexcept
-    {
-        if (bypassing_stage.is_same_stage(last_execution_stage))
-            return 1;
-        return bypassing_stage.get_bypass_direction_value();
-    }
+    // the value has been written back after the decode stage,
+    // so it is read from the RF in the execution stage
+    static BypassCommand read_RF() noexcept { return BypassCommand( RF_SOURCE); }
+
+    bool is_RF_read() const noexcept { return source == RF_SOURCE; }
 
-    uint8 get_ready() {return ready;}
-    void set_ready(uint8 value) {ready = value;}
+    // returns an index of the port where bypassed data should be get from
+    size_t get_bypass_direction() const noexcept { return source; }
 
 private:
-    uint8 ready;
-    const RegisterStage bypassing_stage;
-    const Latency last_execution_stage;
+    static constexpr const size_t RF_SOURCE = MAX_VAL8;
+    size_t source;
 };
 
+// Decode sends commands to the ALU stage which executes the instruction
+inline std::string get_bypass_command_port_name( uint32 stage, size_t src_index)
+{
+    std::string name = "DECODE_2_";
+    name += get_alu_stage_name( stage);
+    name += src_index == 0 ? "_SRC1_COMMAND" : "_SRC2_COMMAND";
+    return name;
+}
+
 #endif // DATA_BYPASS_INTERFACE_H
@@ -6,12 +6,12 @@
 #include "decode.h"
 
 #include <modules/execute/execute.h>
-#include <modules/late_alu/late_alu.h>
 
 template <typename FuncInstr>
 Decode<FuncInstr>::Decode( Module* parent) : Module( parent, "decode")
 {
-    bypassing_unit = std::make_unique<BypassingUnit>( config::long_alu_latency);
+    const auto clusters = AluClusters::create_configured();
+    bypassing_unit = std::make_unique<BypassingUnit>( FuncUnitTable::create_configured(), clusters);
 
     rp_datapath = make_read_port<Instr>("FETCH_2_DECODE", Port::LATENCY);
     rp_stall_datapath = make_read_port<Instr>("DECODE_2_DECODE", Port::LATENCY);
@@ -24,14 +24,19 @@ Decode<FuncInstr>::Decode( Module* parent) : Module( parent, "decode")
     wp_datapath = make_write_port<Instr>("DECODE_2_EXECUTE", Port::BW);
     wp_stall_datapath = make_write_port<Instr>("DECODE_2_DECODE", Port::BW);
     wp_stall = make_write_port<bool>("DECODE_2_FETCH_STALL", Port::BW);
-    wps_command[0] = make_write_port<BypassCommand<Register>>("DECODE_2_EXECUTE_SRC1_COMMAND", Port::BW);
-    wps_command[1] = make_write_port<BypassCommand<Register>>("DECODE_2_EXECUTE_SRC2_COMMAND", Port::BW);
-    wps_command_late_alu[0] = make_write_port<BypassCommand<Register>>("DECODE_2_LATE_ALU_SRC1_COMMAND", Port::BW);
-    wps_command_late_alu[1] = make_write_port<BypassCommand<Register>>("DECODE_2_LATE_ALU_SRC2_COMMAND", Port::BW);
+    for ( uint32 stage = 0; stage <= clusters.get_last_stage(); ++stage) {
+        auto& ports = wps_command.emplace_back();
+        for ( size_t i = 0; i < SRC_REGISTERS_NUM; ++i)
+            ports.at( i) = make_write_port<BypassCommand<Register>>( get_bypass_command_port_name( stage, i), Port::BW);
+    }
     wp_bypassing_unit_notify = make_write_port<Instr>("DECODE_2_BYPASSING_UNIT_NOTIFY", Port::BW);
     wp_flush_fetch = make_write_port<bool>("DECODE_2_FETCH_FLUSH", Port::BW);
     wp_flush_target = make_write_port<Target>("DECODE_2_FETCH_TARGET", Port::BW);
     wp_bp_update = make_write_port<BPInterface>("DECODE_2_FETCH", Port::BW);
+
+    num_jumps = make_counter( "jumps", "jumps seen at decode stage");
+    num_mispredictions = make_counter( "mispredictions", "mispredictions detected at decode stage");
+    make_formula( "mispredict_rate", "share of jumps mispredicted at decode stage", make_ratio( num_mispredictions, num_jumps));
 }
 
 template <typename FuncInstr>
@@ -88,6 +93,7 @@ void Decode<FuncInstr>::clock( Cycle cycle)
 
     if ( has_flush || has_trap)
     {
+        cpi_stack->add_frontend_cycle();
         sout << "flush\n";
         return;
     }
@@ -95,19 +101,24 @@ void Decode<FuncInstr>::clock( Cycle cycle)
     /* check if there is something to process */
     if ( !rp_datapath->is_ready( cycle) && !rp_stall_datapath->is_ready( cycle))
     {
+        cpi_stack->add_frontend_cycle();
         sout << "bubble\n";
         return;
     }
 
     auto[instr, from_stall] = read_instr( cycle);
 
+    /* the front-end has delivered the instruction */
+    if ( !from_stall)
+        cpi_stack->set_frontend_stall( CpiStack::NO_PC, CpiComponent::OTHER);
+
     if ( instr.is_jump())
-        num_jumps++;
+        ++*num_jumps;
 
     /* handle misprediction */
     if ( is_misprediction( instr, instr.get_bp_data()))
     {
-        num_mispredictions++;
+        ++*num_mispredictions;
 
         /* acquiring real information for BPU */
         wp_bp_update->write( instr.get_bp_upd(), cycle);
@@ -115,7 +126,10 @@ void Decode<FuncInstr>::clock( Cycle cycle)
         // flushing fetch stage, instr fetch will appear at decode stage next clock,
         // so we send flush signal to decode
         if ( !bypassing_unit->is_stall( instr))
+        {
             wp_flush_fetch->write( true, cycle);
+            cpi_stack->set_frontend_stall( instr.get_PC(), CpiComponent::BRANCH_FLUSH);
+        }
 
         /* sending valid PC to fetch stage */
         if ( !from_stall)
@@ -125,81 +139,21 @@ void Decode<FuncInstr>::clock( Cycle cycle)
         }
     }
 
-    if ( bypassing_unit->get_operation_latency() <= 1_lt)
+    const auto stage = bypassing_unit->get_execution_stage( instr);
+    if ( !stage)
     {
-        const auto& register1 = instr.get_src(0);
-        const auto& register2 = instr.get_src(1);
-
-        bool is_reg1_zero = register1.is_zero();
-        bool is_reg2_zero = register2.is_zero();
-        bool is_register1_register2 = register1 == register2;
-
-        int value_1 = 0;
-        int value_2 = 1;
-        if( (! is_reg1_zero) && (! is_reg2_zero))
-        {
-            set_registers();
-            get_path( value_1, &register_1);
-            get_path( value_2, &register_2);
-            auto wps_port = wps_command;
-            if ( is_register_1 || is_register_2) {
-                if ( is_register_1) {
-                    alu_number_decoder = register_1.value_alu;
-                    instr.set_alu_number( register_1.value_alu);
-                } else {
-                    alu_number_decoder = register_2.value_alu;
-                    instr.set_alu_number( register_2.value_alu);
-                }
-                auto c_1 = bypassing_unit->get_bypass_command( instr, value_1, register_1.path_number);
-                wps_port.at( value_1)->write( c_1, cycle);
-                auto c_2 = bypassing_unit->get_bypass_command( instr, value_2, register_2.path_number);
-                wps_port.at( value_2)->write( c_2, cycle);
-            }
-
-            else if ( !( is_register1_register2))
-            {
-                if ( register_1.instruction > 1) {
-                    alu_number_decoder = register_1.value_alu;
-                    instr.set_alu_number( register_1.value_alu);
-                    rf->read_source( &instr, value_1);
-
-                } else if ( register_2.instruction > 1) {
-                    alu_number_decoder = register_2.value_alu;
-                    instr.set_alu_number( register_2.value_alu);
-                    rf->read_source( &instr, value_2);
-                }
-                auto c_1 = bypassing_unit->get_bypass_command( instr, value_1, register_1.path_number);
-                wps_port.at( value_1)->write( c_1, cycle);
-                auto c_2 = bypassing_unit->get_bypass_command( instr, value_2, register_2.path_number);
-                wps_port.at( value_2)->write( c_2, cycle);
-
-            }
-            else if ((is_register1_register2)) {
-                auto c_1 = bypassing_unit->get_bypass_command( instr, value_1, register_2.path_number);
-                wps_port.at( value_1)->write( c_1, cycle);
-                auto c_2 = bypassing_unit->get_bypass_command( instr, value_2, register_2.path_number);
-                wps_port.at( value_2)->write( c_2, cycle);
-            }
-        }
-        else
-        {
-           if (! is_register_1)
-                rf->read_source(&instr, 0);
-            if (! is_register_2)
-                rf->read_source(&instr, 1);
-            alu_number_decoder = 0;
-            instr.set_alu_number(alu_number_decoder);
-        }
-    }
-    else
-    {
-        // data hazard, stalling pipeline
+        // data or structural hazard, stalling pipeline
         wp_stall->write( true, cycle);
         wp_stall_datapath->write( instr, cycle);
+        cpi_stack->add_instr_cycle( instr.get_PC(), instr.get_sequence_id(), bypassing_unit->get_stall_cause( instr));
         sout << instr << " (data hazard)\n";
         return;
     }
 
+    cpi_stack->add_instr_cycle( instr.get_PC(), instr.get_sequence_id(), CpiComponent::BASE);
+    instr.set_execution_stage( *stage);
+    read_sources( &instr, *stage, cycle);
+
     /* notify bypassing unit about new instruction */
     wp_bypassing_unit_notify->write( instr, cycle);
 
@@ -210,73 +164,20 @@ void Decode<FuncInstr>::clock( Cycle cycle)
 }
 
 
+// Sources in the RF are read now, others are bypassed to the ALU stage
 template <typename FuncInstr>
-void Decode<FuncInstr>::get_path(uint8 reg, struct registers * r)
+void Decode<FuncInstr>::read_sources( Instr* instr, uint32 stage, Cycle cycle)
 {
-    if ( decode_to_execute.registers[reg])
-    {
-        r->value_alu = 1;
-        r->path_number = 1;
-        r->instruction = 2;
-    }
-    else if ( decode_to_execute.registers[reg] && decode_to_execute.alu_number == 0)
+    for ( size_t i = 0; i < SRC_REGISTERS_NUM; ++i)
     {
-        r->value_alu = 0;
-        r->path_number = 1;
-        r->instruction = 1;
-    }
-    else if ( decode_to_execute.registers[reg] && decode_to_execute.alu_number == 1)
-    {
-        r->value_alu = 1;
-        r->path_number = 5;
-        r->instruction = 2;
-    }
-    else if ( execute_to_mem.registers[reg])
-    {
-        r->value_alu = 0;
-        r->path_number = 2;
-        r->instruction = 1;
-    }
-    else if ( execute_to_late_alu.registers[reg])
-    {
-        r->value_alu = 0;
-        r->path_number = 5;
-        r->instruction = 1;
-    }
-    else if ( late_alu_to_writeback.registers[reg] || mem_to_writeback.registers[reg] )
-    {
-        r->value_alu = 0;
-        r->path_number = 3;
-        r->instruction = 1;
-    }
-    else
-    {
-        r->path_number = -1;
+        if ( bypassing_unit->is_in_RF( *instr, i))
+            rf->read_source( instr, i);
+        else
+            wps_command.at( stage).at( i)->write( bypassing_unit->get_bypass_command( *instr, i, stage), cycle);
     }
 }
 
 
-template <typename FuncInstr>
-void Decode<FuncInstr>::set_registers()
-{
-    int value_1 = 0;
-    int value_2 = 1;
-
-    is_register_1 = false;
-    if( decode_to_execute.registers[value_1]
-       || execute_to_late_alu.registers[value_1] || execute_to_mem.registers[value_1]
-       || late_alu_to_writeback.registers[value_1] || mem_to_writeback.registers[value_1] )
-        is_register_1 = true;
-
-    is_register_2 = false;
-    if( decode_to_execute.registers[value_2]
-       || execute_to_late_alu.registers[value_2] || execute_to_mem.registers[value_2]
-       || late_alu_to_writeback.registers[value_2] || mem_to_writeback.registers[value_2])
-        is_register_2 = true;
-}
-
-
-
 #include <mips/mips.h>
 #include <risc_v/risc_v.h>
 
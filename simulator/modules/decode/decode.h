@@ -13,6 +13,8 @@
 #include <modules/core/perf_instr.h>
 #include <modules/ports_instance.h>
 
+#include <vector>
+
 template <typename FuncInstr>
 class Decode : public Module
 {
@@ -26,20 +28,19 @@ public:
     void clock( Cycle cycle);
     void set_RF( RF<FuncInstr>* value) { rf = value;}
     void set_wb_bandwidth( uint32 wb_bandwidth) { bypassing_unit->set_bandwidth( wb_bandwidth);}
-    auto get_mispredictions_num() const { return num_mispredictions; }
-    auto get_jumps_num() const { return num_jumps; }
+    void set_cpi_stack( CpiStack* value) { cpi_stack = value; }
+    auto get_mispredictions_num() const { return num_mispredictions->get(); }
+    auto get_jumps_num() const { return num_jumps->get(); }
 
 private:
     auto read_instr( Cycle cycle) const;
     bool is_flush( Cycle cycle) const;
-    bool is_register_1 = false;
-    bool is_register_2 = false;
     static bool is_misprediction( const Instr& instr, const BPInterface& bp_data);
 
-    uint64 num_jumps          = 0;
-    uint64 num_mispredictions = 0;
-    int alu_number_decoder   = 0;
+    Counter* num_jumps          = nullptr;
+    Counter* num_mispredictions = nullptr;
     RF<FuncInstr>* rf = nullptr;
+    CpiStack* cpi_stack = nullptr;
     std::unique_ptr<BypassingUnit> bypassing_unit = nullptr;
 
     /* Inputs */
@@ -57,26 +58,12 @@ private:
     WritePort<bool>* wp_stall = nullptr;
     WritePort<Instr>* wp_bypassing_unit_notify = nullptr;
     WritePort<BPInterface>* wp_bp_update = nullptr;
-    std::array<WritePort<BypassCommand<Register>>*, SRC_REGISTERS_NUM> wps_command;
-    std::array<WritePort<BypassCommand<Register>>*, SRC_REGISTERS_NUM> wps_command_late_alu;
+    // commands for each ALU stage
+    std::vector<std::array<WritePort<BypassCommand<Register>>*, SRC_REGISTERS_NUM>> wps_command;
     WritePort<bool>* wp_flush_fetch = nullptr;
     WritePort<Target>* wp_flush_target = nullptr;
 
-    struct registers
-    {
-        int8 path_number = 0;
-        uint8 value_alu = 0;
-        uint8 instruction = 0;
-    } register_1, register_2;
-
-    struct path
-
-        bool registers[2] = {false, false};
-        uint8 alu_number = 0;
-    } decode_to_execute, execute_to_late_alu, execute_to_mem, late_alu_to_writeback, mem_to_writeback;
-
-    void get_path(uint8 reg, struct registers * r);
-    void set_registers();
+    void read_sources( Instr* instr, uint32 stage, Cycle cycle);
 };
 
 
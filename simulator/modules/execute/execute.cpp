@@ -7,49 +7,42 @@
 
 #include "execute.h"
 
-namespace config {
-    const PredicatedValue<uint64> long_alu_latency = { "long-alu-latency", 3, "Latency of long arithmetic logic unit",
-                                                       [](uint64 val) { return val >= 2 && val < 64; } };
-} // namespace config
+#include <algorithm>
 
 template <typename FuncInstr>
 Execute<FuncInstr>::Execute( Module* parent) : Module( parent, "execute")
-    , last_execution_stage_latency( Latency( config::long_alu_latency - 1))
+    , func_units( FuncUnitTable::create_configured())
+    , last_alu_stage( AluClusters::create_configured().get_last_stage())
+    , last_execution_stage_latency( func_units.get_long_latencies().back() - 1_lt)
 {
     wp_mem_datapath = make_write_port<Instr>("EXECUTE_2_MEMORY" , Port::BW );
     wp_branch_datapath = make_write_port<Instr>("EXECUTE_2_BRANCH" , Port::BW );
-    wp_writeback_datapath = make_write_port<Instr>("EXECUTE_2_LATE_ALU", Port::BW );
+    wp_alu_datapath = make_write_port<Instr>( get_alu_datapath_port_name( 0, last_alu_stage), Port::BW);
     rp_datapath = make_read_port<Instr>("DECODE_2_EXECUTE", Port::LATENCY);
     rp_trap = make_read_port<bool>("WRITEBACK_2_ALL_FLUSH", Port::LATENCY);
 
-    wp_long_latency_execution_unit = make_write_port<Instr>("EXECUTE_2_EXECUTE_LONG_LATENCY", Port::BW);
-    rp_long_latency_execution_unit = make_read_port<Instr>("EXECUTE_2_EXECUTE_LONG_LATENCY", last_execution_stage_latency);
+    for ( const auto latency : func_units.get_long_latencies()) {
+        std::string name = "EXECUTE_2_EXECUTE_LONG_LATENCY_";
+        name += latency.to_string();
+        long_latency_units.push_back( LongLatencyPorts{ latency,
+                                                        make_write_port<Instr>( name, Port::BW),
+                                                        make_read_port<Instr>( name, latency - 1_lt)});
+    }
 
     rp_flush = make_read_port<bool>("BRANCH_2_ALL_FLUSH", Port::LATENCY);
 
-    rps_bypass[0].command_port = make_read_port<BypassCommand<Register>>("DECODE_2_EXECUTE_SRC1_COMMAND", Port::LATENCY);
-    rps_bypass[1].command_port = make_read_port<BypassCommand<Register>>("DECODE_2_EXECUTE_SRC2_COMMAND", Port::LATENCY);
-
-    wp_bypass = make_write_port<InstructionOutput>("EXECUTE_2_EXECUTE_BYPASS", Port::BW);
-    wp_long_arithmetic_bypass = make_write_port<InstructionOutput>("EXECUTE_COMPLEX_ALU_2_EXECUTE_BYPASS", Port::BW);
-
-    rps_bypass[0].data_ports[0] = make_read_port<InstructionOutput>("EXECUTE_2_EXECUTE_BYPASS", Port::LATENCY);
-    rps_bypass[1].data_ports[0] = make_read_port<InstructionOutput>("EXECUTE_2_EXECUTE_BYPASS", Port::LATENCY);
-
-    rps_bypass[0].data_ports[1] = make_read_port<InstructionOutput>("EXECUTE_COMPLEX_ALU_2_EXECUTE_BYPASS", Port::LATENCY);
-    rps_bypass[1].data_ports[1] = make_read_port<InstructionOutput>("EXECUTE_COMPLEX_ALU_2_EXECUTE_BYPASS", Port::LATENCY);
+    wp_bypass = make_write_port<InstructionOutput>( BypassSource::get_port_name( BypassSource::alu_stage( 0_lt)), Port::BW);
+    wp_long_arithmetic_bypass = make_write_port<InstructionOutput>( BypassSource::get_port_name( BypassSource::LONG_ARITHMETIC), Port::BW);
 
-    rps_bypass[0].data_ports[2] = make_read_port<InstructionOutput>("MEMORY_2_EXECUTE_BYPASS", Port::LATENCY);
-    rps_bypass[1].data_ports[2] = make_read_port<InstructionOutput>("MEMORY_2_EXECUTE_BYPASS", Port::LATENCY);
-
-    rps_bypass[0].data_ports[3] = make_read_port<InstructionOutput>("WRITEBACK_2_EXECUTE_BYPASS", Port::LATENCY);
-    rps_bypass[1].data_ports[3] = make_read_port<InstructionOutput>("WRITEBACK_2_EXECUTE_BYPASS", Port::LATENCY);
-
-    rps_bypass[0].data_ports[4] = make_read_port<InstructionOutput>("BRANCH_2_EXECUTE_BYPASS", Port::LATENCY);
-    rps_bypass[1].data_ports[4] = make_read_port<InstructionOutput>("BRANCH_2_EXECUTE_BYPASS", Port::LATENCY);
+    for ( size_t i = 0; i < SRC_REGISTERS_NUM; ++i) {
+        rps_bypass.at( i).command_port = make_read_port<BypassCommand<Register>>( get_bypass_command_port_name( 0, i), Port::LATENCY);
+        for ( size_t source = 0; source < BypassSource::get_sources_num( last_alu_stage); ++source)
+            rps_bypass.at( i).data_ports.push_back( make_read_port<InstructionOutput>( BypassSource::get_port_name( source), Port::LATENCY));
+    }
 
-    rps_bypass[0].data_ports[5] = make_read_port<InstructionOutput>("LATE_ALU_2_EXECUTE_BYPASS", Port::LATENCY);
-    rps_bypass[1].data_ports[5] = make_read_port<InstructionOutput>("LATE_ALU_2_EXECUTE_BYPASS", Port::LATENCY);
+    num_executed = make_counter( "instrs", "instructions executed in the execute stage");
+    num_long_arithmetic = make_counter( "long_arithmetic", "multiplications and divisions");
+    num_to_late_alu = make_counter( "to_late_alu", "instructions passed to late ALU clusters");
 }
 
 template <typename FuncInstr>
@@ -71,17 +64,7 @@ void Execute<FuncInstr>::clock( Cycle cycle)
         return;
     }
 
-    /* get the instruction from long ALU if it is ready */
-    if ( rp_long_latency_execution_unit->is_ready( cycle))
-    {
-        auto instr = rp_long_latency_execution_unit->read( cycle);
-
-        if ( has_flush_expired())
-        {
-            wp_long_arithmetic_bypass->write( instr.get_v_dst(), cycle);
-            wp_writeback_datapath->write( instr, cycle);
-        }
-    }
+    write_long_latency_result( cycle);
 
     /* check if there is something to process */
     if ( !rp_datapath->is_ready( cycle))
@@ -92,57 +75,90 @@ void Execute<FuncInstr>::clock( Cycle cycle)
 
     auto instr = rp_datapath->read( cycle);
 
-    auto src_index = 0;
-    for ( auto& bypass_source : rps_bypass)
+    /* instruction is executed by a late ALU cluster */
+    if ( instr.get_execution_stage() != 0)
     {
-        /* check whether bypassing is needed for a source register */
-        if ( bypass_source.command_port->is_ready( cycle))
-        {
-            const auto bypass_direction = bypass_source.command_port->read( cycle).get_bypass_direction();
-            auto& port = bypass_source.data_ports.at( bypass_direction);
-            RegisterUInt data{};
-            while ( port->is_ready( cycle))
-                data = port->read( cycle)[0];
-            instr.set_v_src( data, src_index);
-        }
-        ++src_index;
+        sout << instr << " (to late ALU)" << std::endl;
+        ++*num_to_late_alu;
+        wp_alu_datapath->write( std::move( instr), cycle);
+        return;
     }
 
+    read_sources( &instr, cycle);
+
     /* perform execution */
     instr.execute();
+    ++*num_executed;
 
     /* log */
     sout << instr << std::endl;
 
     if ( instr.is_long_arithmetic())
     {
-        wp_long_latency_execution_unit->write( std::move( instr), cycle);
-    }
-    else if (instr.get_alu_number() == 1)
-    {
-        wp_writeback_datapath->write(std::move(instr), cycle);
+        ++*num_long_arithmetic;
+        start_long_latency_operation( std::move( instr), cycle);
         return;
     }
+
+    /* bypass data */
+    wp_bypass->write( instr.get_v_dst(), cycle);
+
+    if( instr.is_jump())
+        wp_branch_datapath->write( std::move( instr), cycle);
+    else if( instr.is_mem_stage_required())
+        wp_mem_datapath->write( std::move( instr), cycle);
     else
-    {
-        /* bypass data */
-        wp_bypass->write( instr.get_v_dst(), cycle);
+        wp_alu_datapath->write( std::move( instr), cycle);
+}
 
-        if( instr.is_jump())
-        {
-            wp_branch_datapath->write( std::move( instr) ,cycle);
-        }
-        else if( instr.is_mem_stage_required())
+template <typename FuncInstr>
+void Execute<FuncInstr>::read_sources( Instr* instr, Cycle cycle)
+{
+    auto src_index = 0;
+    for ( auto& bypass_source : rps_bypass)
+    {
+        /* check whether bypassing is needed for a source register */
+        if ( bypass_source.command_port->is_ready( cycle))
         {
-            wp_mem_datapath->write( std::move( instr) ,cycle);
+            const auto bypass_direction = bypass_source.command_port->read( cycle).get_bypass_direction();
+            auto& port = bypass_source.data_ports.at( bypass_direction);
+            RegisterUInt data{};
+            while ( port->is_ready( cycle))
+                data = port->read( cycle)[0];
+            instr->set_v_src( data, src_index);
         }
-        else
+        ++src_index;
+    }
+}
+
+/* get the instruction from long ALU if it is ready, decode stage prevents conflicts in ALU stages */
+template <typename FuncInstr>
+void Execute<FuncInstr>::write_long_latency_result( Cycle cycle)
+{
+    for ( auto& unit : long_latency_units)
+    {
+        if ( !unit.rp->is_ready( cycle))
+            continue;
+
+        auto instr = unit.rp->read( cycle);
+        if ( has_flush_expired())
         {
-            wp_writeback_datapath->write(std::move(instr), cycle);
+            wp_long_arithmetic_bypass->write( instr.get_v_dst(), cycle);
+            wp_alu_datapath->write( std::move( instr), cycle);
         }
     }
 }
 
+template <typename FuncInstr>
+void Execute<FuncInstr>::start_long_latency_operation( Instr&& instr, Cycle cycle)
+{
+    const auto latency = func_units.get_timing( instr).latency;
+    auto unit = std::find_if( long_latency_units.begin(), long_latency_units.end(),
+                              [latency]( const auto& u) { return u.latency == latency; });
+    assert( unit != long_latency_units.end());
+    unit->wp->write( std::move( instr), cycle);
+}
+
 
 #include <mips/mips.h>
 #include <risc_v/risc_v.h>
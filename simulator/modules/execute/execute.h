@@ -10,11 +10,10 @@
 #include <infra/config/config.h>
 #include <modules/core/perf_instr.h>
 #include <modules/decode/bypass/data_bypass_interface.h>
+#include <modules/execute/func_units.h>
 #include <modules/ports_instance.h>
 
-namespace config {
-    extern const PredicatedValue<uint64> long_alu_latency;
-} // namespace config
+#include <vector>
 
 template <typename FuncInstr>
 class Execute : public Module
@@ -26,30 +25,42 @@ class Execute : public Module
 
     private:
         static constexpr const uint8 SRC_REGISTERS_NUM = 2;
+        const FuncUnitTable func_units;
+        const uint32 last_alu_stage;
         const Latency last_execution_stage_latency;
 
+        // Long operations of the same latency share a pipelined port
+        struct LongLatencyPorts {
+            Latency latency;
+            WritePort<Instr>* wp;
+            ReadPort<Instr>* rp;
+        };
+        std::vector<LongLatencyPorts> long_latency_units;
+
         /* Inputs */
         ReadPort<Instr>* rp_datapath = nullptr;
-        ReadPort<Instr>* rp_long_latency_execution_unit = nullptr;
         ReadPort<bool>* rp_flush = nullptr;
         ReadPort<bool>* rp_trap = nullptr;
 
         struct BypassPorts {
             ReadPort<BypassCommand<Register>>* command_port;
-            std::array<ReadPort<InstructionOutput>*, RegisterStage::BYPASSING_STAGES_NUMBER> data_ports;
+            std::vector<ReadPort<InstructionOutput>*> data_ports;
         };
         std::array<BypassPorts, SRC_REGISTERS_NUM> rps_bypass;
 
         /* Outputs */
         WritePort<Instr>* wp_mem_datapath = nullptr;
         WritePort<Instr>* wp_branch_datapath = nullptr;
-        WritePort<Instr>* wp_writeback_datapath = nullptr;
-        WritePort<Instr>* wp_long_latency_execution_unit = nullptr;
+        WritePort<Instr>* wp_alu_datapath = nullptr;
         WritePort<InstructionOutput>* wp_bypass = nullptr;
         WritePort<InstructionOutput>* wp_long_arithmetic_bypass = nullptr;
 
         Latency flush_expiration_latency = 0_lt;
 
+        Counter* num_executed = nullptr;
+        Counter* num_long_arithmetic = nullptr;
+        Counter* num_to_late_alu = nullptr;
+
         void save_flush() { flush_expiration_latency = last_execution_stage_latency; }
         void clock_saved_flush()
         {
@@ -58,6 +69,10 @@ class Execute : public Module
         }
         auto has_flush_expired() const { return flush_expiration_latency == 0_lt; }
 
+        void read_sources( Instr* instr, Cycle cycle);
+        void write_long_latency_result( Cycle cycle);
+        void start_long_latency_operation( Instr&& instr, Cycle cycle);
+
     public:
         explicit Execute( Module* parent);
         void clock( Cycle cycle);
@@ -0,0 +1,189 @@
+/**
+ * func_units.cpp - latencies and numbers of functional units
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "func_units.h"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace config {
+    const PredicatedValue<uint64> long_alu_latency = { "long-alu-latency", 3, "Latency of long arithmetic logic unit",
+                                                       [](uint64 val) { return val >= 2 && val < FuncUnitTable::MAX_LATENCY; } };
+    static const Value<std::string> func_units = { "func-units", "", "JSON file with latencies, initiation intervals and numbers of functional units"};
+    static const Value<std::string> alu_clusters = { "alu-clusters", "0,1", "Comma-separated pipeline stages of ALU clusters, 0 is the execute stage"};
+} // namespace config
+
+static const std::array<std::string_view, FUNC_UNIT_CLASSES_NUM> unit_names = {
+    "alu", "multiplier", "divider", "load_store", "branch"
+};
+
+static bool is_long_unit( FuncUnitClass unit_class) noexcept
+{
+    return unit_class == FuncUnitClass::MULTIPLIER || unit_class == FuncUnitClass::DIVIDER;
+}
+
+FuncUnitClass get_func_unit_class( const Operation& op) noexcept
+{
+    if ( op.is_load() || op.is_store())
+        return FuncUnitClass::LOAD_STORE;
+
+    if ( op.is_jump())
+        return FuncUnitClass::BRANCH;
+
+    // RISC-V multiplications and divisions are plain arithmetic operations
+    const auto name = op.get_opname();
+    if ( name.starts_with( "div") || name.starts_with( "ddiv") || name.starts_with( "rem"))
+        return FuncUnitClass::DIVIDER;
+
+    if ( op.is_divmult() || name.starts_with( "mul") || name.starts_with( "dmul"))
+        return FuncUnitClass::MULTIPLIER;
+
+    return FuncUnitClass::ALU;
+}
+
+FuncUnitTable::FuncUnitTable( uint64 long_latency)
+{
+    const auto latency = Latency( narrow_cast<int64>( long_latency));
+    units[ static_cast<size_t>( FuncUnitClass::ALU)] = Unit{ FuncUnitTiming{ 1_lt, 1}, 1};
+    units[ static_cast<size_t>( FuncUnitClass::MULTIPLIER)] = Unit{ FuncUnitTiming{ latency, 1}, 1};
+    // dividers are not pipelined
+    units[ static_cast<size_t>( FuncUnitClass::DIVIDER)] = Unit{ FuncUnitTiming{ latency, narrow_cast<uint32>( long_latency)}, 1};
+    units[ static_cast<size_t>( FuncUnitClass::LOAD_STORE)] = Unit{ FuncUnitTiming{ 2_lt, 1}, 1};
+    units[ static_cast<size_t>( FuncUnitClass::BRANCH)] = Unit{ FuncUnitTiming{ 2_lt, 1}, 1};
+}
+
+FuncUnitTable FuncUnitTable::create_configured()
+{
+    FuncUnitTable table( config::long_alu_latency);
+    const std::string& filename = config::func_units;
+    if ( !filename.empty()) {
+        std::ifstream in( filename);
+        if ( !in)
+            throw InvalidFuncUnitConfig( "cannot open " + filename);
+        table.load( in);
+    }
+    return table;
+}
+
+// Zero values are for the values which are not specified
+static FuncUnitTiming read_timing( const std::string& name, const boost::property_tree::ptree& tree)
+{
+    FuncUnitTiming result{ 0_lt, 0};
+    if ( const auto latency = tree.get_optional<uint64>( "latency")) {
+        if ( *latency < 2 || *latency >= FuncUnitTable::MAX_LATENCY)
+            throw InvalidFuncUnitConfig( "latency of " + name + " must be in range [2, "
+                                         + std::to_string( FuncUnitTable::MAX_LATENCY) + ")");
+        result.latency = Latency( narrow_cast<int64>( *latency));
+    }
+
+    if ( const auto interval = tree.get_optional<uint32>( "interval")) {
+        if ( *interval == 0)
+            throw InvalidFuncUnitConfig( "initiation interval of " + name + " is zero");
+        result.initiation_interval = *interval;
+    }
+    return result;
+}
+
+void FuncUnitTable::load( std::istream& in)
+{
+    boost::property_tree::ptree tree;
+    try {
+        read_json( in, tree);
+    }
+    catch ( const boost::property_tree::json_parser_error& e) {
+        throw InvalidFuncUnitConfig( e.what());
+    }
+
+    if ( const auto config_units = tree.get_child_optional( "units")) {
+        for ( const auto& [name, config_unit] : *config_units) {
+            const auto it = std::find( unit_names.begin(), unit_names.end(), name);
+            if ( it == unit_names.end())
+                throw InvalidFuncUnitConfig( "unknown unit " + name);
+
+            const auto unit_class = static_cast<FuncUnitClass>( it - unit_names.begin());
+            auto& unit = units.at( static_cast<size_t>( unit_class));
+            const auto timing = read_timing( name, config_unit);
+            if ( timing.latency != 0_lt) {
+                if ( !is_long_unit( unit_class))
+                    throw InvalidFuncUnitConfig( "latency of " + name + " is defined by the pipeline");
+                unit.timing.latency = timing.latency;
+            }
+            if ( timing.initiation_interval != 0)
+                unit.timing.initiation_interval = timing.initiation_interval;
+
+            unit.count = config_unit.get<uint32>( "count", unit.count);
+            if ( unit.count == 0)
+                throw InvalidFuncUnitConfig( "no units of " + name);
+        }
+    }
+
+    if ( const auto config_operations = tree.get_child_optional( "operations"))
+        for ( const auto& [name, config_operation] : *config_operations)
+            operations[ name] = read_timing( name, config_operation);
+}
+
+FuncUnitTiming FuncUnitTable::get_timing( const Operation& op) const noexcept
+{
+    const auto unit_class = get_func_unit_class( op);
+    auto result = get_timing( unit_class);
+    if ( !is_long_unit( unit_class) || operations.empty())
+        return result;
+
+    const auto it = operations.find( op.get_opname());
+    if ( it == operations.end())
+        return result;
+
+    if ( it->second.latency != 0_lt)
+        result.latency = it->second.latency;
+    if ( it->second.initiation_interval != 0)
+        result.initiation_interval = it->second.initiation_interval;
+    return result;
+}
+
+std::vector<Latency> FuncUnitTable::get_long_latencies() const
+{
+    std::vector<Latency> result = { get_timing( FuncUnitClass::MULTIPLIER).latency, get_timing( FuncUnitClass::DIVIDER).latency };
+    for ( const auto& operation : operations)
+        if ( operation.second.latency != 0_lt)
+            result.push_back( operation.second.latency);
+
+    std::sort( result.begin(), result.end());
+    result.erase( std::unique( result.begin(), result.end()), result.end());
+    return result;
+}
+
+AluClusters::AluClusters( std::vector<uint32> stages) : stages( std::move( stages))
+{
+    if ( this->stages.empty())
+        throw InvalidFuncUnitConfig( "no ALU clusters");
+
+    std::sort( this->stages.begin(), this->stages.end());
+    if ( get_last_stage() > MAX_STAGE)
+        throw InvalidFuncUnitConfig( "ALU cluster stage " + std::to_string( get_last_stage())
+                                     + " is greater than " + std::to_string( MAX_STAGE));
+
+    const auto duplicate = std::adjacent_find( this->stages.begin(), this->stages.end());
+    if ( duplicate != this->stages.end())
+        throw InvalidFuncUnitConfig( "ALU cluster stage " + std::to_string( *duplicate) + " is listed twice");
+}
+
+AluClusters AluClusters::create_configured()
+{
+    const std::string& value = config::alu_clusters;
+    std::vector<uint32> stages;
+    std::istringstream in( value);
+    for ( std::string item; std::getline( in, item, ','); ) try {
+        stages.push_back( narrow_cast<uint32>( std::stoul( item)));
+    }
+    catch ( const std::logic_error&) {
+        throw InvalidFuncUnitConfig( value + " is not a comma-separated list of ALU cluster stages");
+    }
+
+    return AluClusters( std::move( stages));
+}
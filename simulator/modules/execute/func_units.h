@@ -0,0 +1,120 @@
+/**
+ * func_units.h - latencies and numbers of functional units
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef FUNC_UNITS_H
+#define FUNC_UNITS_H
+
+#include <func_sim/operation.h>
+#include <infra/config/config.h>
+#include <infra/exception.h>
+#include <infra/ports/timing.h>
+
+#include <array>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace config {
+    extern const PredicatedValue<uint64> long_alu_latency;
+} // namespace config
+
+struct InvalidFuncUnitConfig final : Exception
+{
+    explicit InvalidFuncUnitConfig( const std::string& msg)
+        : Exception( "Invalid functional units configuration", msg)
+    { }
+};
+
+enum class FuncUnitClass : uint8
+{
+    ALU, MULTIPLIER, DIVIDER, LOAD_STORE, BRANCH
+};
+
+static constexpr const size_t FUNC_UNIT_CLASSES_NUM = 5;
+
+FuncUnitClass get_func_unit_class( const Operation& op) noexcept;
+
+struct FuncUnitTiming
+{
+    Latency latency = 1_lt;
+    uint32 initiation_interval = 1; // cycles before the unit accepts the next operation
+};
+
+/*
+ * Latencies of ALU, load/store and branch operations are defined
+ * by the pipeline stages, so only multiplier and divider operations
+ * may be configured with their own latencies.
+ *
+ * The configuration is a JSON file like:
+ * {
+ *     "units": {
+ *         "multiplier": { "latency": 3, "interval": 1, "count": 1 },
+ *         "divider": { "latency": 20, "interval": 20, "count": 1 }
+ *     },
+ *     "operations": {
+ *         "divu": { "latency": 18, "interval": 18 }
+ *     }
+ * }
+ */
+class FuncUnitTable
+{
+public:
+    explicit FuncUnitTable( uint64 long_latency);
+    static FuncUnitTable create_configured();
+
+    void load( std::istream& in);
+
+    FuncUnitTiming get_timing( const Operation& op) const noexcept;
+    FuncUnitTiming get_timing( FuncUnitClass unit_class) const noexcept { return get_unit( unit_class).timing; }
+    uint32 get_count( FuncUnitClass unit_class) const noexcept { return get_unit( unit_class).count; }
+
+    // Different latencies of multiplier and divider operations
+    std::vector<Latency> get_long_latencies() const;
+
+    static constexpr const uint64 MAX_LATENCY = 64;
+
+private:
+    struct Unit
+    {
+        FuncUnitTiming timing;
+        uint32 count = 1;
+    };
+
+    // classes are enumerated from 0 to FUNC_UNIT_CLASSES_NUM - 1
+    const Unit& get_unit( FuncUnitClass unit_class) const noexcept
+    {
+        return units[ static_cast<size_t>( unit_class)];
+    }
+
+    std::array<Unit, FUNC_UNIT_CLASSES_NUM> units;
+    std::map<std::string, FuncUnitTiming, std::less<>> operations;
+};
+
+/*
+ * ALU clusters execute simple arithmetic in different pipeline stages:
+ * stage 0 is the execute stage, the next ones are late ALU stages.
+ * An instruction is steered to the earliest cluster whose sources
+ * are ready, so late clusters hide latency of loads and long arithmetic.
+ * Results of all clusters pass the ALU stages up to the last one.
+ */
+class AluClusters
+{
+public:
+    explicit AluClusters( std::vector<uint32> stages);
+    static AluClusters create_configured();
+
+    // Different stages of clusters in ascending order
+    const std::vector<uint32>& get_stages() const noexcept { return stages; }
+    uint32 get_last_stage() const noexcept { return stages.back(); }
+
+    static constexpr const uint32 MAX_STAGE = 7;
+
+private:
+    std::vector<uint32> stages;
+};
+
+#endif // FUNC_UNITS_H
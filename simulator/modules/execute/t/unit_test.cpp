@@ -0,0 +1,230 @@
+/**
+ * Functional units unit tests
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include <catch.hpp>
+#include <mips/mips.h>
+#include <modules/decode/bypass/data_bypass.h>
+#include <modules/execute/func_units.h>
+#include <risc_v/risc_v.h>
+
+#include <sstream>
+
+using MIPSInstr = BaseMIPSInstr<uint32>;
+
+static auto mips_instr( std::string_view name)
+{
+    return PerfInstr<MIPSInstr>( MIPSInstr( MIPSVersion::v32, name, std::endian::little, 0, 0xc000), BPInterface());
+}
+
+static auto mips_instr( uint32 bytes)
+{
+    return PerfInstr<MIPSInstr>( MIPSInstr( MIPSVersion::v32, std::endian::little, bytes, 0xc000), BPInterface());
+}
+
+static auto riscv_instr( std::string_view name)
+{
+    return PerfInstr<RISCVInstr<uint32>>( RISCVInstr<uint32>( name, 0), BPInterface());
+}
+
+TEST_CASE( "FuncUnits: classes of operations")
+{
+    CHECK( mips_instr( "add").get_func_unit_class() == FuncUnitClass::ALU);
+    CHECK( mips_instr( "mult").get_func_unit_class() == FuncUnitClass::MULTIPLIER);
+    CHECK( mips_instr( "madd").get_func_unit_class() == FuncUnitClass::MULTIPLIER);
+    CHECK( mips_instr( "divu").get_func_unit_class() == FuncUnitClass::DIVIDER);
+    CHECK( mips_instr( "lw").get_func_unit_class() == FuncUnitClass::LOAD_STORE);
+    CHECK( mips_instr( "sw").get_func_unit_class() == FuncUnitClass::LOAD_STORE);
+    CHECK( mips_instr( "beq").get_func_unit_class() == FuncUnitClass::BRANCH);
+    CHECK( riscv_instr( "mulh").get_func_unit_class() == FuncUnitClass::MULTIPLIER);
+    CHECK( riscv_instr( "rem").get_func_unit_class() == FuncUnitClass::DIVIDER);
+    CHECK( riscv_instr( "mul").is_long_arithmetic());
+    CHECK( !riscv_instr( "add").is_long_arithmetic());
+}
+
+TEST_CASE( "FuncUnits: default table")
+{
+    FuncUnitTable table( 5);
+    CHECK( table.get_timing( mips_instr( "add")).latency == 1_lt);
+    CHECK( table.get_timing( mips_instr( "mult")).latency == 5_lt);
+    CHECK( table.get_timing( mips_instr( "mult")).initiation_interval == 1);
+    CHECK( table.get_timing( mips_instr( "div")).latency == 5_lt);
+    CHECK( table.get_timing( mips_instr( "div")).initiation_interval == 5);
+    CHECK( table.get_count( FuncUnitClass::DIVIDER) == 1);
+    CHECK( table.get_long_latencies() == std::vector<Latency>{ 5_lt});
+}
+
+TEST_CASE( "FuncUnits: load table")
+{
+    FuncUnitTable table( 3);
+    std::istringstream config( R"({
+        "units": {
+            "multiplier": { "latency": 4, "count": 2 },
+            "divider": { "latency": 20, "interval": 19 },
+            "alu": { "interval": 1 }
+        },
+        "operations": {
+            "divu": { "latency": 18 }
+        }
+    })");
+    table.load( config);
+    CHECK( table.get_timing( mips_instr( "mult")).latency == 4_lt);
+    CHECK( table.get_count( FuncUnitClass::MULTIPLIER) == 2);
+    CHECK( table.get_timing( mips_instr( "div")).latency == 20_lt);
+    CHECK( table.get_timing( mips_instr( "div")).initiation_interval == 19);
+    CHECK( table.get_timing( mips_instr( "divu")).latency == 18_lt);
+    CHECK( table.get_timing( mips_instr( "divu")).initiation_interval == 19);
+    CHECK( table.get_long_latencies() == std::vector<Latency>{ 4_lt, 18_lt, 20_lt});
+}
+
+TEST_CASE( "FuncUnits: invalid table")
+{
+    FuncUnitTable table( 3);
+    std::istringstream unknown( R"({ "units": { "fpu": { "count": 1 } } })");
+    CHECK_THROWS_AS( table.load( unknown), InvalidFuncUnitConfig);
+    std::istringstream alu_latency( R"({ "units": { "alu": { "latency": 2 } } })");
+    CHECK_THROWS_AS( table.load( alu_latency), InvalidFuncUnitConfig);
+    std::istringstream long_latency( R"({ "operations": { "div": { "latency": 64 } } })");
+    CHECK_THROWS_AS( table.load( long_latency), InvalidFuncUnitConfig);
+    std::istringstream no_units( R"({ "units": { "divider": { "count": 0 } } })");
+    CHECK_THROWS_AS( table.load( no_units), InvalidFuncUnitConfig);
+    std::istringstream not_json( "units");
+    CHECK_THROWS_AS( table.load( not_json), InvalidFuncUnitConfig);
+}
+
+TEST_CASE( "FuncUnits: pipelined multiplier and non-pipelined divider")
+{
+    DataBypass<MIPSInstr> bypass( FuncUnitTable( 3), AluClusters( { 0, 1}));
+    const auto mult = mips_instr( "mult");
+    const auto div = mips_instr( "div");
+
+    bypass.update();
+    bypass.trace_new_instr( mult);
+    CHECK( !bypass.is_stall( mult));
+
+    bypass.update();
+    bypass.trace_new_instr( div);
+    CHECK( bypass.is_stall( div));
+    bypass.update();
+    CHECK( bypass.is_stall( div));
+    bypass.update();
+    CHECK( !bypass.is_stall( div));
+}
+
+TEST_CASE( "FuncUnits: writeback in program order")
+{
+    DataBypass<MIPSInstr> bypass( FuncUnitTable( 3), AluClusters( { 0, 1}));
+    const auto mult = mips_instr( "mult");
+    const auto add = mips_instr( "add");
+
+    // the addition cannot overtake the multiplication
+    bypass.update();
+    bypass.trace_new_instr( mult);
+    CHECK( bypass.is_stall( add));
+    CHECK( !bypass.is_stall( mult));
+    bypass.update();
+    CHECK( bypass.is_stall( add));
+    bypass.update();
+    CHECK( !bypass.is_stall( add));
+}
+
+TEST_CASE( "AluClusters: stages")
+{
+    CHECK( AluClusters( { 2, 0}).get_stages() == std::vector<uint32>{ 0, 2});
+    CHECK( AluClusters( { 2, 0}).get_last_stage() == 2);
+    CHECK_THROWS_AS( AluClusters( {}), InvalidFuncUnitConfig);
+    CHECK_THROWS_AS( AluClusters( { 0, AluClusters::MAX_STAGE + 1}), InvalidFuncUnitConfig);
+    CHECK_THROWS_AS( AluClusters( { 1, 0, 1}), InvalidFuncUnitConfig);
+}
+
+// lw $t0, 0($t1)
+static const uint32 LOAD_T0 = 0x8d280000;
+// addu $t2, $t0, $t0
+static const uint32 ADD_T2_T0 = 0x01085021;
+// addu $t3, $t4, $t4
+static const uint32 ADD_T3_T4 = 0x018c5821;
+
+TEST_CASE( "AluClusters: load-use is steered to the late cluster")
+{
+    DataBypass<MIPSInstr> bypass( FuncUnitTable( 3), AluClusters( { 0, 1}));
+    const auto load = mips_instr( LOAD_T0);
+    const auto add = mips_instr( ADD_T2_T0);
+
+    CHECK( bypass.get_execution_stage( mips_instr( ADD_T3_T4)) == 0U);
+    bypass.update();
+    bypass.trace_new_instr( load);
+    CHECK( !bypass.is_in_RF( add, 0));
+    REQUIRE( bypass.get_execution_stage( add) == 1U);
+    CHECK( bypass.get_bypass_command( add, 0, 1).get_bypass_direction() == BypassSource::MEMORY);
+    CHECK( bypass.get_execution_stage( mips_instr( ADD_T3_T4)) == 0U);
+}
+
+TEST_CASE( "AluClusters: load-use stalls without the late cluster")
+{
+    DataBypass<MIPSInstr> bypass( FuncUnitTable( 3), AluClusters( { 0}));
+    const auto load = mips_instr( LOAD_T0);
+    const auto add = mips_instr( ADD_T2_T0);
+
+    bypass.update();
+    bypass.trace_new_instr( load);
+    CHECK( bypass.is_stall( add));
+    bypass.update();
+    REQUIRE( bypass.get_execution_stage( add) == 0U);
+    CHECK( bypass.get_bypass_command( add, 0, 0).get_bypass_direction() == BypassSource::MEMORY);
+}
+
+TEST_CASE( "AluClusters: dependent additions")
+{
+    DataBypass<MIPSInstr> bypass( FuncUnitTable( 3), AluClusters( { 0, 1}));
+    auto producer = mips_instr( ADD_T3_T4);
+    // addu $t2, $t3, $t3
+    const auto consumer = mips_instr( 0x016b5021);
+
+    bypass.update();
+    producer.set_execution_stage( 0);
+    bypass.trace_new_instr( producer);
+    REQUIRE( bypass.get_execution_stage( consumer) == 0U);
+    CHECK( bypass.get_bypass_command( consumer, 1, 0).get_bypass_direction() == BypassSource::alu_stage( 0_lt));
+
+    // the value is read from the RF after writeback
+    for ( int i = 0; i < 3; ++i)
+        bypass.update();
+    CHECK( bypass.is_in_RF( consumer, 0));
+}
+
+TEST_CASE( "DataBypass: new producer replaces the previous one")
+{
+    DataBypass<MIPSInstr> bypass( FuncUnitTable( 5), AluClusters( { 0, 1}));
+    const auto sources = DataBypass<MIPSInstr>::get_sources_mask( mips_instr( ADD_T2_T0));
+    // mul $t0, $t1, $t1
+    const auto mul = mips_instr( 0x71294002);
+    // addu $t0, $t4, $t4
+    auto add = mips_instr( 0x018c4021);
+
+    bypass.update();
+    bypass.trace_new_instr( mul);
+    bypass.update();
+    CHECK( !bypass.are_sources_ready( sources, 0));
+
+    add.set_execution_stage( 0);
+    bypass.trace_new_instr( add);
+    bypass.update();
+    CHECK( bypass.are_sources_ready( sources, 0));
+}
+
+TEST_CASE( "DataBypass: sources of several instructions")
+{
+    DataBypass<MIPSInstr> bypass( FuncUnitTable( 3), AluClusters( { 0, 1}));
+    const auto sources = DataBypass<MIPSInstr>::get_sources_mask( mips_instr( ADD_T2_T0))
+                       | DataBypass<MIPSInstr>::get_sources_mask( mips_instr( ADD_T3_T4));
+
+    bypass.update();
+    bypass.trace_new_instr( mips_instr( LOAD_T0));
+    CHECK( !bypass.are_sources_ready( sources, 0));
+    CHECK( bypass.are_sources_ready( sources, 1));
+
+    bypass.handle_flush();
+    CHECK( bypass.are_sources_ready( sources, 0));
+    CHECK( bypass.is_in_RF( mips_instr( ADD_T2_T0), 0));
+}
@@ -10,12 +10,37 @@
 #include <infra/target.h>
 #include <infra/types.h>
 
+/* classes of control transfer instructions recognized by predecoder at fetch */
+enum class BranchType : uint8
+{
+    NONE,
+    BRANCH,
+    JUMP,
+    CALL,
+    INDIRECT_CALL,
+    RETURN,
+    INDIRECT_JUMP
+};
+
+static constexpr const size_t BRANCH_TYPES_NUM = 7;
+
+/* state of return address stack after the instruction */
+struct RASCheckpoint {
+    uint32 top = 0;
+    uint32 size = 0;
+    Addr entry = NO_VAL32;
+};
+
 /*the structure of data sent from memory to fetch stage */
 struct BPInterface {
     Addr pc = NO_VAL32;
     bool is_taken = false;
     Addr target = NO_VAL32;
     bool is_hit = true;
+    uint64 history = 0; // global history used for the prediction
+    bool is_in_history = true; // the direction is shifted into global history, BTB misses are not
+    BranchType type = BranchType::NONE;
+    RASCheckpoint ras = {};
 
     BPInterface() = default;
 
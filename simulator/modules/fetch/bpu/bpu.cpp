@@ -6,15 +6,20 @@
 
 #include "bpentry.h"
 #include "bpu.h"
+#include "global_history.h"
 
 // MIPT_MIPS modules
 #include <infra/cache/cache_tag_array.h>
 #include <infra/config/config.h>
 
 // C++ generic modules
+#include <algorithm>
+#include <bit>
 #include <map>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 namespace config {
@@ -22,23 +27,33 @@ namespace config {
     static const Value<std::string> bp_lru = { "bp-lru", "pseudo-LRU", "branch prediction replacement policy"};
     static const Value<uint32> bp_size = { "bp-size", 128, "BTB size in entries"};
     static const Value<uint32> bp_ways = { "bp-ways", 16, "number of ways in BTB"};
+    static const Value<uint32> bp_table_size = { "bp-table-size", 4096, "size of global history predictor tables in entries"};
+    static const Value<uint32> bp_history = { "bp-history", 12, "global history length of gshare and perceptron"};
+    static const Value<std::string> bp_tage_history = { "bp-tage-history", "4,8,16,32,64", "history lengths of TAGE tagged tables"};
+    static const Value<uint32> bp_ras_depth = { "bp-ras-depth", 16, "depth of return address stack"};
+    static const Value<uint32> bp_indirect_size = { "bp-indirect-size", 256, "indirect target cache size in entries"};
+    static const Value<uint32> bp_indirect_history = { "bp-indirect-history", 8, "global history length of indirect target cache"};
 } // namespace config
 
-template<typename T>
-class BP final: public BaseBP
+/*
+ * Branch target buffer. Entries of predictor tables are stored
+ * in separate flat arrays indexed by set * ways + way, so a single
+ * tag probe gives access to both the target and the direction.
+ */
+class BTB
 {
-    std::vector<std::vector<T>> directions;
-    std::vector<std::vector<Addr>> targets;
     std::unique_ptr<CacheTagArray> tags = nullptr;
+    std::vector<Addr> targets;
+    const uint32 ways;
 
-    bool is_way_taken( size_t way, Addr PC, Addr target) const
+    size_t get_index( Addr PC, int32 way) const
     {
-        return directions[ way][ tags->set(PC)].is_taken( PC, target);
+        return size_t{ tags->set( PC)} * ways + narrow_cast<size_t>( way);
     }
 public:
-    BP( const std::string& lru, uint32 size_in_entries, uint32 ways, uint32 branch_ip_size_in_bits) try
-        : directions( ways, std::vector<T>( size_in_entries / ways))
-        , targets( ways, std::vector<Addr>( size_in_entries / ways))
+    BTB( const std::string& lru, uint32 size_in_entries, uint32 ways, uint32 branch_ip_size_in_bits) try
+        : targets( size_in_entries)
+        , ways( ways)
     {
         // we're reusing existing CacheTagArray functionality,
         // but here we don't split memory in blocks, storing
@@ -49,56 +64,134 @@ public:
         throw BPInvalidMode( e.what(), "");
     }
 
-    /* prediction */
-    bool is_taken( Addr PC) const final
+    struct Probe
+    {
+        bool is_hit;
+        size_t index;
+    };
+
+    // Does not update LRU information, so "no_touch" version of "tags->read" is used
+    Probe probe( Addr PC) const
     {
-        // do not update LRU information on prediction,
-        // so "no_touch" version of "tags->read" is used:
         const auto[ is_hit, way] = tags->read_no_touch( PC);
-        return is_hit && is_way_taken( way, PC, targets[ way][ tags->set(PC)]);
+        if ( !is_hit || way < 0)
+            return { false, 0};
+
+        return { true, get_index( PC, way)};
     }
 
-    bool is_hit( Addr PC) const final
+    // Returns index of the entry, the entry is allocated on a miss
+    Probe touch( Addr PC)
     {
-        // do not update LRU information on this check,
-        // so "no_touch" version of "tags->read" is used:
-        return tags->read_no_touch( PC).first;
+        auto[ is_hit, way] = tags->read( PC);
+        if ( !is_hit)
+            way = tags->write( PC);
+
+        // infinite BTB grows without limits
+        const auto index = get_index( PC, way);
+        if ( index >= targets.size())
+            targets.resize( index + 1);
+
+        return { is_hit, index};
     }
 
-    Addr get_target( Addr PC) const final
+    Addr get_target( size_t index) const { return targets[ index]; }
+    void set_target( size_t index, Addr target) { targets[ index] = target; }
+};
+
+template<typename T>
+class BP final: public BaseBP
+{
+    BTB btb;
+    std::vector<T> directions;
+
+public:
+    BP( const std::string& lru, uint32 size_in_entries, uint32 ways, uint32 branch_ip_size_in_bits)
+        : btb( lru, size_in_entries, ways, branch_ip_size_in_bits)
+        , directions( size_in_entries)
+    { }
+
+    /* prediction */
+    BPInterface lookup( Addr PC) const final
     {
-        // do not update LRU information on prediction,
-        // so "no_touch" version of "tags->read" is used:
-        const auto[ is_hit, way] = tags->read_no_touch( PC);
+        const auto probe = btb.probe( PC);
+        if ( !probe.is_hit)
+            return BPInterface( PC, false, PC + 4, false);
 
         // return saved target only in case it is predicted taken
-        if ( is_hit && is_way_taken( way, PC, targets[ way][ tags->set(PC)]))
-            return targets[ way][ tags->set(PC)];
-
-        return PC + 4;
+        const auto target = btb.get_target( probe.index);
+        const bool is_taken = directions[ probe.index].is_taken( PC, target);
+        return BPInterface( PC, is_taken, is_taken ? target : PC + 4, true);
     }
 
     /* update */
-    void update( const BPInterface& bp_upd) final
+    void train( const BPInterface& bp_upd) final
     {
-        const auto set = tags->set( bp_upd.pc);
-        auto[ is_hit, way] = tags->read( bp_upd.pc);
+        const auto entry = btb.touch( bp_upd.pc);
+        if ( entry.index >= directions.size())
+            directions.resize( entry.index + 1);
 
-        if ( !is_hit) { // miss
-            way = tags->write( bp_upd.pc); // add new entry to cache
-            auto& entry = directions[ way][ set];
-            entry.reset();
-        }
+        if ( !entry.is_hit) // add new entry to cache
+            directions[ entry.index].reset();
+
+        directions[ entry.index].update( bp_upd.is_taken);
+        btb.set_target( entry.index, bp_upd.target);
+    }
+};
+
+// Direction is predicted by global history of branches which hit in BTB
+template<typename D>
+class GlobalBP final: public BaseBP
+{
+    BTB btb;
+    D direction;
+
+public:
+    GlobalBP( D&& direction, const std::string& lru, uint32 size_in_entries, uint32 ways, uint32 branch_ip_size_in_bits)
+        : btb( lru, size_in_entries, ways, branch_ip_size_in_bits)
+        , direction( std::move( direction))
+    { }
+
+    /* prediction */
+    BPInterface lookup( Addr PC) const final
+    {
+        const auto probe = btb.probe( PC);
+        if ( !probe.is_hit)
+            return BPInterface( PC, false, PC + 4, false);
 
-        directions[ way][ set].update( bp_upd.is_taken);
-        targets[ way][ set] = bp_upd.target;
+        const bool is_taken = direction.is_taken( PC, get_history());
+        return BPInterface( PC, is_taken, is_taken ? btb.get_target( probe.index) : PC + 4, true);
+    }
+
+    /* update */
+    void train( const BPInterface& bp_upd) final
+    {
+        const auto entry = btb.touch( bp_upd.pc);
+        btb.set_target( entry.index, bp_upd.target);
+        direction.update( bp_upd.pc, bp_upd.history, bp_upd.is_taken);
     }
 };
 
+static void check_parameters( const BPParameters& parameters)
+{
+    if ( !std::has_single_bit( parameters.table_size))
+        throw BPInvalidMode( "table size " + std::to_string( parameters.table_size),
+                             "Size of global history predictor tables must be a power of 2");
+
+    const auto is_valid_length = []( uint32 length) { return length > 0 && length <= 64; };
+    const auto& tage = parameters.tage_history_lengths;
+    if ( !is_valid_length( parameters.history_length)
+        || tage.empty()
+        || !std::all_of( tage.begin(), tage.end(), is_valid_length)
+        || !std::is_sorted( tage.begin(), tage.end()))
+        throw BPInvalidMode( "history length", "History lengths must be in range 1..64, TAGE ones in ascending order");
+}
+
 class BPFactory {
     struct BaseBPCreator {
         virtual std::unique_ptr<BaseBP> create( const std::string& lru, uint32 size_in_entries, uint32 ways,
-                                               uint32 branch_ip_size_in_bits) const = 0;
+                                               uint32 branch_ip_size_in_bits,
+                                               const BPParameters& parameters) const = 0;
         BaseBPCreator() = default;
         virtual ~BaseBPCreator() = default;
         BaseBPCreator( const BaseBPCreator&) = delete;
@@ -110,7 +203,8 @@ class BPFactory {
     template<typename T>
     struct BPCreator : BaseBPCreator {
         std::unique_ptr<BaseBP> create( const std::string& lru, uint32 size_in_entries, uint32 ways,
-                                       uint32 branch_ip_size_in_bits) const final
+                                       uint32 branch_ip_size_in_bits,
+                                       const BPParameters& /* unused */) const final
         {
             return std::make_unique<BP<T>>( lru, size_in_entries,
                                             ways, branch_ip_size_in_bits);
@@ -118,6 +212,27 @@ class BPFactory {
         BPCreator() = default;
     };
 
+    template<typename D>
+    struct GlobalBPCreator : BaseBPCreator {
+        std::unique_ptr<BaseBP> create( const std::string& lru, uint32 size_in_entries, uint32 ways,
+                                       uint32 branch_ip_size_in_bits,
+                                       const BPParameters& parameters) const final
+        {
+            check_parameters( parameters);
+            return std::make_unique<GlobalBP<D>>( create_direction( parameters), lru, size_in_entries,
+                                                  ways, branch_ip_size_in_bits);
+        }
+        GlobalBPCreator() = default;
+    private:
+        static D create_direction( const BPParameters& parameters)
+        {
+            if constexpr ( std::is_same_v<D, TAGE>)
+                return D( parameters.table_size, parameters.tage_history_lengths);
+            else
+                return D( parameters.table_size, parameters.history_length);
+        }
+    };
+
     using Map = std::map<std::string, std::unique_ptr<BaseBPCreator>>;
     const Map map;
 
@@ -130,6 +245,9 @@ class BPFactory {
         my_map.emplace("saturating_one_bit", std::make_unique<BPCreator<BPEntryOneBit>>());
         my_map.emplace("saturating_two_bits", std::make_unique<BPCreator<BPEntryTwoBit>>());
         my_map.emplace("adaptive_two_levels", std::make_unique<BPCreator<BPEntryAdaptive<2>>>());
+        my_map.emplace("gshare", std::make_unique<GlobalBPCreator<GShare>>());
+        my_map.emplace("tage", std::make_unique<GlobalBPCreator<TAGE>>());
+        my_map.emplace("perceptron", std::make_unique<GlobalBPCreator<HashedPerceptron>>());
         return my_map;
     }
 
@@ -147,24 +265,135 @@ public:
 
     auto create( const std::string& name, const std::string& lru,
                  uint32 size_in_entries, uint32 ways,
-                 uint32 branch_ip_size_in_bits) const
+                 uint32 branch_ip_size_in_bits,
+                 const BPParameters& parameters) const
     {
         auto it = map.find( name);
         if ( it != map.end())
-            return it->second->create( lru, size_in_entries, ways, branch_ip_size_in_bits);
+            return it->second->create( lru, size_in_entries, ways, branch_ip_size_in_bits, parameters);
 
         throw BPInvalidMode( name, print_map());
     }
 };
 
+static uint64 shift_history( uint64 history, bool is_taken)
+{
+    return ( history << 1U) | uint64{ is_taken};
+}
+
+BPInterface BaseBP::predict( Addr PC, BranchType type, Addr return_address, uint64 sequence_id)
+{
+    if ( sequence_id != NO_VAL64 && sequence_id == last_sequence_id && PC == last_prediction.pc)
+        return last_prediction;
+
+    auto info = get_bp_info( PC);
+    info.history = history;
+    info.type = type;
+    ++statistics.btb_lookups;
+    if ( info.is_hit)
+        ++statistics.btb_hits;
+
+    if ( type == BranchType::RETURN && !ras.empty()) {
+        ++statistics.ras_pops;
+        info = BPInterface( PC, true, ras.pop(), true);
+        info.history = history;
+        info.type = type;
+    }
+    else if ( type == BranchType::RETURN) {
+        ++statistics.ras_underflows;
+    }
+    else if ( type == BranchType::INDIRECT_CALL || type == BranchType::INDIRECT_JUMP) {
+        const auto [is_hit, target] = indirect_targets.predict( PC, history);
+        ++statistics.itc_lookups;
+        if ( is_hit) {
+            ++statistics.itc_hits;
+            info.is_hit = info.is_taken = true;
+            info.target = target;
+        }
+    }
+
+    if ( type == BranchType::CALL || type == BranchType::INDIRECT_CALL) {
+        ++statistics.ras_pushes;
+        ras.push( return_address);
+    }
+
+    info.is_in_history = info.is_hit;
+    if ( info.is_in_history)
+        history = shift_history( history, info.is_taken);
+
+    info.ras = ras.get_checkpoint();
+    last_prediction = info;
+    last_sequence_id = sequence_id;
+    return info;
+}
+
+std::vector<NamedFormula> BaseBP::get_statistics_formulas() const
+{
+    return {
+        { "btb.lookups",    "", make_value( &statistics.btb_lookups)},
+        { "btb.hits",       "", make_value( &statistics.btb_hits)},
+        { "btb.hit_rate",   "share of fetched instructions found in the branch target buffer",
+                            make_ratio( &statistics.btb_hits, &statistics.btb_lookups)},
+        { "ras.pushes",     "", make_value( &statistics.ras_pushes)},
+        { "ras.pops",       "", make_value( &statistics.ras_pops)},
+        { "ras.underflows", "returns predicted with the empty return address stack", make_value( &statistics.ras_underflows)},
+        { "itc.lookups",    "", make_value( &statistics.itc_lookups)},
+        { "itc.hits",       "", make_value( &statistics.itc_hits)},
+        { "itc.hit_rate",   "share of indirect jumps found in the indirect target cache",
+                            make_ratio( &statistics.itc_hits, &statistics.itc_lookups)}
+    };
+}
+
+void BaseBP::update( const BPInterface& bp_upd)
+{
+    train( bp_upd);
+    if ( bp_upd.type == BranchType::INDIRECT_CALL || bp_upd.type == BranchType::INDIRECT_JUMP)
+        indirect_targets.update( bp_upd.pc, bp_upd.history, bp_upd.target);
+}
+
+void BaseBP::repair( const BPInterface& bp_upd)
+{
+    // the same rule as in prediction, so the repaired history matches the correct path
+    history = bp_upd.is_in_history ? shift_history( bp_upd.history, bp_upd.is_taken) : bp_upd.history;
+    ras.restore( bp_upd.ras);
+    last_sequence_id = NO_VAL64;
+}
+
 std::unique_ptr<BaseBP> BaseBP::create_bp( const std::string& name, const std::string& lru, 
-                                           uint32 size_in_entries, uint32 ways, uint32 branch_ip_size_in_bits)
+                                           uint32 size_in_entries, uint32 ways, uint32 branch_ip_size_in_bits,
+                                           const BPParameters& parameters)
 {
     static const BPFactory factory;
-    return factory.create(name, lru, size_in_entries, ways, branch_ip_size_in_bits);
+    auto bp = factory.create(name, lru, size_in_entries, ways, branch_ip_size_in_bits, parameters);
+
+    if ( parameters.indirect_size != 0 && !std::has_single_bit( parameters.indirect_size))
+        throw BPInvalidMode( "indirect target cache size " + std::to_string( parameters.indirect_size),
+                             "Size of indirect target cache must be a power of 2");
+    if ( parameters.indirect_history_length > 64)
+        throw BPInvalidMode( "history length", "History lengths must be in range 1..64");
+
+    bp->ras = ReturnAddressStack( parameters.ras_depth);
+    bp->indirect_targets = IndirectTargetCache( parameters.indirect_size, parameters.indirect_history_length);
+    return bp;
+}
+
+static std::vector<uint32> parse_history_lengths( const std::string& value)
+{
+    std::vector<uint32> result;
+    std::istringstream in( value);
+    for ( std::string length; std::getline( in, length, ','); ) try {
+        result.push_back( narrow_cast<uint32>( std::stoul( length)));
+    }
+    catch ( const std::logic_error&) {
+        throw BPInvalidMode( "history lengths " + value, "History lengths must be a comma-separated list");
+    }
+    return result;
 }
 
 std::unique_ptr<BaseBP> BaseBP::create_configured_bp()
 {
-    return create_bp( config::bp_mode, config::bp_lru, config::bp_size, config::bp_ways, 32);
+    const BPParameters parameters{ config::bp_table_size, config::bp_history,
+                                   parse_history_lengths( config::bp_tage_history),
+                                   config::bp_ras_depth, config::bp_indirect_size, config::bp_indirect_history};
+    return create_bp( config::bp_mode, config::bp_lru, config::bp_size, config::bp_ways, 32, parameters);
 }
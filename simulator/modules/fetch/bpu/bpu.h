@@ -8,13 +8,16 @@
 #define BRANCH_PREDICTION_UNIT
 
 #include "bp_interface.h"
+#include "target_predictors.h"
 
 // MIPT_MIPS modules
 #include <infra/exception.h>
+#include <infra/statistics/statistics.h>
 #include <infra/types.h>
 
 #include <memory>
 #include <string>
+#include <vector>
 
 struct BPInvalidMode final : Exception
 {
@@ -23,6 +26,17 @@ struct BPInvalidMode final : Exception
     { }
 };
 
+// Parameters of the predictors indexed by global history and of target predictors
+struct BPParameters
+{
+    uint32 table_size = 4096;
+    uint32 history_length = 12;
+    std::vector<uint32> tage_history_lengths = { 4, 8, 16, 32, 64};
+    uint32 ras_depth = 16;
+    uint32 indirect_size = 256;
+    uint32 indirect_history_length = 8;
+};
+
 /*
  *******************************************************************************
  *                           BRANCH PREDICTION UNIT                            *
@@ -34,27 +48,65 @@ class BaseBP
     BaseBP( BaseBP&&) = default;
 protected:
     BaseBP() = default;
+
+    // Speculative global history, the youngest branch is the least significant bit
+    uint64 get_history() const noexcept { return history; }
+
+    // Trains direction and BTB
+    virtual void train( const BPInterface& bp_upd) = 0;
+
+    // Hit, direction and target are looked up together by a single BTB probe
+    virtual BPInterface lookup( Addr PC) const = 0;
 public:
-    virtual bool is_taken( Addr PC) const = 0;
-    virtual bool is_hit( Addr PC) const = 0;
-    virtual Addr get_target( Addr PC) const = 0;
-    virtual void update( const BPInterface& bp_upd) = 0;
+    // Prediction without updates of the speculative state
+    BPInterface get_bp_info( Addr PC) const { return lookup( PC); }
+
+    /*
+     * Prediction at fetch. Global history and return address stack
+     * are updated speculatively, their state is saved to the result.
+     * 'type' and 'return_address' are provided by predecoder.
+     * Fetch repeats the held instruction while decode stalls: the repeat
+     * with the same 'sequence_id' gets the saved prediction without updates.
+     */
+    BPInterface predict( Addr PC, BranchType type = BranchType::NONE, Addr return_address = NO_VAL32, uint64 sequence_id = NO_VAL64);
+
+    void update( const BPInterface& bp_upd);
 
-    BPInterface get_bp_info( Addr PC) const
+    // Restores speculative state after the misprediction of 'bp_upd' branch
+    void repair( const BPInterface& bp_upd);
+
+    // Each predicted instruction is counted once, repeats during stalls are not
+    struct Statistics
     {
-        if ( is_hit( PC))
-            return BPInterface( PC, is_taken( PC), get_target( PC), true);
+        uint64 btb_lookups = 0;
+        uint64 btb_hits = 0;
+        uint64 ras_pushes = 0;
+        uint64 ras_pops = 0;
+        uint64 ras_underflows = 0; // returns predicted with the empty stack
+        uint64 itc_lookups = 0;
+        uint64 itc_hits = 0;
+    };
+    const Statistics& get_statistics() const noexcept { return statistics; }
 
-        return BPInterface( PC, false, PC + 4, false);
-    }
+    // BTB, return address stack and indirect target cache counters for the registry of fetch
+    std::vector<NamedFormula> get_statistics_formulas() const;
 
     virtual ~BaseBP() = default;
     BaseBP& operator=( const BaseBP&) = default;
     BaseBP& operator=( BaseBP&&) = default;
     
     static std::unique_ptr<BaseBP> create_bp(const std::string& name, const std::string& lru,
-                uint32 size_in_entries, uint32 ways, uint32 branch_ip_size_in_bits);
+                uint32 size_in_entries, uint32 ways, uint32 branch_ip_size_in_bits,
+                const BPParameters& parameters = {});
     static std::unique_ptr<BaseBP> create_configured_bp();
+
+private:
+    uint64 history = 0;
+    BPInterface last_prediction;
+    uint64 last_sequence_id = NO_VAL64;
+    Statistics statistics;
+    ReturnAddressStack ras{ 0};
+    IndirectTargetCache indirect_targets{ 0, 0};
 };
 
 #endif
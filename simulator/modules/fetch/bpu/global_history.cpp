@@ -0,0 +1,207 @@
+/*
+ * global_history.cpp - direction predictors indexed by global branch history
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "global_history.h"
+
+#include <infra/macro.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+
+// XORs chunks of the history of given length to a value of given width
+static uint64 fold( uint64 history, uint32 length, uint32 width)
+{
+    uint64 result = 0;
+    for ( uint64 value = history & bitmask<uint64>( length); value != 0; value >>= width)
+        result ^= value & bitmask<uint64>( width);
+
+    return result;
+}
+
+static void update_two_bit( uint8* counter, bool is_taken)
+{
+    if ( is_taken)
+        *counter = std::min<uint8>( *counter + 1, 3);
+    else if ( *counter > 0)
+        --*counter;
+}
+
+GShare::GShare( uint32 table_size, uint32 history_length)
+    : counters( table_size, 1) // weakly not taken
+    , history_length( history_length)
+{ }
+
+size_t GShare::get_index( Addr PC, uint64 history) const
+{
+    const auto index_bits = narrow_cast<uint32>( std::countr_zero( counters.size()));
+    return narrow_cast<size_t>( ( ( PC >> 2U) ^ fold( history, history_length, index_bits)) & ( counters.size() - 1));
+}
+
+bool GShare::is_taken( Addr PC, uint64 history) const
+{
+    return counters[ get_index( PC, history)] >= 2;
+}
+
+void GShare::update( Addr PC, uint64 history, bool is_taken)
+{
+    update_two_bit( &counters[ get_index( PC, history)], is_taken);
+}
+
+TAGE::TAGE( uint32 table_size, const std::vector<uint32>& history_lengths)
+    : bimodal( table_size, 1) // weakly not taken
+    , index_bits( narrow_cast<uint32>( std::countr_zero( table_size)))
+{
+    tables.reserve( history_lengths.size());
+    for ( const auto length : history_lengths)
+        tables.push_back( Table{ length, std::vector<Entry>( table_size)});
+}
+
+size_t TAGE::get_index( size_t table, Addr PC, uint64 history) const
+{
+    const auto length = tables[ table].history_length;
+    const auto hash = ( PC >> 2U) ^ ( PC >> ( 2U + index_bits)) ^ fold( history, length, index_bits) ^ ( table << 1U);
+    return narrow_cast<size_t>( hash & bitmask<uint64>( index_bits));
+}
+
+uint16 TAGE::get_tag( size_t table, Addr PC, uint64 history) const
+{
+    const auto length = tables[ table].history_length;
+    const auto hash = ( PC >> 2U) ^ fold( history, length, TAG_BITS) ^ ( fold( history, length, TAG_BITS - 1) << 1U);
+    return narrow_cast<uint16>( hash & bitmask<uint64>( TAG_BITS));
+}
+
+TAGE::Lookup TAGE::lookup( Addr PC, uint64 history) const
+{
+    Lookup result;
+    for ( auto i = narrow_cast<int32>( tables.size()) - 1; i >= 0; --i)
+    {
+        const auto table = narrow_cast<size_t>( i);
+        const auto& entry = tables[ table].entries[ get_index( table, PC, history)];
+        if ( !entry.valid || entry.tag != get_tag( table, PC, history))
+            continue;
+
+        if ( result.provider < 0)
+            result.provider = i;
+        else {
+            result.alternate = i;
+            break;
+        }
+    }
+    return result;
+}
+
+bool TAGE::get_prediction( Addr PC, uint64 history, int32 table) const
+{
+    if ( table < 0)
+        return bimodal[ ( PC >> 2U) & ( bimodal.size() - 1)] >= 2;
+
+    const auto index = narrow_cast<size_t>( table);
+    return tables[ index].entries[ get_index( index, PC, history)].counter >= 0;
+}
+
+bool TAGE::is_taken( Addr PC, uint64 history) const
+{
+    return get_prediction( PC, history, lookup( PC, history).provider);
+}
+
+void TAGE::update( Addr PC, uint64 history, bool is_taken)
+{
+    const auto info = lookup( PC, history);
+    const bool prediction = get_prediction( PC, history, info.provider);
+    const bool alternate = get_prediction( PC, history, info.alternate);
+
+    if ( info.provider < 0) {
+        update_two_bit( &bimodal[ ( PC >> 2U) & ( bimodal.size() - 1)], is_taken);
+    }
+    else {
+        const auto table = narrow_cast<size_t>( info.provider);
+        auto& entry = tables[ table].entries[ get_index( table, PC, history)];
+
+        // the provider is useful if the shorter history mispredicts
+        if ( prediction != alternate && prediction == is_taken)
+            entry.useful = std::min<uint8>( entry.useful + 1, 3);
+        else if ( prediction != alternate && entry.useful > 0)
+            --entry.useful;
+
+        if ( is_taken)
+            entry.counter = std::min<int8>( entry.counter + 1, 3);
+        else
+            entry.counter = std::max<int8>( entry.counter - 1, -4);
+    }
+
+    if ( prediction != is_taken)
+        allocate( PC, history, narrow_cast<size_t>( info.provider + 1), is_taken);
+
+    // usefulness is aged to let new entries be allocated
+    if ( ++updates % USEFULNESS_RESET_PERIOD == 0)
+        for ( auto& table : tables)
+            for ( auto& entry : table.entries)
+                entry.useful >>= 1U;
+}
+
+void TAGE::allocate( Addr PC, uint64 history, size_t first_table, bool is_taken)
+{
+    for ( size_t i = first_table; i < tables.size(); ++i)
+    {
+        auto& entry = tables[ i].entries[ get_index( i, PC, history)];
+        if ( entry.useful == 0) {
+            entry = Entry{ get_tag( i, PC, history), narrow_cast<int8>( is_taken ? 0 : -1), 0, true};
+            return;
+        }
+    }
+
+    for ( size_t i = first_table; i < tables.size(); ++i)
+    {
+        auto& entry = tables[ i].entries[ get_index( i, PC, history)];
+        --entry.useful;
+    }
+}
+
+HashedPerceptron::HashedPerceptron( uint32 table_size, uint32 history_length)
+    // the first table is a bias indexed by PC only
+    : weights( 1 + ( history_length + SEGMENT_BITS - 1) / SEGMENT_BITS, std::vector<int8>( table_size))
+    , history_length( history_length)
+    , threshold( narrow_cast<int32>( 193 * history_length / 100 + 14))
+{ }
+
+size_t HashedPerceptron::get_index( size_t table, Addr PC, uint64 history) const
+{
+    const auto mask = weights[ table].size() - 1;
+    if ( table == 0)
+        return narrow_cast<size_t>( ( PC >> 2U) & mask);
+
+    const auto shift = ( table - 1) * SEGMENT_BITS;
+    const auto length = std::min<uint32>( SEGMENT_BITS, history_length - narrow_cast<uint32>( shift));
+    const auto segment = ( history >> shift) & bitmask<uint64>( length);
+
+    // odd multiplier keeps segments of a single branch in different entries
+    return narrow_cast<size_t>( ( ( PC >> 2U) ^ ( segment * 0x9e37'79b1ULL)) & mask);
+}
+
+int32 HashedPerceptron::get_output( Addr PC, uint64 history) const
+{
+    int32 output = 0;
+    for ( size_t i = 0; i < weights.size(); ++i)
+        output += weights[ i][ get_index( i, PC, history)];
+
+    return output;
+}
+
+void HashedPerceptron::update( Addr PC, uint64 history, bool is_taken)
+{
+    const auto output = get_output( PC, history);
+    if ( ( output >= 0) == is_taken && std::abs( output) > threshold)
+        return;
+
+    for ( size_t i = 0; i < weights.size(); ++i)
+    {
+        auto& weight = weights[ i][ get_index( i, PC, history)];
+        if ( is_taken)
+            weight = narrow_cast<int8>( std::min<int32>( weight + 1, 127));
+        else
+            weight = narrow_cast<int8>( std::max<int32>( weight - 1, -128));
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * global_history.h - direction predictors indexed by global branch history
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef GLOBAL_HISTORY_H
+#define GLOBAL_HISTORY_H
+
+#include <infra/types.h>
+
+#include <vector>
+
+/* each class has to implement at least these methods:
+ * 1. bool is_taken( Addr PC, uint64 history) const;
+ * 2. void update( Addr PC, uint64 history, bool is_taken);
+ * 3. uint32 get_history_length() const;
+ * The youngest branch is the least significant bit of the history.
+ */
+
+/* Two-bit counters indexed by PC xor global history */
+class GShare
+{
+public:
+    GShare( uint32 table_size, uint32 history_length);
+
+    bool is_taken( Addr PC, uint64 history) const;
+    void update( Addr PC, uint64 history, bool is_taken);
+    uint32 get_history_length() const noexcept { return history_length; }
+
+private:
+    size_t get_index( Addr PC, uint64 history) const;
+
+    std::vector<uint8> counters;
+    const uint32 history_length;
+};
+
+/*
+ * TAgged GEometric history length predictor.
+ * The bimodal table is backed by tagged tables with growing history lengths,
+ * the longest matching table provides the prediction.
+ */
+class TAGE
+{
+public:
+    TAGE( uint32 table_size, const std::vector<uint32>& history_lengths);
+
+    bool is_taken( Addr PC, uint64 history) const;
+    void update( Addr PC, uint64 history, bool is_taken);
+    uint32 get_history_length() const noexcept { return tables.back().history_length; }
+
+private:
+    static const constexpr uint32 TAG_BITS = 9;
+    static const constexpr uint64 USEFULNESS_RESET_PERIOD = 1ULL << 18U;
+
+    struct Entry
+    {
+        uint16 tag = 0;
+        int8 counter = 0;  // 3-bit signed, taken if non-negative
+        uint8 useful = 0;  // 2-bit
+        bool valid = false;
+    };
+
+    struct Table
+    {
+        uint32 history_length;
+        std::vector<Entry> entries;
+    };
+
+    struct Lookup
+    {
+        int32 provider = -1;   // index of the tagged table, -1 is for the bimodal one
+        int32 alternate = -1;
+    };
+
+    size_t get_index( size_t table, Addr PC, uint64 history) const;
+    uint16 get_tag( size_t table, Addr PC, uint64 history) const;
+    Lookup lookup( Addr PC, uint64 history) const;
+    bool get_prediction( Addr PC, uint64 history, int32 table) const;
+    void allocate( Addr PC, uint64 history, size_t first_table, bool is_taken);
+
+    std::vector<uint8> bimodal;
+    std::vector<Table> tables;
+    const uint32 index_bits;
+    uint64 updates = 0;
+};
+
+/*
+ * Hashed perceptron: each table holds weights indexed by PC
+ * hashed with a segment of the global history.
+ * The sign of the weights sum is the prediction.
+ */
+class HashedPerceptron
+{
+public:
+    HashedPerceptron( uint32 table_size, uint32 history_length);
+
+    bool is_taken( Addr PC, uint64 history) const { return get_output( PC, history) >= 0; }
+    void update( Addr PC, uint64 history, bool is_taken);
+    uint32 get_history_length() const noexcept { return history_length; }
+
+private:
+    static const constexpr uint32 SEGMENT_BITS = 8;
+
+    int32 get_output( Addr PC, uint64 history) const;
+    size_t get_index( size_t table, Addr PC, uint64 history) const;
+
+    std::vector<std::vector<int8>> weights;
+    const uint32 history_length;
+    const int32 threshold;
+};
+
+#endif // GLOBAL_HISTORY_H
@@ -7,6 +7,7 @@
 #include <catch.hpp>
 #include <infra/replacement/cache_replacement.h>
 #include <modules/fetch/bpu/bpu.h>
+#include <modules/fetch/bpu/global_history.h>
 
 #include <cassert>
 #include <cstdlib>
@@ -43,8 +44,8 @@ TEST_CASE( "Static, all branches not taken")
     bp->update( BPInterface( PC, true, target, true));
     bp->update( BPInterface( PC, true, target, true));
 
-    CHECK_FALSE( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == PC + 4);
+    CHECK_FALSE( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == PC + 4);
 }
 
 TEST_CASE( "Static, all branches taken")
@@ -55,8 +56,8 @@ TEST_CASE( "Static, all branches taken")
     Addr target = 12;
 
     bp->update( BPInterface( PC, true, target, false));
-    CHECK( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == target);
 }
 
 TEST_CASE( "Backward only branches taken")
@@ -67,8 +68,8 @@ TEST_CASE( "Backward only branches taken")
     Addr target = 12;
 
     bp->update( BPInterface( PC, true, target, false));
-    CHECK( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == target);
 }
 
 TEST_CASE( "Backward only branches taken in case of forward jump")
@@ -79,8 +80,8 @@ TEST_CASE( "Backward only branches taken in case of forward jump")
     Addr target = 36;
 
     bp->update( BPInterface( PC, true, target, false));
-    CHECK_FALSE( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == PC + 4);
+    CHECK_FALSE( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == PC + 4);
 }
 
 TEST_CASE( "One bit predictor")
@@ -91,8 +92,8 @@ TEST_CASE( "One bit predictor")
     Addr target = 12;
 
     bp->update( BPInterface( PC, true, target, false));
-    CHECK( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == target);
 }
 
 TEST_CASE( "One bit predictor in case of changed target")
@@ -107,7 +108,7 @@ TEST_CASE( "One bit predictor in case of changed target")
     //change the target
     target = 16;
     bp->update( BPInterface( PC, true, target, false));
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).target == target);
 }
 
 TEST_CASE( "Two bit predictor, basic")
@@ -118,8 +119,8 @@ TEST_CASE( "Two bit predictor, basic")
     Addr target = 12;
 
     bp->update( BPInterface( PC, true, target, false));
-    CHECK( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == target);
 }
 
 TEST_CASE( "Two bit predictor, advanced")
@@ -131,49 +132,49 @@ TEST_CASE( "Two bit predictor, advanced")
 
     // Learn
     bp->update( BPInterface( PC, true, target, false));
-    CHECK( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == target);
 
     bp->update( BPInterface( PC, true, target, true));
-    CHECK( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == target);
 
     // "Over" - learning
     bp->update( BPInterface( PC, true, target, true));
-    CHECK( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == target);
 
     bp->update( BPInterface( PC, true, target, true));
-    CHECK( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == target);
 
     // Moderate "Un" - learning
     bp->update( BPInterface( PC, false, NO_VAL32, true));
-    CHECK( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == NO_VAL32);
+    CHECK( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == NO_VAL32);
 
     // Strong "un" - learning
     bp->update( BPInterface( PC, false, NO_VAL32, true));
     bp->update( BPInterface( PC, false, NO_VAL32, true));
     bp->update( BPInterface( PC, false, NO_VAL32, true));
-    CHECK_FALSE(bp->is_taken(PC));
+    CHECK_FALSE(bp->get_bp_info( PC).is_taken);
 
     bp->update( BPInterface( PC, false, NO_VAL32, true));
-    CHECK_FALSE(bp->is_taken(PC));
+    CHECK_FALSE(bp->get_bp_info( PC).is_taken);
 
     bp->update( BPInterface( PC, false, NO_VAL32, true));
-    CHECK_FALSE(bp->is_taken(PC));
+    CHECK_FALSE(bp->get_bp_info( PC).is_taken);
 
     bp->update( BPInterface( PC, false, NO_VAL32, true));
-    CHECK_FALSE(bp->is_taken(PC));
+    CHECK_FALSE(bp->get_bp_info( PC).is_taken);
 
     // Learn again
     bp->update( BPInterface( PC, true, target, true));
-    CHECK_FALSE(bp->is_taken(PC));
+    CHECK_FALSE(bp->get_bp_info( PC).is_taken);
 
     bp->update( BPInterface( PC, true, target, true));
-    CHECK( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == target);
 }
 
 static auto get_trained_adaptive_two_level_predictor( Addr PC, Addr target)
@@ -205,20 +206,20 @@ TEST_CASE( "Adaptive two bit prediction")
     //check prediction on 00 sequence
     bp->update( BPInterface( PC, false, target, false));
     bp->update( BPInterface( PC, false, target, true));
-    CHECK( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == target);
 
     //check prediction on 01 sequence
     bp->update( BPInterface( PC, false, target, true));
     bp->update( BPInterface( PC, true, target, true));
-    CHECK_FALSE( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == PC + 4);
+    CHECK_FALSE( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == PC + 4);
 
     //check prediction on 10 sequence
     bp->update( BPInterface( PC, true, target, true));
     bp->update( BPInterface( PC, false, target, true));
-    CHECK_FALSE( bp->is_taken(PC) );
-    CHECK( bp->get_target(PC) == PC + 4);
+    CHECK_FALSE( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PC).target == PC + 4);
 }
 
 TEST_CASE( "Adaptive two bit prediction in case of changed target")
@@ -234,7 +235,7 @@ TEST_CASE( "Adaptive two bit prediction in case of changed target")
     //check if the target was updated
     bp->update( BPInterface( PC, false, target, true));
     bp->update( BPInterface( PC, false, target, true));
-    CHECK( bp->get_target(PC) == target);
+    CHECK( bp->get_bp_info( PC).target == target);
 }
 
 TEST_CASE( "Cache Miss")
@@ -243,20 +244,20 @@ TEST_CASE( "Cache Miss")
 
     // Check default cache miss behaviour
     Addr PC = 12;
-    CHECK_FALSE( bp->is_hit( PC));
-    CHECK_FALSE( bp->is_taken( PC));
+    CHECK_FALSE( bp->get_bp_info( PC).is_hit);
+    CHECK_FALSE( bp->get_bp_info( PC).is_taken);
 
     PC = 16;
-    CHECK_FALSE( bp->is_hit( PC));
-    CHECK_FALSE( bp->is_taken( PC));
+    CHECK_FALSE( bp->get_bp_info( PC).is_hit);
+    CHECK_FALSE( bp->get_bp_info( PC).is_taken);
 
     PC = 20;
-    CHECK_FALSE( bp->is_hit( PC));
-    CHECK_FALSE( bp->is_taken( PC));
+    CHECK_FALSE( bp->get_bp_info( PC).is_hit);
+    CHECK_FALSE( bp->get_bp_info( PC).is_taken);
 
     PC = 12;
-    CHECK_FALSE( bp->is_hit( PC));
-    CHECK_FALSE( bp->is_taken( PC));
+    CHECK_FALSE( bp->get_bp_info( PC).is_hit);
+    CHECK_FALSE( bp->get_bp_info( PC).is_taken);
 }
 
 TEST_CASE( "Overload: LRU")
@@ -271,12 +272,281 @@ TEST_CASE( "Overload: LRU")
     {
         bp->update( BPInterface( i, false, NO_VAL32, false));
         if ( i % 50 == 0)
-            bp->update( BPInterface( PCconst, true, target, bp->is_hit( PCconst)));
+            bp->update( BPInterface( PCconst, true, target, bp->get_bp_info( PCconst).is_hit));
     }
 
     // Checking some random PC and PCConst
     Addr PC = 4;
-    CHECK_FALSE( bp->is_taken(PC) );
-    CHECK( bp->is_taken(PCconst) );
-    CHECK( bp->get_target(PCconst) == target);
+    CHECK_FALSE( bp->get_bp_info( PC).is_taken);
+    CHECK( bp->get_bp_info( PCconst).is_taken);
+    CHECK( bp->get_bp_info( PCconst).target == target);
+}
+
+TEST_CASE( "Global history: wrong parameters")
+{
+    CHECK_THROWS_AS( BaseBP::create_bp( "gshare", "LRU", 128, 16, 32, BPParameters{ 1000, 12, { 4, 8}}), BPInvalidMode);
+    CHECK_THROWS_AS( BaseBP::create_bp( "perceptron", "LRU", 128, 16, 32, BPParameters{ 1024, 65, { 4, 8}}), BPInvalidMode);
+    CHECK_THROWS_AS( BaseBP::create_bp( "tage", "LRU", 128, 16, 32, BPParameters{ 1024, 12, { 8, 4}}), BPInvalidMode);
+    CHECK_THROWS_AS( BaseBP::create_bp( "tage", "LRU", 100, 20, 32), BPInvalidMode);
+}
+
+// Simulates fetch and branch stages, returns true on misprediction
+static bool run_branch( BaseBP* bp, Addr PC, Addr target, bool is_taken)
+{
+    const auto prediction = bp->predict( PC);
+    BPInterface bp_upd( PC, is_taken, target, true);
+    bp_upd.history = prediction.history;
+    bp_upd.is_in_history = prediction.is_in_history;
+    bp->update( bp_upd);
+
+    const bool is_misprediction = prediction.is_taken != is_taken;
+    if ( is_misprediction)
+        bp->repair( bp_upd);
+
+    return is_misprediction;
+}
+
+TEST_CASE( "Global history: alternating branch")
+{
+    const auto mode = GENERATE( as<std::string>{}, "gshare", "tage", "perceptron");
+    auto bp = BaseBP::create_bp( mode, "LRU", 128, 16, 32);
+
+    for ( int i = 0; i < 200; ++i)
+        run_branch( bp.get(), 0x100, 0x80, i % 2 == 0);
+
+    int mispredictions = 0;
+    for ( int i = 0; i < 100; ++i)
+        mispredictions += run_branch( bp.get(), 0x100, 0x80, i % 2 == 0) ? 1 : 0;
+
+    CHECK( mispredictions == 0);
+}
+
+TEST_CASE( "Global history: loop exit is correlated with other branches")
+{
+    const auto mode = GENERATE( as<std::string>{}, "gshare", "tage", "perceptron");
+    auto bp = BaseBP::create_bp( mode, "LRU", 128, 16, 32);
+
+    // the inner loop of 4 iterations and a branch after it
+    const auto run_iteration = [&bp]() {
+        int mispredictions = 0;
+        for ( int j = 0; j < 4; ++j)
+            mispredictions += run_branch( bp.get(), 0x200, 0x1f0, j != 3) ? 1 : 0;
+        mispredictions += run_branch( bp.get(), 0x220, 0x180, true) ? 1 : 0;
+        return mispredictions;
+    };
+
+    for ( int i = 0; i < 300; ++i)
+        run_iteration();
+
+    int mispredictions = 0;
+    for ( int i = 0; i < 50; ++i)
+        mispredictions += run_iteration();
+
+    CHECK( mispredictions == 0);
+}
+
+TEST_CASE( "Global history: speculative update and repair")
+{
+    auto bp = BaseBP::create_bp( "gshare", "LRU", 128, 16, 32);
+    bp->update( BPInterface( 0x100, true, 0x80, true));
+
+    // BTB misses do not update history
+    CHECK( bp->predict( 0x300).history == 0);
+    CHECK( bp->predict( 0x300).history == 0);
+
+    const auto first = bp->predict( 0x100);
+    const auto second = bp->predict( 0x100);
+    CHECK( second.history == ( ( first.history << 1U) | uint64{ first.is_taken}));
+
+    // Wrong path is removed from history
+    bp->predict( 0x100);
+    BPInterface bp_upd( 0x100, !first.is_taken, 0x80, true);
+    bp_upd.history = first.history;
+    bp->repair( bp_upd);
+    CHECK( bp->predict( 0x100).history == ( ( first.history << 1U) | uint64{ !first.is_taken}));
+}
+
+TEST_CASE( "Global history: repair of a branch missed in BTB")
+{
+    auto bp = BaseBP::create_bp( "gshare", "LRU", 128, 16, 32);
+    bp->update( BPInterface( 0x100, true, 0x80, true));
+    bp->predict( 0x100);
+
+    // the missed branch is mispredicted, the wrong path is fetched
+    const auto missed = bp->predict( 0x300);
+    CHECK_FALSE( missed.is_hit);
+    CHECK_FALSE( missed.is_in_history);
+    bp->predict( 0x100);
+
+    BPInterface bp_upd = missed;
+    bp_upd.is_taken = true;
+    bp_upd.target = 0x200;
+    bp->update( bp_upd);
+    bp->repair( bp_upd);
+    CHECK( bp->predict( 0x100).history == missed.history);
+}
+
+TEST_CASE( "Global history: static interface is consistent with predict")
+{
+    auto bp = BaseBP::create_bp( "tage", "LRU", 128, 16, 32);
+    for ( int i = 0; i < 10; ++i)
+        run_branch( bp.get(), 0x100, 0x80, true);
+
+    CHECK( bp->get_bp_info( 0x100).is_hit);
+    CHECK( bp->get_bp_info( 0x100).is_taken);
+    CHECK( bp->get_bp_info( 0x100).target == 0x80);
+    CHECK( bp->predict( 0x100).target == 0x80);
+    CHECK_FALSE( bp->get_bp_info( 0x104).is_hit);
+    CHECK( bp->get_bp_info( 0x104).target == 0x108);
+}
+
+TEST_CASE( "Global history: cold TAGE falls back to the bimodal table")
+{
+    TAGE tage( 128, { 4, 8});
+
+    // these branches have zero tags with empty history
+    for ( Addr PC = 0; PC < 0x4000; PC += 0x800)
+        CHECK_FALSE( tage.is_taken( PC, 0));
+}
+
+TEST_CASE( "Return address stack: push and pop")
+{
+    ReturnAddressStack ras( 2);
+    CHECK( ras.empty());
+    ras.push( 0x10);
+    ras.push( 0x20);
+    ras.push( 0x30); // overwrites the oldest entry
+    CHECK( ras.pop() == 0x30);
+    CHECK( ras.pop() == 0x20);
+    CHECK( ras.empty());
+    CHECK( ras.pop() == NO_VAL32);
+}
+
+TEST_CASE( "Return address stack: repair")
+{
+    ReturnAddressStack ras( 4);
+    ras.push( 0x10);
+    ras.push( 0x20);
+    const auto checkpoint = ras.get_checkpoint();
+
+    // wrong path pops and overwrites the top entry
+    ras.pop();
+    ras.push( 0x50);
+    ras.push( 0x60);
+
+    ras.restore( checkpoint);
+    CHECK( ras.pop() == 0x20);
+    CHECK( ras.pop() == 0x10);
+    CHECK( ras.empty());
+}
+
+TEST_CASE( "Return address stack: calls and returns")
+{
+    auto bp = BaseBP::create_bp( "saturating_two_bits", "LRU", 128, 16, 32);
+
+    // recursion of depth 3
+    for ( Addr call : { 0x100, 0x204, 0x204})
+        CHECK( bp->predict( call, BranchType::CALL, call + 4).ras.size > 0);
+
+    const auto first = bp->predict( 0x300, BranchType::RETURN);
+    CHECK( first.is_hit);
+    CHECK( first.is_taken);
+    CHECK( first.target == 0x208);
+
+    // wrong path after the mispredicted return
+    bp->predict( 0x300, BranchType::RETURN);
+    bp->predict( 0x400, BranchType::CALL, 0x404);
+
+    BPInterface bp_upd = first;
+    bp_upd.is_taken = true;
+    bp->repair( bp_upd);
+    CHECK( bp->predict( 0x300, BranchType::RETURN).target == 0x208);
+    CHECK( bp->predict( 0x300, BranchType::RETURN).target == 0x104);
+    CHECK_FALSE( bp->predict( 0x300, BranchType::RETURN).is_hit);
+}
+
+TEST_CASE( "Return address stack: fetch repeated during decode stall")
+{
+    auto bp = BaseBP::create_bp( "saturating_two_bits", "LRU", 128, 16, 32);
+    bp->predict( 0x100, BranchType::CALL, 0x104, 1);
+    for ( int i = 0; i < 3; ++i)
+        CHECK( bp->predict( 0x100, BranchType::CALL, 0x104, 1).ras.size == 1);
+    CHECK( bp->predict( 0x200, BranchType::NONE, NO_VAL32, 2).ras.size == 1);
+
+    const auto ret = bp->predict( 0x300, BranchType::RETURN, NO_VAL32, 3);
+    CHECK( ret.target == 0x104);
+    for ( int i = 0; i < 3; ++i)
+        CHECK( bp->predict( 0x300, BranchType::RETURN, NO_VAL32, 3).ras.size == 0);
+    CHECK( bp->predict( 0x104, BranchType::NONE, NO_VAL32, 4).history == ( ( ret.history << 1U) | 1U));
+}
+
+TEST_CASE( "Indirect target cache: targets correlated with history")
+{
+    auto bp = BaseBP::create_bp( "saturating_two_bits", "LRU", 128, 16, 32);
+
+    // the target of the jump depends on the branch before it
+    const auto run_jump = [&bp]( bool is_taken) {
+        const auto prediction = bp->predict( 0x100, BranchType::BRANCH);
+        BPInterface branch_upd = prediction;
+        branch_upd.is_taken = is_taken;
+        branch_upd.target = 0x200;
+        bp->update( branch_upd);
+        if ( prediction.is_taken != is_taken)
+            bp->repair( branch_upd);
+
+        const Addr target = is_taken ? 0x800 : 0x900;
+        auto jump = bp->predict( 0x300, BranchType::INDIRECT_JUMP);
+        const bool is_misprediction = !jump.is_hit || jump.target != target;
+        jump.is_taken = true;
+        jump.target = target;
+        bp->update( jump);
+        if ( is_misprediction)
+            bp->repair( jump);
+        return is_misprediction;
+    };
+
+    for ( int i = 0; i < 30; ++i)
+        run_jump( i % 3 == 0);
+
+    int mispredictions = 0;
+    for ( int i = 0; i < 30; ++i)
+        mispredictions += run_jump( i % 3 == 0) ? 1 : 0;
+
+    CHECK( mispredictions == 0);
+}
+
+TEST_CASE( "Indirect target cache: wrong parameters")
+{
+    CHECK_THROWS_AS( BaseBP::create_bp( "saturating_two_bits", "LRU", 128, 16, 32, BPParameters{ 4096, 12, { 4}, 16, 100, 8}), BPInvalidMode);
+}
+
+TEST_CASE( "Single probe lookup is consistent with the entry")
+{
+    const auto mode = GENERATE( as<std::string>{}, "always_taken", "backward_jumps", "saturating_two_bits",
+                                "adaptive_two_levels", "gshare", "tage", "perceptron");
+    auto bp = BaseBP::create_bp( mode, "LRU", 128, 16, 32);
+    for ( int i = 0; i < 4; ++i)
+        bp->update( BPInterface( 0x100, true, 0x80, true));
+
+    const auto info = bp->get_bp_info( 0x100);
+    CHECK( info.is_hit);
+    CHECK( info.is_taken);
+    CHECK( info.target == 0x80);
+
+    const auto miss = bp->get_bp_info( 0x104);
+    CHECK_FALSE( miss.is_hit);
+    CHECK_FALSE( miss.is_taken);
+    CHECK( miss.target == 0x108);
+}
+
+TEST_CASE( "Infinite BTB")
+{
+    auto bp = BaseBP::create_bp( "saturating_one_bit", "infinite", 128, 16, 32);
+    for ( Addr PC = 0; PC < 4096; PC += 4)
+        bp->update( BPInterface( PC, true, PC + 0x100, true));
+
+    for ( Addr PC = 0; PC < 4096; PC += 4) {
+        CHECK( bp->get_bp_info( PC).is_taken);
+        CHECK( bp->get_bp_info( PC).target == PC + 0x100);
+    }
 }
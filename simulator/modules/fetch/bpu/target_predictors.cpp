@@ -0,0 +1,81 @@
+/*
+ * target_predictors.cpp - predictors of return and indirect jump targets
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#include "target_predictors.h"
+
+#include <infra/macro.h>
+
+#include <algorithm>
+#include <bit>
+
+void ReturnAddressStack::push( Addr return_address)
+{
+    if ( entries.empty())
+        return;
+
+    entries[ top] = return_address;
+    top = narrow_cast<uint32>( ( top + 1) % entries.size());
+    size = std::min<uint32>( size + 1, narrow_cast<uint32>( entries.size()));
+}
+
+Addr ReturnAddressStack::pop()
+{
+    if ( empty())
+        return NO_VAL32;
+
+    top = narrow_cast<uint32>( ( top + entries.size() - 1) % entries.size());
+    --size;
+    return entries[ top];
+}
+
+RASCheckpoint ReturnAddressStack::get_checkpoint() const
+{
+    if ( empty())
+        return RASCheckpoint{ top, size, NO_VAL32};
+
+    const auto last = narrow_cast<uint32>( ( top + entries.size() - 1) % entries.size());
+    return RASCheckpoint{ top, size, entries[ last]};
+}
+
+void ReturnAddressStack::restore( const RASCheckpoint& checkpoint)
+{
+    top = checkpoint.top;
+    size = checkpoint.size;
+    if ( !empty())
+        entries[ ( top + entries.size() - 1) % entries.size()] = checkpoint.entry;
+}
+
+IndirectTargetCache::IndirectTargetCache( uint32 size_in_entries, uint32 history_length)
+    : entries( size_in_entries)
+    , history_length( history_length)
+{ }
+
+size_t IndirectTargetCache::get_index( Addr PC, uint64 history) const
+{
+    const auto index_bits = narrow_cast<uint32>( std::countr_zero( entries.size()));
+    auto hash = PC >> 2U;
+    for ( auto value = history & bitmask<uint64>( history_length); value != 0; value >>= index_bits)
+        hash ^= value;
+
+    return narrow_cast<size_t>( hash & ( entries.size() - 1));
+}
+
+std::pair<bool, Addr> IndirectTargetCache::predict( Addr PC, uint64 history) const
+{
+    if ( entries.empty())
+        return { false, NO_VAL32};
+
+    const auto& entry = entries[ get_index( PC, history)];
+    if ( entry.pc != PC)
+        return { false, NO_VAL32};
+
+    return { true, entry.target};
+}
+
+void IndirectTargetCache::update( Addr PC, uint64 history, Addr target)
+{
+    if ( !entries.empty())
+        entries[ get_index( PC, history)] = Entry{ PC, target};
+}
@@ -0,0 +1,59 @@
+/*
+ * target_predictors.h - predictors of return and indirect jump targets
+ * Copyright 2021 MIPT-MIPS
+ */
+
+#ifndef TARGET_PREDICTORS_H
+#define TARGET_PREDICTORS_H
+
+#include "bp_interface.h"
+
+#include <utility>
+#include <vector>
+
+/*
+ * Circular return address stack. An overflow overwrites the oldest entry.
+ * A checkpoint keeps the top pointer and the top entry,
+ * which is enough to repair the stack after a wrong path.
+ */
+class ReturnAddressStack
+{
+public:
+    explicit ReturnAddressStack( uint32 depth) : entries( depth) { }
+
+    bool empty() const noexcept { return size == 0; }
+    void push( Addr return_address);
+    Addr pop();
+
+    RASCheckpoint get_checkpoint() const;
+    void restore( const RASCheckpoint& checkpoint);
+
+private:
+    std::vector<Addr> entries;
+    uint32 top = 0;  // index of the next free entry
+    uint32 size = 0;
+};
+
+/* Targets of indirect jumps indexed by PC hashed with global history */
+class IndirectTargetCache
+{
+public:
+    IndirectTargetCache( uint32 size_in_entries, uint32 history_length);
+
+    // Returns true and the target if the jump is known
+    std::pair<bool, Addr> predict( Addr PC, uint64 history) const;
+    void update( Addr PC, uint64 history, Addr target);
+
+private:
+    size_t get_index( Addr PC, uint64 history) const;
+
+    struct Entry
+    {
+        Addr pc = NO_VAL32;
+        Addr target = NO_VAL32;
+    };
+    std::vector<Entry> entries;
+    uint32 history_length;
+};
+
+#endif // TARGET_PREDICTORS_H
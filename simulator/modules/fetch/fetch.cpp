@@ -3,18 +3,8 @@
  * Copyright 2015-2018 MIPT-MIPS
  */
 
-#include <infra/config/config.h>
-
 #include "fetch.h"
 
-namespace config {
-    /* Cache parameters */
-    static const Value<std::string> instruction_cache_type = { "icache-type", "LRU", "Type of instruction level 1 cache (in bytes)"};
-    static const Value<uint32> instruction_cache_size = { "icache-size", 2048, "Size of instruction level 1 cache (in bytes)"};
-    static const Value<uint32> instruction_cache_ways = { "icache-ways", 4, "Amount of ways in instruction level 1 cache"};
-    static const Value<uint32> instruction_cache_line_size = { "icache-line-size", 64, "Line size of instruction level 1 cache (in bytes)"};
-} // namespace config
-
 template <typename FuncInstr>
 Fetch<FuncInstr>::Fetch( Module* parent) : Module( parent, "fetch")
 {
@@ -34,7 +24,7 @@ Fetch<FuncInstr>::Fetch( Module* parent) : Module( parent, "fetch")
     rp_bp_update = make_read_port<BPInterface>("BRANCH_2_FETCH", Port::LATENCY);
 
     wp_long_latency_pc_holder = make_write_port<Target>("LONG_LATENCY_PC_HOLDER", Port::BW);
-    rp_long_latency_pc_holder = make_read_port<Target>("LONG_LATENCY_PC_HOLDER", Port::LONG_LATENCY);
+    rp_long_latency_pc_holder = make_read_port<Target>("LONG_LATENCY_PC_HOLDER", Port::LATENCY);
 
     wp_hit_or_miss = make_write_port<bool>("HIT_OR_MISS", Port::BW);
     rp_hit_or_miss = make_read_port<bool>("HIT_OR_MISS", Port::LATENCY);
@@ -44,13 +34,16 @@ Fetch<FuncInstr>::Fetch( Module* parent) : Module( parent, "fetch")
     rp_flush_target_from_decode = make_read_port<Target>("DECODE_2_FETCH_TARGET", Port::LATENCY);
 
     bp = BaseBP::create_configured_bp();
-    tags = CacheTagArray::create(
-        config::instruction_cache_type,
-        config::instruction_cache_size,
-        config::instruction_cache_ways,
-        config::instruction_cache_line_size,
-        32
-    );
+    for ( auto& [name, description, formula] : bp->get_statistics_formulas())
+        make_formula( name, std::move( description), std::move( formula));
+}
+
+template <typename FuncInstr>
+void Fetch<FuncInstr>::set_cache_hierarchy( CacheHierarchy* value)
+{
+    caches = value;
+    for ( auto& [name, description, formula] : caches->get_l1i().get_statistics_formulas())
+        make_formula( "l1i." + name, std::move( description), std::move( formula));
 }
 
 template <typename FuncInstr>
@@ -89,43 +82,51 @@ Target Fetch<FuncInstr>::get_target( Cycle cycle)
 template <typename FuncInstr>
 void Fetch<FuncInstr>::clock_bp( Cycle cycle)
 {
-    /* Process BP updates */
-    if ( rp_bp_update->is_ready( cycle))
-        bp->update( rp_bp_update->read( cycle));
+    /* Process BP updates, decode sends them only on mispredictions.
+     * Branch is older than decode, so its repair is applied the last. */
     if ( rp_bp_update_from_decode->is_ready( cycle))
-        bp->update( rp_bp_update_from_decode->read(cycle));
+    {
+        const auto bp_upd = rp_bp_update_from_decode->read( cycle);
+        bp->update( bp_upd);
+        bp->repair( bp_upd);
+    }
+    if ( rp_bp_update->is_ready( cycle))
+    {
+        const auto bp_upd = rp_bp_update->read( cycle);
+        bp->update( bp_upd);
+        if ( rp_flush_target->is_ready( cycle))
+            bp->repair( bp_upd);
+    }
 }
 
 template <typename FuncInstr>
 void Fetch<FuncInstr>::clock_instr_cache( Cycle cycle)
 {
-    if( rp_long_latency_pc_holder->is_ready( cycle))
+    /* PC circulates in the long-latency port until the line is filled */
+    auto target = rp_long_latency_pc_holder->read( cycle);
+    if ( caches->get_cycle() >= fill_cycle)
     {
-        /* get PC from long-latency port if it's possible */
-        auto target = rp_long_latency_pc_holder->read( cycle);
-
-        /* write new PC to tags array */
-        tags->write( target.address);
-
         /* save PC to the next stage */
         wp_hold_pc->write( target, cycle);
         return;
     }
+    wp_long_latency_pc_holder->write( target, cycle);
     wp_hit_or_miss->write( false, cycle);
+    cpi_stack->set_frontend_stall( target.address, CpiComponent::ICACHE_MISS);
 }
 
 template <typename FuncInstr>
 void Fetch<FuncInstr>::save_flush( Cycle cycle)
 {
-    /* save PC in the case of flush signal */
-    if( rp_flush_target->is_ready( cycle))
+    /* save PC in the case of flush signal, a trap is older than any branch */
+    if( rp_external_target->is_ready( cycle))
+        wp_target->write( rp_external_target->read( cycle), cycle);
+    else if( rp_flush_target->is_ready( cycle))
         wp_target->write( rp_flush_target->read( cycle), cycle);
     else if( rp_flush_target_from_decode->is_ready( cycle))
         wp_target->write( rp_flush_target_from_decode->read( cycle), cycle);
     else if( rp_target->is_ready( cycle))
         wp_target->write( rp_target->read( cycle), cycle);
-    else if( rp_external_target->is_ready( cycle))
-        wp_target->write( rp_external_target->read( cycle), cycle);
 }
 
 template <typename FuncInstr>
@@ -147,13 +148,15 @@ Target Fetch<FuncInstr>::get_cached_target( Cycle cycle)
         return Target();
 
     /* hit or miss */
-    auto is_hit = tags->lookup( target.address);
+    const auto access = caches->access_instruction( target.address);
 
-    if ( is_hit)
+    if ( access.is_hit)
         return target;
 
     /* send miss to the next cycle */
-    wp_hit_or_miss->write( is_hit, cycle);
+    fill_cycle = access.ready;
+    cpi_stack->set_frontend_stall( target.address, CpiComponent::ICACHE_MISS);
+    wp_hit_or_miss->write( access.is_hit, cycle);
 
     /* send PC to cache*/
     wp_long_latency_pc_holder->write( target, cycle);
@@ -161,6 +164,24 @@ Target Fetch<FuncInstr>::get_cached_target( Cycle cycle)
 }
 
 
+// Predecoding of control transfer instructions
+template <typename FuncInstr>
+static BranchType get_branch_type( const FuncInstr& instr)
+{
+    if ( instr.is_call())
+        return instr.is_indirect_jump() ? BranchType::INDIRECT_CALL : BranchType::CALL;
+    if ( instr.is_return())
+        return BranchType::RETURN;
+    if ( instr.is_indirect_jump())
+        return BranchType::INDIRECT_JUMP;
+    if ( instr.is_direct_jump())
+        return BranchType::JUMP;
+    if ( instr.is_branch())
+        return BranchType::BRANCH;
+
+    return BranchType::NONE;
+}
+
 template <typename FuncInstr>
 void Fetch<FuncInstr>::clock( Cycle cycle)
 {
@@ -176,8 +197,10 @@ void Fetch<FuncInstr>::clock( Cycle cycle)
     /* hold PC for the stall case */
     wp_hold_pc->write( target, cycle);
 
-    auto bp_info = bp->get_bp_info( target.address);
-    Instr instr( memory->fetch_instr( target.address), bp_info);
+    auto func_instr = memory->fetch_instr( target.address);
+    const auto return_address = target.address + 4 * ( 1 + func_instr.get_delayed_slots());
+    auto bp_info = bp->predict( target.address, get_branch_type( func_instr), return_address, target.sequence_id);
+    Instr instr( std::move( func_instr), bp_info);
     instr.set_sequence_id( target.sequence_id);
 
     /* set next target according to prediction */
@@ -9,7 +9,8 @@
 #include "bpu/bpu.h"
 
 #include <func_sim/instr_memory.h>
-#include <infra/cache/cache_tag_array.h>
+#include <infra/cache/cache_hierarchy.h>
+#include <modules/core/cpi_stack.h>
 #include <modules/core/perf_instr.h>
 #include <modules/ports_instance.h>
  
@@ -25,11 +26,15 @@ public:
     {
         memory = std::move( mem);
     }
+    void set_cache_hierarchy( CacheHierarchy* value);
+    void set_cpi_stack( CpiStack* value) { cpi_stack = value; }
 
 private:
     std::unique_ptr<InstrMemoryIface<FuncInstr>> memory = nullptr;
     std::unique_ptr<BaseBP> bp = nullptr;
-    std::unique_ptr<CacheTagArray> tags = nullptr;
+    CacheHierarchy* caches = nullptr;
+    CpiStack* cpi_stack = nullptr;
+    Cycle fill_cycle = 0_cl;
     
     /* Input signals */
     ReadPort<bool>* rp_stall = nullptr;
@@ -1,17 +1,23 @@
+/**
+ * late_alu.h - Simulation of late ALU stages
+ * Copyright 2021 MIPT-MIPS
+ */
+
 #ifndef MIPT_MIPS_LATE_ALU_H
 #define MIPT_MIPS_LATE_ALU_H
 
 #include <func_sim/operation.h>
-#include <infra/config/config.h>
+#include <func_sim/rf/rf.h>
 #include <modules/core/perf_instr.h>
 #include <modules/decode/bypass/data_bypass_interface.h>
 #include <modules/ports_instance.h>
-#include <func_sim/rf/rf.h>
 
-namespace config {
-    extern const PredicatedValue<uint64> long_late_alu_latency;
-} // namespace config
+#include <vector>
 
+/*
+ * Each late ALU stage executes instructions steered to its clusters,
+ * and passes results of the previous stages to the next one
+ */
 template <typename FuncInstr>
 class Late_alu : public Module
 {
@@ -22,40 +28,30 @@ class Late_alu : public Module
 
 private:
     static constexpr const uint8 SRC_REGISTERS_NUM = 2;
-    const Latency last_execution_stage_latency;
+    const uint32 stage;
 
     /* Inputs */
     ReadPort<Instr>* rp_datapath = nullptr;
-    ReadPort<Instr>* rp_long_latency_execution_unit = nullptr;
     ReadPort<bool>* rp_flush = nullptr;
     ReadPort<bool>* rp_trap = nullptr;
 
     struct BypassPorts {
         ReadPort<BypassCommand<Register>>* command_port;
-        std::array<ReadPort<InstructionOutput>*, RegisterStage::BYPASSING_STAGES_NUMBER> data_ports;
+        std::vector<ReadPort<InstructionOutput>*> data_ports;
     };
     std::array<BypassPorts, SRC_REGISTERS_NUM> rps_bypass;
 
     /* Outputs */
-    WritePort<Instr>* wp_mem_datapath = nullptr;
-    WritePort<Instr>* wp_branch_datapath = nullptr;
-    WritePort<Instr>* wp_writeback_datapath = nullptr;
-    WritePort<Instr>* wp_long_latency_execution_unit = nullptr;
+    WritePort<Instr>* wp_datapath = nullptr;
     WritePort<InstructionOutput>* wp_bypass = nullptr;
-    WritePort<InstructionOutput>* wp_long_arithmetic_bypass = nullptr;
     RF<FuncInstr>* rf = nullptr;
-    Latency flush_expiration_latency = 0_lt;
 
-    void save_flush() { flush_expiration_latency = last_execution_stage_latency; }
-    void clock_saved_flush()
-    {
-        if ( flush_expiration_latency != 0_lt)
-            flush_expiration_latency = flush_expiration_latency - 1_lt;
-    }
-    auto has_flush_expired() const { return flush_expiration_latency == 0_lt; }
+    Counter* num_executed = nullptr;
+
+    void read_sources( Instr* instr, Cycle cycle);
 
 public:
-    explicit Late_alu( Module* parent);
+    Late_alu( Module* parent, uint32 stage, uint32 last_stage);
     void clock( Cycle cycle);
     void set_RF(RF<FuncInstr>* value)
     {
@@ -16,6 +16,19 @@ Mem<FuncInstr>::Mem( Module* parent) : Module( parent, "mem")
     rp_flush = make_read_port<bool>("BRANCH_2_ALL_FLUSH", Port::LATENCY);
 
     wp_bypass = make_write_port<InstructionOutput>("MEMORY_2_EXECUTE_BYPASS", Port::BW);
+    wp_stall = make_write_port<uint64>("MEMORY_2_CORE_STALL", Port::BW);
+
+    num_loads = make_counter( "loads", "");
+    num_stores = make_counter( "stores", "");
+    num_stalls = make_counter( "stalls", "accesses freezing the pipeline on a data cache miss");
+}
+
+template <typename FuncInstr>
+void Mem<FuncInstr>::set_cache_hierarchy( CacheHierarchy* value)
+{
+    caches = value;
+    for ( auto& [name, description, formula] : caches->get_l1d().get_statistics_formulas())
+        make_formula( "l1d." + name, std::move( description), std::move( formula));
 }
 
 template <typename FuncInstr>
@@ -44,6 +57,22 @@ void Mem<FuncInstr>::clock( Cycle cycle)
 
     /* perform required loads and stores */
     memory->load_store( &instr);
+
+    /* loads wait for the data, stores wait for a free MSHR only */
+    if ( instr.is_load() || instr.is_store())
+    {
+        ++*( instr.is_load() ? num_loads : num_stores);
+        const auto access = caches->access_data( instr.get_PC(), instr.get_mem_addr(), instr.is_store());
+        const auto wait = instr.is_load() ? access.ready - caches->get_cycle() - 1_lt
+                                          : access.issue - caches->get_cycle();
+        if ( wait > 0_lt)
+        {
+            sout << "data cache miss, ";
+            ++*num_stalls;
+            wp_stall->write( wait.to_size_t(), cycle);
+            cpi_stack->set_dcache_miss( instr.get_PC());
+        }
+    }
     
     /* bypass data */
     wp_bypass->write( instr.get_v_dst(), cycle);
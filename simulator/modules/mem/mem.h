@@ -8,6 +8,8 @@
 #define MEM_H
 
 #include <func_sim/operation.h>
+#include <infra/cache/cache_hierarchy.h>
+#include <modules/core/cpi_stack.h>
 #include <modules/core/perf_instr.h>
 #include <modules/ports_instance.h>
 
@@ -22,6 +24,8 @@ class Mem : public Module
     
     private:
         std::shared_ptr<FuncMemory> memory;
+        CacheHierarchy* caches = nullptr;
+        CpiStack* cpi_stack = nullptr;
 
         WritePort<Instr>* wp_datapath = nullptr;
         ReadPort<Instr>* rp_datapath = nullptr;
@@ -30,11 +34,18 @@ class Mem : public Module
         ReadPort<bool>* rp_trap = nullptr;
 
         WritePort<InstructionOutput>* wp_bypass = nullptr;
+        WritePort<uint64>* wp_stall = nullptr;
+
+        Counter* num_loads = nullptr;
+        Counter* num_stores = nullptr;
+        Counter* num_stalls = nullptr;
 
     public:
         explicit Mem( Module* parent);
         void clock( Cycle cycle);
         void set_memory( const std::shared_ptr<FuncMemory>& mem) { memory = mem; }
+        void set_cache_hierarchy( CacheHierarchy* value);
+        void set_cpi_stack( CpiStack* value) { cpi_stack = value; }
 };
 
 
@@ -7,31 +7,361 @@
 #include "checker.h"
 #include <kernel/kernel.h>
 
+#include <algorithm>
 #include <sstream>
 
+namespace config {
+    static const Value<uint64> check_period = { "check-period", 1, "compare hashes of checker and performance simulator states every N instructions, 1 is lockstep checking"};
+} // namespace config
+
+// Kernels read the primary model only, replicas just receive writes
+template<typename ISA>
+class CheckerCPU : public CPUModel
+{
+public:
+    CheckerCPU( Checker<ISA>* checker, std::shared_ptr<FuncSim<ISA>> sim) : checker( checker), sim( std::move( sim)) { }
+
+    void set_target( const Target& target) final { checker->push( typename Checker<ISA>::SetTarget{ target}); }
+    Addr get_pc() const final { return sim->get_pc(); }
+    std::string_view get_isa() const final { return sim->get_isa(); }
+    size_t sizeof_register() const final { return sim->sizeof_register(); }
+    size_t max_cpu_register() const final { return sim->max_cpu_register(); }
+    uint64 read_cpu_register( size_t regno) const final { return sim->read_cpu_register( regno); }
+    uint64 read_gdb_register( size_t regno) const final { return sim->read_gdb_register( regno); }
+    uint64 read_csr_register( std::string_view name) const final { return sim->read_csr_register( name); }
+
+    void write_cpu_register( size_t regno, uint64 value) final
+    {
+        checker->push( typename Checker<ISA>::WriteCPURegister{ regno, value});
+    }
+
+    void write_gdb_register( size_t regno, uint64 value) final
+    {
+        checker->push( typename Checker<ISA>::WriteGDBRegister{ regno, value});
+    }
+
+    void write_csr_register( std::string_view name, uint64 value) final
+    {
+        checker->push( typename Checker<ISA>::WriteCSRRegister{ std::string( name), value});
+    }
+
+private:
+    Checker<ISA>* const checker;
+    const std::shared_ptr<FuncSim<ISA>> sim;
+};
+
+template<typename ISA>
+class CheckerMemory : public FuncMemory
+{
+public:
+    CheckerMemory( Checker<ISA>* checker, std::shared_ptr<FuncMemory> memory) : checker( checker), memory( std::move( memory)) { }
+
+    size_t memcpy_guest_to_host( std::byte* dst, Addr src, size_t size) const noexcept final
+    {
+        return memory->memcpy_guest_to_host( dst, src, size);
+    }
+
+    size_t memcpy_host_to_guest( Addr dst, const std::byte* src, size_t size) final
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic) Low level access
+        checker->push( typename Checker<ISA>::WriteMemory{ dst, std::vector<std::byte>( src, src + size)});
+        return size;
+    }
+
+    void duplicate_to( std::shared_ptr<WriteableMemory> target) const final { memory->duplicate_to( std::move( target)); }
+    std::string dump() const final { return memory->dump(); }
+    size_t strlen( Addr addr) const final { return memory->strlen( addr); }
+
+private:
+    Checker<ISA>* const checker;
+    const std::shared_ptr<FuncMemory> memory;
+};
+
+template <typename ISA>
+Checker<ISA>::Checker() : queue( 1024)
+{
+    set_period( config::check_period);
+}
+
+template <typename ISA>
+void Checker<ISA>::set_period( uint64 value)
+{
+    period = std::max<uint64>( value, 1);
+    if ( !is_hash_mode())
+        return;
+
+    perf_records.resize( 2 * period);
+    func_records.resize( period);
+}
+
+template <typename ISA>
+Checker<ISA>::~Checker()
+{
+    stop();
+}
+
 template <typename ISA>
 void Checker<ISA>::init( std::endian endian, Kernel* kernel, std::string_view isa)
 {
-    auto memory = FuncMemory::create_default_hierarchied_memory();
+    memory = FuncMemory::create_default_hierarchied_memory();
     sim = std::make_shared<FuncSim<ISA>>( endian, false, isa);
     sim->set_memory( memory);
-    kernel->add_replica_simulator( sim);
-    kernel->add_replica_memory( memory);
+    cpu_proxy = std::make_shared<CheckerCPU<ISA>>( this, sim);
+    memory_proxy = std::make_shared<CheckerMemory<ISA>>( this, memory);
+    thread = std::jthread( [this]( const std::stop_token& token) { consume( token); });
+    kernel->add_replica_simulator( cpu_proxy);
+    kernel->add_replica_memory( memory_proxy);
     active = true;
 }
 
+template <typename ISA>
+void Checker<ISA>::disable()
+{
+    stop();
+    active = false;
+}
+
+template <typename ISA>
+void Checker<ISA>::stop()
+{
+    if ( !thread.joinable())
+        return;
+
+    thread.request_stop();
+
+    // Wake up the consumer
+    pushed_events.fetch_add( 1);
+    pushed_events.notify_one();
+    thread.join();
+}
+
+template <typename ISA>
+void Checker<ISA>::push( Event&& event)
+{
+    if ( is_hash_mode())
+        push_advance();
+
+    enqueue( std::move( event));
+}
+
+template <typename ISA>
+void Checker<ISA>::enqueue( Event&& event)
+{
+    while ( !queue.try_push( std::move( event)))
+        std::this_thread::yield();
+
+    pushed_events.fetch_add( 1);
+    if ( consumer_sleeps.load())
+        pushed_events.notify_one();
+}
+
+template <typename ISA>
+void Checker<ISA>::push_advance()
+{
+    // Kernel and driver events are applied after the retired instructions
+    if ( advanced == retired)
+        return;
+
+    enqueue( Advance{ retired});
+    advanced = retired;
+}
+
+template <typename ISA>
+void Checker<ISA>::push_checkpoint()
+{
+    enqueue( Checkpoint{ retired, perf_hash.get()});
+    checkpointed = retired;
+    advanced = retired;
+}
+
+template <typename ISA>
+void Checker<ISA>::wait_for_records()
+{
+    // The ring is full if the checker lags behind by two periods
+    while ( retired - compared_position.load( std::memory_order_acquire) == perf_records.size()) {
+        rethrow_error();
+        std::this_thread::yield();
+    }
+}
+
+template <typename ISA>
+void Checker<ISA>::advance( uint64 position)
+{
+    while ( func_retired < position && func_error.empty()) {
+        try {
+            const auto instr = sim->step();
+            func_hash.add( instr);
+            func_records[ func_retired - func_checkpointed] = Record{ func_hash.get(), instr.get_PC(), instr.get_sequence_id()};
+        }
+        catch ( const Exception& e) {
+            func_error = e.what();
+            return;
+        }
+        ++func_retired;
+    }
+}
+
+template <typename ISA>
+void Checker<ISA>::compare( const Checkpoint& checkpoint)
+{
+    const auto start = func_checkpointed;
+    const auto count = checkpoint.position - start;
+    func_checkpointed = checkpoint.position;
+    if ( func_error.empty() && func_hash.get() == checkpoint.hash) {
+        compared_position.store( checkpoint.position, std::memory_order_release);
+        return;
+    }
+
+    const auto get_perf_record = [this, start]( size_t index) -> const Record& {
+        return perf_records[ ( start + index) % perf_records.size()];
+    };
+
+    // Hashes are cumulative, so they differ after the first divergent instruction;
+    // if the checker has failed, its last instruction is divergent
+    const auto compared = func_retired - start;
+    size_t first = 0;
+    size_t last = func_error.empty() ? count - 1 : compared;
+    while ( first < last) {
+        auto middle = first + ( last - first) / 2;
+        if ( get_perf_record( middle).hash == func_records[ middle].hash)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    const auto& perf_record = get_perf_record( first);
+    std::ostringstream oss;
+    oss << "State hash mismatch in instructions " << std::dec << start << " to " << checkpoint.position << std::endl
+        << "First divergent instruction: " << start + first << std::endl;
+    if ( first < compared) {
+        const auto& func_record = func_records[ first];
+        oss << "Checker: 0x" << std::hex << func_record.pc << ": {" << std::dec << func_record.sequence_id << "}" << std::endl;
+    }
+    else {
+        oss << "Checker: " << func_error;
+    }
+    oss << "PerfSim: 0x" << std::hex << perf_record.pc << ": {" << std::dec << perf_record.sequence_id << "}" << std::endl;
+
+    throw CheckerMismatch(oss.str());
+}
+
+template <typename ISA>
+void Checker<ISA>::consume( const std::stop_token& stop)
+{
+    static const constexpr size_t SPINS_BEFORE_SLEEP = 64;
+    uint64 processed = 0;
+    size_t spins = 0;
+    while ( !stop.stop_requested()) {
+        auto event = queue.try_pop();
+        if ( !event.has_value()) {
+            if ( ++spins < SPINS_BEFORE_SLEEP) {
+                std::this_thread::yield();
+                continue;
+            }
+            consumer_sleeps.store( true);
+            pushed_events.wait( processed);
+            consumer_sleeps.store( false);
+            spins = 0;
+            continue;
+        }
+
+        // Drain the stream after a failure, so the producer is never blocked
+        if ( !failed.load( std::memory_order_relaxed)) try {
+            process( &*event);
+        }
+        catch (...) {
+            error = std::current_exception();
+            failed.store( true, std::memory_order_release);
+        }
+        processed_events.store( ++processed, std::memory_order_release);
+        spins = 0;
+    }
+}
+
+template <typename ISA>
+void Checker<ISA>::process( Event* event)
+{
+    // Failed checker only waits for the checkpoint to report the divergence
+    if ( !func_error.empty() && !std::holds_alternative<Checkpoint>( *event))
+        return;
+
+    std::visit( [this]( auto& e) {
+        using T = std::decay_t<decltype( e)>;
+        if constexpr ( std::is_same_v<T, Step>) {
+            const auto func_dump = sim->step();
+            if ( func_dump.is_same_checker( e.instr))
+                return;
+
+            std::ostringstream oss;
+            oss << "Mismatch at sequence_id: " << std::dec << e.instr.get_sequence_id() << std::endl
+                << "Checker output: " << func_dump << std::endl
+                << "PerfSim output: " << e.instr   << std::endl;
+
+            throw CheckerMismatch(oss.str());
+        }
+        else if constexpr ( std::is_same_v<T, DriverStep>) {
+            sim->driver_step( e.instr);
+        }
+        else if constexpr ( std::is_same_v<T, SetTarget>) {
+            sim->set_target( e.target);
+        }
+        else if constexpr ( std::is_same_v<T, WriteCPURegister>) {
+            sim->write_cpu_register( e.regno, e.value);
+        }
+        else if constexpr ( std::is_same_v<T, WriteGDBRegister>) {
+            sim->write_gdb_register( e.regno, e.value);
+        }
+        else if constexpr ( std::is_same_v<T, WriteCSRRegister>) {
+            sim->write_csr_register( e.name, e.value);
+        }
+        else if constexpr ( std::is_same_v<T, WriteMemory>) {
+            memory->memcpy_host_to_guest( e.addr, e.data.data(), e.data.size());
+        }
+        else if constexpr ( std::is_same_v<T, Advance>) {
+            advance( e.position);
+        }
+        else if constexpr ( std::is_same_v<T, Checkpoint>) {
+            advance( e.position);
+            compare( e);
+        }
+    }, *event);
+}
+
+template <typename ISA>
+void Checker<ISA>::rethrow_error()
+{
+    if ( failed.load( std::memory_order_acquire))
+        std::rethrow_exception( error);
+}
+
+template <typename ISA>
+void Checker<ISA>::sync()
+{
+    if ( !active)
+        return;
+
+    if ( is_hash_mode() && retired != checkpointed)
+        push_checkpoint();
+
+    while ( processed_events.load( std::memory_order_acquire) != pushed_events.load() && !failed.load( std::memory_order_acquire))
+        std::this_thread::yield();
+
+    rethrow_error();
+}
+
 template <typename ISA>
 void Checker<ISA>::set_target( const Target& value)
 {
     if ( active)
-        sim->set_target( value);
+        push( SetTarget{ value});
 }
 
 template <typename ISA>
 void Checker<ISA>::driver_step( const FuncInstr& instr)
 {
-    if ( active)
-        sim->driver_step( instr);
+    // Driver does nothing for instructions without traps
+    if ( active && ( !is_hash_mode() || instr.has_trap()))
+        push( DriverStep{ instr});
 }
 
 template <typename ISA>
@@ -40,16 +370,18 @@ void Checker<ISA>::check( const FuncInstr& instr)
     if (!active)
         return;
 
-    const auto func_dump = sim->step();
-
-    if ( func_dump.is_same_checker(instr))
+    rethrow_error();
+    if ( !is_hash_mode()) {
+        enqueue( Step{ instr});
         return;
-    
-    std::ostringstream oss;
-    oss << "Checker output: " << func_dump << std::endl
-        << "PerfSim output: " << instr     << std::endl;
+    }
 
-    throw CheckerMismatch(oss.str());
+    wait_for_records();
+    perf_hash.add( instr);
+    perf_records[ retired % perf_records.size()] = Record{ perf_hash.get(), instr.get_PC(), instr.get_sequence_id()};
+    ++retired;
+    if ( retired - checkpointed == period)
+        push_checkpoint();
 }
 
 #include <mips/mips.h>
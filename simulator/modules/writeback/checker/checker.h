@@ -3,11 +3,21 @@
  * to check state of performance simulator
  * Copyright 2015-2019 MIPT-MIPS
  */
- 
+
 #ifndef CHECKER_H
 #define CHECKER_H
- 
+
 #include <func_sim/func_sim.h>
+#include <func_sim/operation.h>
+#include <infra/spsc_queue.h>
+
+#include <atomic>
+#include <bit>
+#include <exception>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
 
 struct CheckerMismatch final : Exception
 {
@@ -19,18 +29,147 @@ struct CheckerMismatch final : Exception
     { }
 };
 
+// Rolling hash of architectural effects of retired instructions
+class StateHash
+{
+public:
+    template<typename Instr>
+    void add( const Instr& instr)
+    {
+        mix( instr.get_PC());
+        for ( size_t i = 0; i < MAX_DST_NUM; ++i)
+            if ( !instr.get_dst( i).is_zero())
+                mix_value( instr.get_v_dst( i));
+
+        if ( instr.is_store()) {
+            mix( instr.get_mem_addr());
+            mix_value( instr.get_v_src( 1) & instr.get_mask());
+        }
+    }
+
+    uint64 get() const noexcept { return value; }
+
+private:
+    void mix( uint64 x) noexcept
+    {
+        value = ( std::rotl( value, 5) ^ x) * 0x9e37'79b9'7f4a'7c15ULL;
+    }
+
+    template<typename T>
+    void mix_value( const T& x)
+    {
+        mix( static_cast<uint64>( x));
+        if constexpr ( bitwidth<T> > 64)
+            mix( static_cast<uint64>( x >> 64));
+    }
+
+    uint64 value = 0;
+};
+
+/*
+ * Functional simulator of the checker is executed on a separate host thread.
+ * Retired instructions, driver steps and kernel writes to registers and memory
+ * are passed to that thread in program order through a single event stream.
+ * A mismatch is reported on the next call from the performance simulator,
+ * or by 'sync' which waits until all the events are checked.
+ *
+ * If the check period is greater than 1, instructions are not compared one by one.
+ * Both simulators compute a rolling hash of the retired instructions, and the hashes
+ * are compared at the end of each period. The functional simulator runs freely
+ * between the points where the kernel or the driver interact with it.
+ * On a mismatch, per-instruction hashes of the period are bisected
+ * to find the first divergent instruction. Records of the performance simulator
+ * are kept in a ring of two periods, so it fills the next period while the checker
+ * compares the previous one; the ring is allocated once when the period is set.
+ */
 template<typename ISA>
 class Checker {
     using FuncInstr = typename ISA::FuncInstr;
 public:
-    void disable() { active = false; }
+    Checker();
+    ~Checker();
+    Checker( const Checker&) = delete;
+    Checker( Checker&&) = delete;
+    Checker& operator=( const Checker&) = delete;
+    Checker& operator=( Checker&&) = delete;
+
+    void disable();
     void check( const FuncInstr& instr);
     void init( std::endian endian, Kernel* kernel, std::string_view isa);
     void set_target( const Target& value);
     void driver_step( const FuncInstr& instr);
+    void sync();
+    void set_period( uint64 value);
+
+    // Hash of the state after the instruction and the instruction itself
+    struct Record { uint64 hash; Addr pc; uint64 sequence_id; };
+
+    struct Step { FuncInstr instr; };
+    struct DriverStep { FuncInstr instr; };
+    struct SetTarget { Target target; };
+    struct WriteCPURegister { size_t regno; uint64 value; };
+    struct WriteGDBRegister { size_t regno; uint64 value; };
+    struct WriteCSRRegister { std::string name; uint64 value; };
+    struct WriteMemory { Addr addr; std::vector<std::byte> data; };
+    struct Advance { uint64 position; };
+    struct Checkpoint { uint64 position; uint64 hash; };
+    using Event = std::variant<std::monostate, Step, DriverStep, SetTarget,
+                               WriteCPURegister, WriteGDBRegister, WriteCSRRegister, WriteMemory,
+                               Advance, Checkpoint>;
+
+    void push( Event&& event);
+
 private:
+    void consume( const std::stop_token& stop);
+    void process( Event* event);
+    void stop();
+    void rethrow_error();
+
+    // Hash mode
+    bool is_hash_mode() const noexcept { return period > 1; }
+    void enqueue( Event&& event);
+    void push_advance();
+    void push_checkpoint();
+    void advance( uint64 position);
+    void compare( const Checkpoint& checkpoint);
+    void wait_for_records();
+
     std::shared_ptr<FuncSim<ISA>> sim;
+    std::shared_ptr<FuncMemory> memory;
+
+    // Kernel replicates its actions to these models, they push events to the stream
+    std::shared_ptr<CPUModel> cpu_proxy;
+    std::shared_ptr<FuncMemory> memory_proxy;
+
+    SPSCQueue<Event> queue;
+    std::jthread thread;
+    std::atomic<uint64> pushed_events = 0;
+    std::atomic<uint64> processed_events = 0;
+    std::atomic<bool> consumer_sleeps = false;
+    std::atomic<bool> failed = false;
+    std::exception_ptr error = nullptr;
     bool active = false;
+
+    uint64 period = 1;
+
+    // Hash mode, producer side
+    uint64 retired = 0;
+    uint64 advanced = 0;
+    uint64 checkpointed = 0;
+    StateHash perf_hash;
+    std::vector<Record> perf_records; // ring indexed by the number of retired instructions
+
+    // Hash mode, consumer side
+    uint64 func_retired = 0;
+    uint64 func_checkpointed = 0;
+    StateHash func_hash;
+    std::vector<Record> func_records;
+
+    // Records before this position are compared, so their slots may be reused
+    std::atomic<uint64> compared_position = 0;
+
+    // Checker stops if it fails on a divergent path, e.g. runs into nops
+    std::string func_error;
 };
 
 #endif // CHECKER_H
@@ -1,19 +1,23 @@
 #include "writeback.h"
 
 #include <kernel/kernel.h>
+#include <modules/decode/bypass/data_bypass_interface.h>
+#include <modules/execute/func_units.h>
 
 template <typename ISA>
 Writeback<ISA>::Writeback( Module* parent, std::endian endian) : Module( parent, "writeback"), endian( endian)
 {
     rp_mem_datapath = make_read_port<Instr>("MEMORY_2_WRITEBACK", Port::LATENCY);
-    rp_execute_datapath = make_read_port<Instr>("LATE_ALU_2_WRITEBACK", Port::LATENCY);
+    const auto last_alu_stage = AluClusters::create_configured().get_last_stage();
+    rp_execute_datapath = make_read_port<Instr>( get_alu_datapath_port_name( last_alu_stage, last_alu_stage), Port::LATENCY);
     rp_branch_datapath = make_read_port<Instr>("BRANCH_2_WRITEBACK", Port::LATENCY);
     rp_trap = make_read_port<bool>("WRITEBACK_2_ALL_FLUSH", Port::LATENCY);
-    rp_late_alu = make_read_port<Instr>("LATE_ALU_2_WRITEBACK", Port::LATENCY);
     wp_bypass = make_write_port<InstructionOutput>("WRITEBACK_2_EXECUTE_BYPASS", Port::BW);
     wp_halt = make_write_port<Trap>("WRITEBACK_2_CORE_HALT", Port::BW);
     wp_trap = make_write_port<bool>("WRITEBACK_2_ALL_FLUSH", Port::BW);
     wp_target = make_write_port<Target>("WRITEBACK_2_FETCH_TARGET", Port::BW);
+
+    executed_instrs = make_counter( "instrs", "retired instructions");
 }
 
 template <typename ISA>
@@ -47,19 +51,6 @@ void Writeback<ISA>::set_checker_target( const Target& value)
     checker.set_target( value);
 }
 
-template <typename ISA>
-auto Writeback<ISA>::read_instructions( Cycle cycle)
-{
-    auto ports = { rp_branch_datapath, rp_mem_datapath, rp_late_alu };
-    std::vector<Instr> result;
-
-    for ( auto& port : ports)
-        if ( port->is_ready( cycle))
-            result.emplace_back( port->read( cycle));
-
-    return result;
-}
-
 template <typename ISA>
 void Writeback<ISA>::clock( Cycle cycle)
 {
@@ -69,12 +60,19 @@ void Writeback<ISA>::clock( Cycle cycle)
         return;
     }
 
-    auto instrs = read_instructions( cycle);
+    // Ports are polled in place, so no container is allocated each cycle
+    bool has_instrs = false;
+    for ( auto* port : { rp_branch_datapath, rp_mem_datapath, rp_execute_datapath }) {
+        if ( !port->is_ready( cycle))
+            continue;
 
-    if ( instrs.empty())
-        writeback_bubble( cycle);
-    else for ( auto& instr : instrs)
+        auto instr = port->read( cycle);
         writeback_instruction_system( &instr, cycle);
+        has_instrs = true;
+    }
+
+    if ( !has_instrs)
+        writeback_bubble( cycle);
 }
 
 template <typename ISA>
@@ -85,11 +83,14 @@ void Writeback<ISA>::writeback_instruction_system( Writeback<ISA>::Instr* instr,
     kernel->handle_instruction( instr);
     auto result_trap = driver->handle_trap( *instr);
     checker.driver_step( *instr);
-    if ( executed_instrs >= instrs_to_run)
+    if ( executed_instrs->get() >= instrs_to_run)
         wp_halt->write( Trap( Trap::BREAKPOINT), cycle);
     else
         wp_halt->write( result_trap, cycle);
 
+    if ( has_syscall || result_trap != Trap::NO_TRAP)
+        cpi_stack->flush( instr->get_PC(), instr->get_sequence_id(), CpiComponent::OTHER);
+
     if ( has_syscall)
         set_writeback_target( instr->get_actual_target(), cycle);
     else if ( result_trap != Trap::NO_TRAP)
@@ -113,7 +114,9 @@ void Writeback<ISA>::writeback_instruction( const Writeback<ISA>::Instr& instr,
     sout << instr << std::endl;
 
     checker.check( instr);
-    ++executed_instrs;
+    if ( profiler != nullptr)
+        profiler->retire( instr);
+    ++*executed_instrs;
     last_writeback_cycle = cycle;
     next_PC = instr.get_actual_target().address;
 }
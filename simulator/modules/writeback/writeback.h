@@ -10,7 +10,9 @@
 
 #include <func_sim/driver/driver.h>
 #include <func_sim/operation.h>
+#include <func_sim/profiler/profiler.h>
 #include <infra/exception.h>
+#include <modules/core/cpi_stack.h>
 #include <modules/core/perf_instr.h>
 #include <modules/ports_instance.h>
 
@@ -34,7 +36,7 @@ class Writeback final : public Module
 private:
     /* Instrumentation */
     uint64 instrs_to_run = 0;
-    uint64 executed_instrs = 0;
+    Counter* executed_instrs = nullptr;
     Cycle last_writeback_cycle = 0_cl;
     Addr next_PC = 0;
     const std::endian endian;
@@ -44,8 +46,9 @@ private:
 
     /* Simulator internals */
     RF<FuncInstr>* rf = nullptr;
+    CpiStack* cpi_stack = nullptr;
+    GuestProfiler* profiler = nullptr;
 
-    auto read_instructions( Cycle cycle);
     void writeback_instruction( const Writeback<ISA>::Instr& instr, Cycle cycle);
     void writeback_instruction_system( Writeback<ISA>::Instr* instr, Cycle cycle);
     void writeback_bubble( Cycle cycle);
@@ -57,7 +60,6 @@ private:
     ReadPort<Instr>* rp_execute_datapath = nullptr;
     ReadPort<Instr>* rp_branch_datapath = nullptr;
     ReadPort<bool>* rp_trap = nullptr;
-    ReadPort<Instr>* rp_late_alu = nullptr;
 
     /* Output */
     WritePort<InstructionOutput>* wp_bypass = nullptr;
@@ -77,10 +79,14 @@ public:
 
     void clock( Cycle cycle);
     void set_RF( RF<FuncInstr>* value) { rf = value; }
+    void set_cpi_stack( CpiStack* value) { cpi_stack = value; }
+    void set_profiler( GuestProfiler* value) { profiler = value; }
     void disable_checker() { checker.disable(); }
+    void sync_checker() { checker.sync(); }
+    void set_checker_period( uint64 value) { checker.set_period( value); }
     void set_target( const Target& value, Cycle cycle);
     void set_instrs_to_run( uint64 value) { instrs_to_run = value; }
-    auto get_executed_instrs() const { return executed_instrs; }
+    auto get_executed_instrs() const { return executed_instrs->get(); }
     Addr get_next_PC() const { return next_PC; }
     int get_exit_code() const noexcept;
     void set_kernel( const std::shared_ptr<Kernel>& k, std::string_view isa);
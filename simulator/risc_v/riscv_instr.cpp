@@ -288,10 +288,10 @@ static const std::vector<RISCVTableEntry<I>> cmd_desc =
     // NOP
     {'C', instr_c_nop,      execute_or<I>,     OUT_ARITHM, ' ',                       Imm::NO,       { Src::ZERO,     Src::ZERO },     { Dst::ZERO },     0, 32 | 64 | 128}, // NOLINT(hicpp-signed-bitwise) https://bugs.llvm.org/show_bug.cgi?id=44977
     // Jumps and branches
-    {'C', instr_c_j,        execute_jal<I>,    OUT_BRANCH, ImmediateType::C_J,        Imm::JUMP_REL, { Src::ZERO,     Src::ZERO },     { Dst::ZERO },     0, 32 | 64 | 128}, // NOLINT(hicpp-signed-bitwise) https://bugs.llvm.org/show_bug.cgi?id=44977
-    {'C', instr_c_jal,      execute_jal<I>,    OUT_BRANCH, ImmediateType::C_J,        Imm::JUMP_REL, { Src::ZERO,     Src::ZERO },     { Dst::RA },       0, 32           },
-    {'C', instr_c_jr,       execute_jalr<I>,   OUT_BRANCH, ' ',                       Imm::NO,       { Src::RD,       Src::ZERO },     { Dst::ZERO },     0, 32 | 64 | 128}, // NOLINT(hicpp-signed-bitwise) https://bugs.llvm.org/show_bug.cgi?id=44977
-    {'C', instr_c_jalr,     execute_jalr<I>,   OUT_BRANCH, ' ',                       Imm::NO,       { Src::RD,       Src::ZERO },     { Dst::RA },       0, 32 | 64 | 128}, // NOLINT(hicpp-signed-bitwise) https://bugs.llvm.org/show_bug.cgi?id=44977
+    {'C', instr_c_j,        execute_jal<I>,    OUT_J_JUMP, ImmediateType::C_J,        Imm::JUMP_REL, { Src::ZERO,     Src::ZERO },     { Dst::ZERO },     0, 32 | 64 | 128}, // NOLINT(hicpp-signed-bitwise) https://bugs.llvm.org/show_bug.cgi?id=44977
+    {'C', instr_c_jal,      execute_jal<I>,    OUT_J_JUMP, ImmediateType::C_J,        Imm::JUMP_REL, { Src::ZERO,     Src::ZERO },     { Dst::RA },       0, 32           },
+    {'C', instr_c_jr,       execute_jalr<I>,   OUT_R_JUMP, ' ',                       Imm::NO,       { Src::RD,       Src::ZERO },     { Dst::ZERO },     0, 32 | 64 | 128}, // NOLINT(hicpp-signed-bitwise) https://bugs.llvm.org/show_bug.cgi?id=44977
+    {'C', instr_c_jalr,     execute_jalr<I>,   OUT_R_JUMP, ' ',                       Imm::NO,       { Src::RD,       Src::ZERO },     { Dst::RA },       0, 32 | 64 | 128}, // NOLINT(hicpp-signed-bitwise) https://bugs.llvm.org/show_bug.cgi?id=44977
     {'C', instr_c_beqz,     execute_beq<I>,    OUT_BRANCH, ImmediateType::C_B,        Imm::ARITH,    { Src::RS1_3BIT, Src::ZERO },     { Dst::ZERO },     0, 32 | 64 | 128}, // NOLINT(hicpp-signed-bitwise) https://bugs.llvm.org/show_bug.cgi?id=44977
     {'C', instr_c_bnez,     execute_bne<I>,    OUT_BRANCH, ImmediateType::C_B,        Imm::ARITH,    { Src::RS1_3BIT, Src::ZERO },     { Dst::ZERO },     0, 32 | 64 | 128}, // NOLINT(hicpp-signed-bitwise) https://bugs.llvm.org/show_bug.cgi?id=44977
     // Loads
@@ -15,15 +15,13 @@ const std::array<std::string_view, RISCVRegister::MAX_REG> RISCVRegister::regTab
 #undef DECLARE_CSR
 }};
 
+// Decoder looks up CSR indices of every instruction, so misses must not throw
 template<typename Map>
-static auto try_read( const Map& map, typename Map::key_type key, typename Map::mapped_type bad) try
+static auto try_read( const Map& map, typename Map::key_type key, typename Map::mapped_type bad)
 {
-    return map.at( key);
+    const auto it = map.find( key);
+    return it != map.end() ? it->second : bad;
 }
-catch ( const std::out_of_range&)
-{
-    return bad;
-}   
 
 RISCVRegister::RegNum RISCVRegister::get_csr_regnum( size_t val)
 {
@@ -395,3 +395,13 @@ TEST_CASE("RISCV ecall")
     instr.execute();
     CHECK( instr.trap_type() == Trap::SYSCALL);
 }
+
+TEST_CASE("RISCV calls and returns")
+{
+    CHECK( RISCVInstr<uint32>( 0x008000ef).is_call());      // jal $ra, 8
+    CHECK( RISCVInstr<uint32>( 0x000500e7).is_call());      // jalr $ra, $a0
+    CHECK_FALSE( RISCVInstr<uint32>( 0xf95ff06f).is_call()); // jal $zero, -108
+    CHECK( RISCVInstr<uint32>( 0x00008067).is_return());    // jalr $zero, $ra
+    CHECK_FALSE( RISCVInstr<uint32>( 0x00050067).is_return()); // jalr $zero, $a0
+    CHECK_FALSE( RISCVInstr<uint32>( 0x000080e7).is_return()); // jalr $ra, $ra
+}
@@ -135,6 +135,18 @@ Simulator::get_supported_isa()
     return SimulatorFactory::get_instance().get_supported_isa();
 }
 
+std::string
+Simulator::get_configured_isa()
+{
+    return config::isa;
+}
+
+bool
+Simulator::is_configured_functional_only()
+{
+    return config::functional_only;
+}
+
 std::shared_ptr<Simulator>
 Simulator::create_simulator( const std::string& isa, bool functional_only, bool log)
 {
@@ -28,6 +28,13 @@ struct InvalidISA final : Exception
     { }
 };
 
+struct MemoryTraceUnsupported final : Exception
+{
+    MemoryTraceUnsupported()
+        : Exception("Memory trace is not supported", "run functional simulation to trace memory accesses")
+    { }
+};
+
 class CPUModel
 {
 public:
@@ -58,7 +65,9 @@ public:
 };
 
 class FuncMemory;
+class GuestProfiler;
 class Kernel;
+class MemoryTraceSink;
 
 class Simulator : public CPUModel
 {
@@ -70,11 +79,23 @@ public:
     virtual void disable_checker() = 0;
     virtual void enable_driver_hooks() = 0;
     virtual int get_exit_code() const noexcept = 0;
+    virtual uint64 get_executed_instrs() const = 0;
     std::string_view get_isa() const final { return isa; }
 
+    // Instruction fetches and data accesses are passed to the sinks, either of them may be null
+    virtual void set_memory_trace( std::shared_ptr<MemoryTraceSink> /* instructions */, std::shared_ptr<MemoryTraceSink> /* data */)
+    {
+        throw MemoryTraceUnsupported();
+    }
+
+    // Retired instructions are counted by the profiler, null disables profiling
+    virtual void set_profiler( std::shared_ptr<GuestProfiler> profiler) = 0;
+
     Trap run_no_limit() { return run( MAX_VAL64); }
 
     static std::vector<std::string> get_supported_isa();
+    static std::string get_configured_isa();
+    static bool is_configured_functional_only();
     static std::shared_ptr<Simulator> create_simulator( const std::string& isa, bool functional_only, bool log);
     static std::shared_ptr<Simulator> create_simulator( const std::string& isa, bool functional_only);
     static std::shared_ptr<Simulator> create_configured_simulator();
@@ -97,6 +118,12 @@ class CycleAccurateSimulator : public Simulator, public Root
 public:
     explicit CycleAccurateSimulator( std::string_view isa) : Simulator( isa), Root( "cpu") { }
     virtual void clock() = 0;
+    virtual void set_checker_period( uint64 period) = 0;
+
+    // Interface for external clocking, e.g. by a multi-core container
+    virtual void start_run( uint64 instrs_to_run) = 0;
+    virtual Trap get_trap() const = 0;
+    virtual uint64 get_cycles() const = 0;
     static std::shared_ptr<CycleAccurateSimulator> create_simulator(const std::string& isa);
 };
 